@@ -0,0 +1,53 @@
+#include "AI/AWalkabilityBakeVolume.h"
+#include "AI/UWalkabilityBakeAsset.h"
+#include "AI/UWalkabilityCacheSubsystem.h"
+#include "Components/BoxComponent.h"
+
+AWalkabilityBakeVolume::AWalkabilityBakeVolume()
+{
+    PrimaryActorTick.bCanEverTick = false;
+
+    BakeBounds = CreateDefaultSubobject<UBoxComponent>(TEXT("BakeBounds"));
+    BakeBounds->SetBoxExtent(FVector(5000.f, 5000.f, 1000.f));
+    BakeBounds->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+    BakeBounds->SetCanEverAffectNavigation(false);
+    RootComponent = BakeBounds;
+}
+
+void AWalkabilityBakeVolume::BeginPlay()
+{
+    Super::BeginPlay();
+
+    if (UWalkabilityCacheSubsystem* WalkabilityCache = GetWorld()->GetSubsystem<UWalkabilityCacheSubsystem>())
+    {
+        WalkabilityCache->SetBakedData(BakedData);
+    }
+}
+
+void AWalkabilityBakeVolume::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (UWalkabilityCacheSubsystem* WalkabilityCache = GetWorld()->GetSubsystem<UWalkabilityCacheSubsystem>())
+    {
+        WalkabilityCache->SetBakedData(nullptr);
+    }
+
+    Super::EndPlay(EndPlayReason);
+}
+
+void AWalkabilityBakeVolume::BakeWalkability()
+{
+    if (!BakedData)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("WalkabilityBakeVolume: %s has no BakedData asset assigned."), *GetName());
+        return;
+    }
+
+    UWalkabilityCacheSubsystem* WalkabilityCache = GetWorld() ? GetWorld()->GetSubsystem<UWalkabilityCacheSubsystem>() : nullptr;
+    if (!WalkabilityCache)
+        return;
+
+    if (!WalkabilityCache->BakeRegion(BakeBounds->Bounds.GetBox(), *BakedData))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("WalkabilityBakeVolume: Bake failed for %s (is the NavMesh built?)."), *GetName());
+    }
+}
@@ -0,0 +1,659 @@
+#include "AI/FFormationAssignmentSolver.h"
+#include "Math/VectorRegister.h"
+#include "Math/RandomStream.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/ParallelFor.h"
+
+namespace FormationAssignment
+{
+    // ستونی که مالک آن ردیف ساختگی Pad است (هیچ‌وقت آزاد نیست)
+    constexpr int32 PaddingColumn = -2;
+
+    // اندیس ردیف در float نگه داشته می‌شود؛ تا این حد دقیق است
+    constexpr int32 MaxRows = 1 << 24;
+
+    // حراج: اپسیلون فاز اول = بیشترین هزینه / AuctionStartDivisor و هر فاز تقسیم بر AuctionScaling
+    constexpr float AuctionStartDivisor = 8.f;
+    constexpr float AuctionScaling = 4.f;
+    constexpr float MinRelativeEpsilon = 1e-5f;
+
+    // پیشنهادهای هم‌زمان هر دور؛ بیشتر از این تداخل پیشنهادها (و کل پیشنهادها) زیاد می‌شود
+    constexpr int32 AuctionBatchSize = 32;
+
+    // پخش یک دور بین Threadها از این تعداد خانه ماتریس (دسته × ستون) به بعد می‌ارزد
+    constexpr int32 MinParallelBidCells = 16 * 1024;
+
+    constexpr int32 AuctionQueueCompact = 4096;
+}
+
+static int32 GFormationAuctionMinUnits = 150;
+static FAutoConsoleVariableRef CVarFormationAuctionMinUnits(
+    TEXT("ai.Formation.AuctionMinUnits"),
+    GFormationAuctionMinUnits,
+    TEXT("Formations with at least this many units (or slots) are assigned with the parallel auction solver instead of the exact Hungarian."));
+
+static float GFormationAuctionEpsilon = 1.f;
+static FAutoConsoleVariableRef CVarFormationAuctionEpsilon(
+    TEXT("ai.Formation.AuctionEpsilon"),
+    GFormationAuctionEpsilon,
+    TEXT("Final auction epsilon (cm). The auction's total cost is at most optimal + NumSlots * epsilon."));
+
+void FFormationAssignmentSolver::PadRow(float* Row, int32 NumCols, int32 RowStride)
+{
+    for (int32 j = NumCols; j < RowStride; j++)
+    {
+        Row[j] = FLT_MAX;
+    }
+}
+
+void FFormationAssignmentSolver::BuildCostMatrix(TConstArrayView<FVector> UnitLocations, TConstArrayView<FVector> Slots, const FVector& Center, const FVector& Forward, float ForwardBias)
+{
+    Rows = UnitLocations.Num();
+    Cols = Slots.Num();
+    Stride = Align(Cols, 4);
+    Cost.SetNumUninitialized(Rows * Stride, EAllowShrinking::No);
+    if (Rows == 0 || Cols == 0)
+        return;
+
+    // SoA و نسبت به Center (float کافی است و دقت مختصات بزرگ World از بین نمی‌رود)
+    SlotX.SetNumUninitialized(Stride, EAllowShrinking::No);
+    SlotY.SetNumUninitialized(Stride, EAllowShrinking::No);
+    SlotZ.SetNumUninitialized(Stride, EAllowShrinking::No);
+    SlotBias.SetNumUninitialized(Stride, EAllowShrinking::No);
+
+    const FVector ForwardDir = Forward.GetSafeNormal();
+    for (int32 j = 0; j < Stride; j++)
+    {
+        const FVector ToSlot = j < Cols ? Slots[j] - Center : FVector::ZeroVector;
+        SlotX[j] = (float)ToSlot.X;
+        SlotY[j] = (float)ToSlot.Y;
+        SlotZ[j] = (float)ToSlot.Z;
+        SlotBias[j] = (float)FVector::DotProduct(ToSlot.GetSafeNormal(), ForwardDir) * ForwardBias;
+    }
+
+    for (int32 i = 0; i < Rows; i++)
+    {
+        const FVector Unit = UnitLocations[i] - Center;
+        const VectorRegister4Float UnitX = VectorSetFloat1((float)Unit.X);
+        const VectorRegister4Float UnitY = VectorSetFloat1((float)Unit.Y);
+        const VectorRegister4Float UnitZ = VectorSetFloat1((float)Unit.Z);
+        float* Row = Cost.GetData() + i * Stride;
+
+        for (int32 j = 0; j < Stride; j += 4)
+        {
+            const VectorRegister4Float DX = VectorSubtract(VectorLoad(SlotX.GetData() + j), UnitX);
+            const VectorRegister4Float DY = VectorSubtract(VectorLoad(SlotY.GetData() + j), UnitY);
+            const VectorRegister4Float DZ = VectorSubtract(VectorLoad(SlotZ.GetData() + j), UnitZ);
+
+            VectorRegister4Float DistSq = VectorMultiply(DX, DX);
+            DistSq = VectorMultiplyAdd(DY, DY, DistSq);
+            DistSq = VectorMultiplyAdd(DZ, DZ, DistSq);
+
+            const VectorRegister4Float Value = VectorSubtract(VectorSqrt(DistSq), VectorLoad(SlotBias.GetData() + j));
+            VectorStore(VectorMax(Value, VectorZeroFloat()), Row + j);
+        }
+        PadRow(Row, Cols, Stride);
+    }
+}
+
+void FFormationAssignmentSolver::SetCostMatrix(TConstArrayView<float> InCost, int32 InRows, int32 InCols)
+{
+    check(InCost.Num() == InRows * InCols);
+
+    Rows = InRows;
+    Cols = InCols;
+    Stride = Align(Cols, 4);
+    Cost.SetNumUninitialized(Rows * Stride, EAllowShrinking::No);
+    for (int32 i = 0; i < Rows; i++)
+    {
+        float* Row = Cost.GetData() + i * Stride;
+        FMemory::Memcpy(Row, InCost.GetData() + i * Cols, Cols * sizeof(float));
+        PadRow(Row, Cols, Stride);
+    }
+}
+
+float FFormationAssignmentSolver::Solve(TArray<int32>& OutAssignment)
+{
+    return SolveWithBackend(OutAssignment, EFormationAssignmentBackend::Hungarian, 0.f);
+}
+
+float FFormationAssignmentSolver::SolveAuction(TArray<int32>& OutAssignment, float Epsilon)
+{
+    return SolveWithBackend(OutAssignment, EFormationAssignmentBackend::Auction, Epsilon);
+}
+
+float FFormationAssignmentSolver::SolveAuto(TArray<int32>& OutAssignment)
+{
+    return FMath::Max(Rows, Cols) >= GFormationAuctionMinUnits
+        ? SolveAuction(OutAssignment, GFormationAuctionEpsilon)
+        : Solve(OutAssignment);
+}
+
+float FFormationAssignmentSolver::SolveWithBackend(TArray<int32>& OutAssignment, EFormationAssignmentBackend Backend, float Epsilon)
+{
+    LastBackend = Backend;
+    LastOptimalityBound = 0.f;
+    OutAssignment.SetNumUninitialized(Rows, EAllowShrinking::No);
+    for (int32& Slot : OutAssignment)
+    {
+        Slot = INDEX_NONE;
+    }
+    if (Rows == 0 || Cols == 0 || FMath::Max(Rows, Cols) >= FormationAssignment::MaxRows)
+        return 0.f;
+
+    if (Rows <= Cols)
+    {
+        SolveRowsToColsWith(Backend, Cost.GetData(), Rows, Cols, Stride, Epsilon, OutAssignment);
+    }
+    else
+    {
+        // اسلات‌ها کمترند → هر اسلات یک یونیت می‌گیرد؛ روی ترانهاده حل می‌شود
+        const int32 TransposedStride = Align(Rows, 4);
+        Transposed.SetNumUninitialized(Cols * TransposedStride, EAllowShrinking::No);
+        for (int32 j = 0; j < Cols; j++)
+        {
+            float* Row = Transposed.GetData() + j * TransposedStride;
+            for (int32 i = 0; i < Rows; i++)
+            {
+                Row[i] = Cost[i * Stride + j];
+            }
+            PadRow(Row, Rows, TransposedStride);
+        }
+
+        SolveRowsToColsWith(Backend, Transposed.GetData(), Cols, Rows, TransposedStride, Epsilon, SlotToUnit);
+        for (int32 j = 0; j < Cols; j++)
+        {
+            OutAssignment[SlotToUnit[j]] = j;
+        }
+    }
+
+    float Total = 0.f;
+    for (int32 i = 0; i < Rows; i++)
+    {
+        if (OutAssignment[i] != INDEX_NONE)
+        {
+            Total += Cost[i * Stride + OutAssignment[i]];
+        }
+    }
+    return Total;
+}
+
+void FFormationAssignmentSolver::SolveRowsToColsWith(EFormationAssignmentBackend Backend, const float* Matrix, int32 NumRows, int32 NumCols, int32 RowStride, float Epsilon, TArray<int32>& OutRowToCol)
+{
+    if (Backend == EFormationAssignmentBackend::Auction)
+    {
+        AuctionRowsToCols(Matrix, NumRows, NumCols, RowStride, Epsilon, OutRowToCol);
+    }
+    else
+    {
+        SolveRowsToCols(Matrix, NumRows, NumCols, RowStride, OutRowToCol);
+    }
+}
+
+int32 FFormationAssignmentSolver::RelaxRow(const float* Row, float Offset, int32 RowIndex, int32 RowStride, float& OutMinDist)
+{
+    const VectorRegister4Float OffsetVec = VectorSetFloat1(Offset);
+    const VectorRegister4Float RowVec = VectorSetFloat1((float)RowIndex);
+    const VectorRegister4Float LaneStep = VectorSetFloat1(4.f);
+    VectorRegister4Float Lanes = MakeVectorRegisterFloat(0.f, 1.f, 2.f, 3.f);
+    VectorRegister4Float BestDist = VectorSetFloat1(FLT_MAX);
+    VectorRegister4Float BestLane = VectorZeroFloat();
+
+    // در یک گذر: کاهش D ستون‌های باز (ستون بسته با Closed = بی‌نهایت هیچ‌وقت کم نمی‌شود) و کمینه D همه ستون‌ها
+    for (int32 j = 0; j < RowStride; j += 4)
+    {
+        const VectorRegister4Float Reduced = VectorAdd(VectorSubtract(VectorSubtract(VectorLoad(Row + j), VectorLoad(V.GetData() + j)), OffsetVec), VectorLoad(Closed.GetData() + j));
+        const VectorRegister4Float OldDist = VectorLoad(Dist.GetData() + j);
+        const VectorRegister4Float Improved = VectorCompareLT(Reduced, OldDist);
+        const VectorRegister4Float NewDist = VectorMin(Reduced, OldDist);
+
+        VectorStore(NewDist, Dist.GetData() + j);
+        VectorStore(VectorSelect(Improved, RowVec, VectorLoad(PredRow.GetData() + j)), PredRow.GetData() + j);
+
+        const VectorRegister4Float Better = VectorCompareLT(NewDist, BestDist);
+        BestDist = VectorMin(NewDist, BestDist);
+        BestLane = VectorSelect(Better, Lanes, BestLane);
+        Lanes = VectorAdd(Lanes, LaneStep);
+    }
+
+    float Dists[4];
+    float LaneIndices[4];
+    VectorStore(BestDist, Dists);
+    VectorStore(BestLane, LaneIndices);
+
+    int32 Best = 0;
+    for (int32 Lane = 1; Lane < 4; Lane++)
+    {
+        if (Dists[Lane] < Dists[Best])
+        {
+            Best = Lane;
+        }
+    }
+    OutMinDist = Dists[Best];
+    return (int32)LaneIndices[Best];
+}
+
+void FFormationAssignmentSolver::SolveRowsToCols(const float* Matrix, int32 NumRows, int32 NumCols, int32 RowStride, TArray<int32>& OutRowToCol)
+{
+    // SetNum بدون Shrink → بعد از اولین حل با همین اندازه هیچ Allocate ای نیست
+    V.SetNumUninitialized(RowStride, EAllowShrinking::No);
+    Dist.SetNumUninitialized(RowStride, EAllowShrinking::No);
+    Closed.SetNumUninitialized(RowStride, EAllowShrinking::No);
+    PredRow.SetNumUninitialized(RowStride, EAllowShrinking::No);
+    ColToRow.SetNumUninitialized(RowStride, EAllowShrinking::No);
+    OutRowToCol.SetNumUninitialized(NumRows, EAllowShrinking::No);
+
+    FMemory::Memzero(V.GetData(), RowStride * sizeof(float));
+    FMemory::Memzero(PredRow.GetData(), RowStride * sizeof(float));
+    for (int32 j = 0; j < RowStride; j++)
+    {
+        ColToRow[j] = j < NumCols ? INDEX_NONE : FormationAssignment::PaddingColumn;
+    }
+
+    // هر ردیف با کوتاه‌ترین مسیر افزایشی (Dijkstra روی هزینه‌های کاهش‌یافته) به جفت‌ها اضافه می‌شود
+    for (int32 FreeRow = 0; FreeRow < NumRows; FreeRow++)
+    {
+        for (int32 j = 0; j < RowStride; j++)
+        {
+            Dist[j] = FLT_MAX;
+            Closed[j] = j < NumCols ? 0.f : FLT_MAX;
+        }
+        ScannedCols.Reset();
+        ScannedDist.Reset();
+
+        float MinDist = 0.f;
+        int32 Col = RelaxRow(Matrix + FreeRow * RowStride, 0.f, FreeRow, RowStride, MinDist);
+
+        // تا رسیدن به ستون آزاد: ستون کمینه بسته و ردیف صاحبش Relax می‌شود
+        while (ColToRow[Col] != INDEX_NONE)
+        {
+            ScannedCols.Add(Col);
+            ScannedDist.Add(MinDist);
+            Dist[Col] = FLT_MAX;
+            Closed[Col] = FLT_MAX;
+
+            const int32 Owner = ColToRow[Col];
+            const float* OwnerRow = Matrix + Owner * RowStride;
+            Col = RelaxRow(OwnerRow, OwnerRow[Col] - V[Col] - MinDist, Owner, RowStride, MinDist);
+        }
+
+        // پتانسیل ستون‌های بسته؛ بقیه دست نمی‌خورند
+        for (int32 Index = 0; Index < ScannedCols.Num(); Index++)
+        {
+            V[ScannedCols[Index]] += ScannedDist[Index] - MinDist;
+        }
+
+        // جابه‌جایی جفت‌ها در طول مسیر افزایشی
+        for (;;)
+        {
+            const int32 Row = (int32)PredRow[Col];
+            ColToRow[Col] = Row;
+            const int32 PrevCol = OutRowToCol[Row];
+            OutRowToCol[Row] = Col;
+            if (Row == FreeRow)
+                break;
+
+            Col = PrevCol;
+        }
+    }
+}
+
+int32 FFormationAssignmentSolver::FindBestSlot(const float* Row, int32 RowStride, float& OutBest, float& OutSecond) const
+{
+    const VectorRegister4Float LaneStep = VectorSetFloat1(4.f);
+    VectorRegister4Float Lanes = MakeVectorRegisterFloat(0.f, 1.f, 2.f, 3.f);
+    VectorRegister4Float Best = VectorSetFloat1(FLT_MAX);
+    VectorRegister4Float Second = Best;
+    VectorRegister4Float BestLane = VectorZeroFloat();
+
+    // هر Lane دو کمینه خودش را نگه می‌دارد
+    for (int32 j = 0; j < RowStride; j += 4)
+    {
+        const VectorRegister4Float Value = VectorAdd(VectorLoad(Row + j), VectorLoad(Prices.GetData() + j));
+        Second = VectorMin(Second, VectorMax(Best, Value));
+
+        const VectorRegister4Float Better = VectorCompareLT(Value, Best);
+        Best = VectorMin(Best, Value);
+        BestLane = VectorSelect(Better, Lanes, BestLane);
+        Lanes = VectorAdd(Lanes, LaneStep);
+    }
+
+    float Bests[4];
+    float Seconds[4];
+    float LaneIndices[4];
+    VectorStore(Best, Bests);
+    VectorStore(Second, Seconds);
+    VectorStore(BestLane, LaneIndices);
+
+    int32 Winner = 0;
+    for (int32 Lane = 1; Lane < 4; Lane++)
+    {
+        if (Bests[Lane] < Bests[Winner])
+        {
+            Winner = Lane;
+        }
+    }
+
+    OutBest = Bests[Winner];
+    OutSecond = Seconds[Winner];
+    for (int32 Lane = 0; Lane < 4; Lane++)
+    {
+        if (Lane != Winner)
+        {
+            OutSecond = FMath::Min(OutSecond, Bests[Lane]);
+        }
+    }
+    return (int32)LaneIndices[Winner];
+}
+
+void FFormationAssignmentSolver::AuctionRowsToCols(const float* Matrix, int32 NumRows, int32 NumCols, int32 RowStride, float Epsilon, TArray<int32>& OutRowToCol)
+{
+    // ردیف‌های کم با خریدار ساختگی هزینه صفر پر می‌شوند تا مسئله مربع شود؛ بهینه مربع همان بهینه مستطیلی است
+    const int32 NumBidders = NumCols;
+    DummyRow.SetNumUninitialized(RowStride, EAllowShrinking::No);
+    for (int32 j = 0; j < RowStride; j++)
+    {
+        DummyRow[j] = j < NumCols ? 0.f : FLT_MAX;
+    }
+
+    float MaxCost = 0.f;
+    for (int32 i = 0; i < NumRows; i++)
+    {
+        const float* Row = Matrix + i * RowStride;
+        for (int32 j = 0; j < NumCols; j++)
+        {
+            MaxCost = FMath::Max(MaxCost, Row[j]);
+        }
+    }
+
+    // اپسیلون زیر دقت float قیمت‌ها حراج را گیر می‌اندازد (افزایش قیمت صفر می‌شود)
+    const float FinalEpsilon = FMath::Max(Epsilon, (MaxCost + 1.f) * FormationAssignment::MinRelativeEpsilon);
+    float PhaseEpsilon = FMath::Max(MaxCost / FormationAssignment::AuctionStartDivisor, FinalEpsilon);
+    LastOptimalityBound = NumBidders * FinalEpsilon;
+
+    Prices.SetNumUninitialized(RowStride, EAllowShrinking::No);
+    SlotOwner.SetNumUninitialized(RowStride, EAllowShrinking::No);
+    BidderSlot.SetNumUninitialized(NumBidders, EAllowShrinking::No);
+    BidSlot.SetNumUninitialized(FormationAssignment::AuctionBatchSize, EAllowShrinking::No);
+    BidPrice.SetNumUninitialized(FormationAssignment::AuctionBatchSize, EAllowShrinking::No);
+    FMemory::Memzero(Prices.GetData(), RowStride * sizeof(float));
+
+    // دسته کوچک پیشنهاد هم‌زمان (Jacobi) و دسته‌ها پشت سر هم با قیمت‌های تازه (Gauss-Seidel)؛
+    // حراج کاملاً Jacobi روی آرایش‌های واقعی (خیلی از یونیت‌ها دنبال همان اسلات‌های نزدیک) چند برابر پیشنهاد بیشتر لازم دارد
+    const EParallelForFlags BidFlags = FormationAssignment::AuctionBatchSize * RowStride >= FormationAssignment::MinParallelBidCells
+        ? EParallelForFlags::None
+        : EParallelForFlags::ForceSingleThread;
+
+    // ε-scaling: هر فاز تخصیص را از نو می‌سازد ولی قیمت‌های فاز قبل را نگه می‌دارد
+    for (;;)
+    {
+        for (int32 j = 0; j < RowStride; j++)
+        {
+            SlotOwner[j] = j < NumCols ? INDEX_NONE : FormationAssignment::PaddingColumn;
+        }
+        Bidders.Reset();
+        for (int32 Bidder = 0; Bidder < NumBidders; Bidder++)
+        {
+            BidderSlot[Bidder] = INDEX_NONE;
+            Bidders.Add(Bidder);
+        }
+
+        // Bidders صف است: خریدار بازنده یا بیرون‌شده به تهش اضافه می‌شود
+        int32 Head = 0;
+        while (Head < Bidders.Num())
+        {
+            const int32 Count = FMath::Min(FormationAssignment::AuctionBatchSize, Bidders.Num() - Head);
+            const float RoundEpsilon = PhaseEpsilon;
+
+            // ۱) پیشنهادها فقط قیمت‌ها را می‌خوانند → موازی
+            ParallelFor(Count, [this, Matrix, NumRows, RowStride, MaxCost, RoundEpsilon, Head](int32 Index)
+            {
+                const int32 Bidder = Bidders[Head + Index];
+                const float* Row = Bidder < NumRows ? Matrix + Bidder * RowStride : DummyRow.GetData();
+
+                float Best = 0.f;
+                float Second = 0.f;
+                const int32 Slot = FindBestSlot(Row, RowStride, Best, Second);
+                BidSlot[Index] = Slot;
+                BidPrice[Index] = Prices[Slot] + FMath::Min(Second - Best, MaxCost) + RoundEpsilon;
+            }, BidFlags);
+
+            // ۲) به ترتیب: پیشنهادی که هنوز از قیمت فعلی بالاتر است اسلات را می‌گیرد (ε-CS با قیمت‌های کهنه‌تر هم برقرار می‌ماند)
+            for (int32 Index = 0; Index < Count; Index++)
+            {
+                const int32 Bidder = Bidders[Head + Index];
+                const int32 Slot = BidSlot[Index];
+                const int32 PrevOwner = SlotOwner[Slot];
+                if (PrevOwner != INDEX_NONE && BidPrice[Index] <= Prices[Slot])
+                {
+                    Bidders.Add(Bidder);
+                    continue;
+                }
+
+                if (PrevOwner != INDEX_NONE)
+                {
+                    BidderSlot[PrevOwner] = INDEX_NONE;
+                    Bidders.Add(PrevOwner);
+                }
+                SlotOwner[Slot] = Bidder;
+                BidderSlot[Bidder] = Slot;
+                Prices[Slot] = BidPrice[Index];
+            }
+            Head += Count;
+
+            // صف بی‌نهایت بزرگ نشود
+            if (Head >= FormationAssignment::AuctionQueueCompact && Head * 2 >= Bidders.Num())
+            {
+                Bidders.RemoveAt(0, Head, EAllowShrinking::No);
+                Head = 0;
+            }
+        }
+
+        if (PhaseEpsilon <= FinalEpsilon)
+            break;
+
+        PhaseEpsilon = FMath::Max(PhaseEpsilon / FormationAssignment::AuctionScaling, FinalEpsilon);
+    }
+
+    OutRowToCol.SetNumUninitialized(NumRows, EAllowShrinking::No);
+    for (int32 i = 0; i < NumRows; i++)
+    {
+        OutRowToCol[i] = BidderSlot[i];
+    }
+}
+
+void FFormationAssignmentSolver::SolveGreedy(TArray<int32>& OutAssignment) const
+{
+    OutAssignment.Init(INDEX_NONE, Rows);
+    TBitArray<> SlotUsed(false, Cols);
+
+    for (int32 i = 0; i < Rows; i++)
+    {
+        const float* Row = Cost.GetData() + i * Stride;
+        float Best = FLT_MAX;
+        int32 BestJ = INDEX_NONE;
+        for (int32 j = 0; j < Cols; j++)
+        {
+            if (!SlotUsed[j] && Row[j] < Best)
+            {
+                Best = Row[j];
+                BestJ = j;
+            }
+        }
+        if (BestJ != INDEX_NONE)
+        {
+            OutAssignment[i] = BestJ;
+            SlotUsed[BestJ] = true;
+        }
+    }
+}
+
+namespace FormationAssignBenchmark
+{
+    constexpr int32 LegacyMaxUnits = 600;
+
+    // Hungarian قبلی UUnitFormationManager (ماتریس تودرتو، مربع با Pad، Allocate در هر حل) فقط برای مقایسه
+    TArray<int32> LegacyHungarianSolve(const TArray<TArray<float>>& Cost)
+    {
+        const int32 N = Cost.Num();
+        const int32 M = Cost[0].Num();
+        const int32 Dim = FMath::Max(N, M);
+
+        TArray<TArray<float>> A;
+        A.SetNum(Dim);
+        for (int32 i = 0; i < Dim; ++i)
+        {
+            A[i].SetNum(Dim);
+            for (int32 j = 0; j < Dim; ++j)
+            {
+                A[i][j] = (i < N && j < M) ? Cost[i][j] : 1e6f;
+            }
+        }
+
+        TArray<float> u; u.Init(0.f, Dim + 1);
+        TArray<float> v; v.Init(0.f, Dim + 1);
+        TArray<int32> p; p.Init(0, Dim + 1);
+        TArray<int32> way; way.Init(0, Dim + 1);
+
+        for (int32 i = 1; i <= Dim; ++i)
+        {
+            p[0] = i;
+            int32 j0 = 0;
+            TArray<float> minv; minv.Init(FLT_MAX, Dim + 1);
+            TArray<bool> used; used.Init(false, Dim + 1);
+
+            do
+            {
+                used[j0] = true;
+                const int32 i0 = p[j0];
+                float delta = FLT_MAX;
+                int32 j1 = 0;
+
+                for (int32 j = 1; j <= Dim; ++j)
+                {
+                    if (used[j]) continue;
+                    const float cur = A[i0 - 1][j - 1] - u[i0] - v[j];
+                    if (cur < minv[j]) { minv[j] = cur; way[j] = j0; }
+                    if (minv[j] < delta) { delta = minv[j]; j1 = j; }
+                }
+
+                for (int32 j = 0; j <= Dim; ++j)
+                {
+                    if (used[j]) { u[p[j]] += delta; v[j] -= delta; }
+                    else minv[j] -= delta;
+                }
+                j0 = j1;
+            } while (p[j0] != 0);
+
+            do
+            {
+                const int32 j1 = way[j0];
+                p[j0] = p[j1];
+                j0 = j1;
+            } while (j0);
+        }
+
+        TArray<int32> Assignment;
+        Assignment.Init(INDEX_NONE, N);
+        for (int32 j = 1; j <= Dim; ++j)
+        {
+            if (p[j] > 0 && p[j] <= N && j <= M)
+            {
+                Assignment[p[j] - 1] = j - 1;
+            }
+        }
+        return Assignment;
+    }
+
+    // ai.Formation.AssignBenchmark [NumUnits] [NumSlots] [Iterations]
+    // یونیت‌های تصادفی دور یک آرایش شبکه‌ای؛ زمان ساخت ماتریس، Hungarian جدید، حراج و حل قبلی و اختلاف هزینه کل
+    // حل قبلی بالای LegacyMaxUnits اجرا نمی‌شود (ثانیه‌ها طول می‌کشد)
+    void Run(const TArray<FString>& Args)
+    {
+        const int32 NumUnits = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 200;
+        const int32 NumSlots = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : NumUnits;
+        const int32 Iterations = Args.Num() > 2 ? FMath::Max(FCString::Atoi(*Args[2]), 1) : 20;
+
+        const FVector Center = FVector::ZeroVector;
+        const FVector Forward = FVector::ForwardVector;
+        const int32 Columns = FMath::CeilToInt(FMath::Sqrt((float)NumSlots));
+
+        TArray<FVector> Slots;
+        for (int32 j = 0; j < NumSlots; j++)
+        {
+            Slots.Add(FVector((j / Columns - Columns * 0.5f) * 120.f, (j % Columns - Columns * 0.5f) * 120.f, 0.f));
+        }
+
+        FRandomStream Random(NumUnits * 7919 + NumSlots);
+        FFormationAssignmentSolver Solver;
+        TArray<FVector> Units;
+        TArray<int32> Assignment;
+        TArray<TArray<float>> NestedCost;
+        double BuildMs = 0.0, SolveMs = 0.0, AuctionMs = 0.0, LegacyMs = 0.0, CostDelta = 0.0, AuctionGap = 0.0, AuctionBound = 0.0;
+        const bool bRunLegacy = FMath::Max(NumUnits, NumSlots) <= LegacyMaxUnits;
+
+        for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+        {
+            Units.Reset();
+            for (int32 i = 0; i < NumUnits; i++)
+            {
+                Units.Add(FVector(Random.FRandRange(-6000.f, 6000.f), Random.FRandRange(-6000.f, 6000.f), 0.f));
+            }
+
+            double Begin = FPlatformTime::Seconds();
+            Solver.BuildCostMatrix(Units, Slots, Center, Forward, 300.f);
+            BuildMs += (FPlatformTime::Seconds() - Begin) * 1000.0;
+
+            Begin = FPlatformTime::Seconds();
+            const float Total = Solver.Solve(Assignment);
+            SolveMs += (FPlatformTime::Seconds() - Begin) * 1000.0;
+
+            Begin = FPlatformTime::Seconds();
+            const float AuctionTotal = Solver.SolveAuction(Assignment, GFormationAuctionEpsilon);
+            AuctionMs += (FPlatformTime::Seconds() - Begin) * 1000.0;
+            AuctionGap = FMath::Max(AuctionGap, (double)(AuctionTotal - Total));
+            AuctionBound = Solver.GetLastOptimalityBound();
+
+            if (!bRunLegacy)
+                continue;
+
+            // قبلی با همان هزینه‌ها (ساخت ماتریس تودرتو در زمان حساب نمی‌شود)
+            NestedCost.SetNum(NumUnits);
+            for (int32 i = 0; i < NumUnits; i++)
+            {
+                NestedCost[i].SetNum(NumSlots);
+                for (int32 j = 0; j < NumSlots; j++)
+                {
+                    NestedCost[i][j] = Solver.GetCost(i, j);
+                }
+            }
+
+            Begin = FPlatformTime::Seconds();
+            const TArray<int32> LegacyAssignment = LegacyHungarianSolve(NestedCost);
+            LegacyMs += (FPlatformTime::Seconds() - Begin) * 1000.0;
+
+            float LegacyTotal = 0.f;
+            for (int32 i = 0; i < NumUnits; i++)
+            {
+                if (LegacyAssignment[i] != INDEX_NONE)
+                {
+                    LegacyTotal += NestedCost[i][LegacyAssignment[i]];
+                }
+            }
+            CostDelta = FMath::Max(CostDelta, (double)FMath::Abs(Total - LegacyTotal) / FMath::Max(LegacyTotal, 1.f));
+        }
+
+        UE_LOG(LogTemp, Log, TEXT("Formation assign benchmark %dx%d: build %.3f ms, hungarian %.3f ms, auction %.3f ms (max gap %.1f, bound %.1f)"),
+            NumUnits, NumSlots, BuildMs / Iterations, SolveMs / Iterations, AuctionMs / Iterations, AuctionGap, AuctionBound);
+        if (bRunLegacy)
+        {
+            UE_LOG(LogTemp, Log, TEXT("Formation assign benchmark: legacy %.3f ms (%.1fx slower than hungarian), max cost difference %.4f%%"),
+                LegacyMs / Iterations, LegacyMs / FMath::Max(SolveMs, 1e-6), CostDelta * 100.0);
+        }
+    }
+}
+
+static FAutoConsoleCommandWithArgs FormationAssignBenchmarkCommand(
+    TEXT("ai.Formation.AssignBenchmark"),
+    TEXT("Times the formation Hungarian and auction solvers against the previous nested-array Hungarian. Args: [NumUnits=200] [NumSlots=NumUnits] [Iterations=20]"),
+    FConsoleCommandWithArgsDelegate::CreateStatic(&FormationAssignBenchmark::Run));
@@ -0,0 +1,142 @@
+#include "AI/FFormationTemplateLibrary.h"
+#include "Math/VectorRegister.h"
+#include "Misc/ScopeLock.h"
+
+namespace FormationTemplates
+{
+    // قالب پهن‌ترین ردیف تا این تعداد یک ردیف تنهاست
+    constexpr int32 MinLineWidth = 8;
+
+    FCriticalSection CacheLock;
+
+    // TUniquePtr تا آدرس قالب‌ها با رشد Map عوض نشود
+    TMap<TPair<EFormationShape, int32>, TUniquePtr<FFormationTemplate>> Cache;
+}
+
+void FFormationTemplate::TransformToWorld(const FVector& Goal, const FVector& Forward, float Spacing, TArray<FVector>& OutSlots) const
+{
+    const int32 NumSlots = Num();
+    OutSlots.SetNumUninitialized(NumSlots);
+    if (NumSlots == 0)
+        return;
+
+    const FVector ForwardDir = Forward.IsNearlyZero() ? FVector::ForwardVector : Forward.GetSafeNormal();
+    const FVector RightDir = FVector::CrossProduct(ForwardDir, FVector::UpVector).GetSafeNormal();
+    const FVector Right = RightDir * Spacing;
+    const FVector Front = ForwardDir * Spacing;
+
+    const VectorRegister4Float RightX = VectorSetFloat1((float)Right.X);
+    const VectorRegister4Float RightY = VectorSetFloat1((float)Right.Y);
+    const VectorRegister4Float RightZ = VectorSetFloat1((float)Right.Z);
+    const VectorRegister4Float FrontX = VectorSetFloat1((float)Front.X);
+    const VectorRegister4Float FrontY = VectorSetFloat1((float)Front.Y);
+    const VectorRegister4Float FrontZ = VectorSetFloat1((float)Front.Z);
+
+    // آفست نسبت به Goal در float (SIMD) و جمع با Goal در double (مختصات بزرگ World)
+    float WorldX[4];
+    float WorldY[4];
+    float WorldZ[4];
+    for (int32 Base = 0; Base < NumSlots; Base += 4)
+    {
+        const VectorRegister4Float X = VectorLoad(OffsetX.GetData() + Base);
+        const VectorRegister4Float Y = VectorLoad(OffsetY.GetData() + Base);
+        VectorStore(VectorMultiplyAdd(Y, FrontX, VectorMultiply(X, RightX)), WorldX);
+        VectorStore(VectorMultiplyAdd(Y, FrontY, VectorMultiply(X, RightY)), WorldY);
+        VectorStore(VectorMultiplyAdd(Y, FrontZ, VectorMultiply(X, RightZ)), WorldZ);
+
+        const int32 NumLanes = FMath::Min(4, NumSlots - Base);
+        for (int32 Lane = 0; Lane < NumLanes; Lane++)
+        {
+            OutSlots[Base + Lane] = Goal + FVector(WorldX[Lane], WorldY[Lane], WorldZ[Lane]);
+        }
+    }
+}
+
+const FFormationTemplate& FFormationTemplateLibrary::Get(EFormationShape Shape, int32 NumSlots)
+{
+    NumSlots = FMath::Max(NumSlots, 0);
+
+    FScopeLock Lock(&FormationTemplates::CacheLock);
+    TUniquePtr<FFormationTemplate>& Template = FormationTemplates::Cache.FindOrAdd(TPair<EFormationShape, int32>(Shape, NumSlots));
+    if (!Template)
+    {
+        Template = MakeUnique<FFormationTemplate>();
+        BuildTemplate(Shape, NumSlots, *Template);
+    }
+    return *Template;
+}
+
+void FFormationTemplateLibrary::BuildTemplate(EFormationShape Shape, int32 NumSlots, FFormationTemplate& OutTemplate)
+{
+    TArray<FVector2f> Offsets;
+    Offsets.Reserve(NumSlots);
+    OutTemplate.SortKeys.Reset(NumSlots);
+
+    switch (Shape)
+    {
+    case EFormationShape::Line:
+        BuildRanks(NumSlots, FMath::Max(FMath::Min(NumSlots, FormationTemplates::MinLineWidth), FMath::CeilToInt(FMath::Sqrt(NumSlots * 4.f))), Offsets, OutTemplate.SortKeys);
+        break;
+    case EFormationShape::Column:
+        BuildRanks(NumSlots, FMath::Max(FMath::Min(NumSlots, 2), FMath::CeilToInt(FMath::Sqrt(NumSlots * 0.25f))), Offsets, OutTemplate.SortKeys);
+        break;
+    case EFormationShape::Wedge:
+        BuildWedge(NumSlots, Offsets, OutTemplate.SortKeys);
+        break;
+    case EFormationShape::Box:
+    default:
+        BuildRanks(NumSlots, FMath::CeilToInt(FMath::Sqrt((float)NumSlots)), Offsets, OutTemplate.SortKeys);
+        break;
+    }
+
+    // مرکز عمق آرایش روی صفر (ردیف اول جلوترین)
+    float MinY = 0.f;
+    for (const FVector2f& Offset : Offsets)
+    {
+        MinY = FMath::Min(MinY, Offset.Y);
+    }
+
+    const int32 Padded = Align(NumSlots, 4);
+    OutTemplate.OffsetX.SetNumZeroed(Padded);
+    OutTemplate.OffsetY.SetNumZeroed(Padded);
+    for (int32 Index = 0; Index < NumSlots; Index++)
+    {
+        OutTemplate.OffsetX[Index] = Offsets[Index].X;
+        OutTemplate.OffsetY[Index] = Offsets[Index].Y - MinY * 0.5f;
+    }
+}
+
+void FFormationTemplateLibrary::BuildRanks(int32 NumSlots, int32 Columns, TArray<FVector2f>& OutOffsets, TArray<uint32>& OutKeys)
+{
+    if (NumSlots == 0)
+        return;
+
+    Columns = FMath::Clamp(Columns, 1, NumSlots);
+    const float HalfWidth = (Columns - 1) * 0.5f;
+    const int32 NumRows = FMath::DivideAndRoundUp(NumSlots, Columns);
+    for (int32 Row = 0; Row < NumRows; Row++)
+    {
+        AddRow(Row, FMath::Min(Columns, NumSlots - Row * Columns), HalfWidth, OutOffsets, OutKeys);
+    }
+}
+
+void FFormationTemplateLibrary::BuildWedge(int32 NumSlots, TArray<FVector2f>& OutOffsets, TArray<uint32>& OutKeys)
+{
+    int32 Remaining = NumSlots;
+    for (int32 Row = 0; Remaining > 0; Row++)
+    {
+        const int32 Count = FMath::Min(Row * 2 + 1, Remaining);
+        AddRow(Row, Count, (float)Row, OutOffsets, OutKeys);
+        Remaining -= Count;
+    }
+}
+
+void FFormationTemplateLibrary::AddRow(int32 Row, int32 Count, float HalfWidth, TArray<FVector2f>& OutOffsets, TArray<uint32>& OutKeys)
+{
+    const float Step = Count > 1 ? HalfWidth * 2.f / (Count - 1) : 0.f;
+    for (int32 Index = 0; Index < Count; Index++)
+    {
+        OutOffsets.Add(FVector2f(Count > 1 ? Index * Step - HalfWidth : 0.f, -(float)Row));
+        OutKeys.Add(((uint32)Row << 16) | (uint32)Index);
+    }
+}
@@ -0,0 +1,422 @@
+#include "AI/FGridJumpPointSearch.h"
+#include "Algo/Reverse.h"
+
+namespace GridJumpPoint
+{
+    // فاصله Octile (هزینه دقیق حرکت هشت‌جهته بدون مانع) — Heuristic سازگار
+    float OctileDistance(int32 DX, int32 DY)
+    {
+        DX = FMath::Abs(DX);
+        DY = FMath::Abs(DY);
+        return (UE_SQRT_2 - 1.f) * FMath::Min(DX, DY) + FMath::Max(DX, DY);
+    }
+}
+
+void FGridJumpPointSearch::SetGrid(const TBitArray<>* InWalkable, int32 InWidth, int32 InHeight)
+{
+    Walkable = InWalkable;
+    Width = InWidth;
+    Height = InHeight;
+
+    JumpDistance.Reset();
+    WalkableRun.Reset();
+}
+
+bool FGridJumpPointSearch::HasForcedNeighbour(int32 X, int32 Y, int32 DX, int32 DY) const
+{
+    // بدون بریدن گوشه: همسایه کناری که پشتش (نسبت به جهت حرکت) مسدود بوده فقط از این سلول قابل رسیدن است
+    if (DX != 0)
+    {
+        return (IsWalkable(X, Y - 1) && !IsWalkable(X - DX, Y - 1))
+            || (IsWalkable(X, Y + 1) && !IsWalkable(X - DX, Y + 1));
+    }
+    return (IsWalkable(X - 1, Y) && !IsWalkable(X - 1, Y - DY))
+        || (IsWalkable(X + 1, Y) && !IsWalkable(X + 1, Y - DY));
+}
+
+void FGridJumpPointSearch::BuildJumpTable()
+{
+    JumpDistance.Reset();
+    WalkableRun.Reset();
+
+    // فاصله‌ها در int16 نگه داشته می‌شوند
+    if (!Walkable || Width <= 0 || Height <= 0 || Width > MAX_int16 || Height > MAX_int16)
+        return;
+
+    const int32 NumCells = Width * Height;
+    JumpDistance.SetNumUninitialized(NumStraightDirs * NumCells);
+    WalkableRun.SetNumUninitialized(NumStraightDirs * NumCells);
+
+    const FIntPoint Steps[NumStraightDirs] = { FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1) };
+
+    for (int32 Dir = 0; Dir < NumStraightDirs; Dir++)
+    {
+        const int32 DX = Steps[Dir].X;
+        const int32 DY = Steps[Dir].Y;
+        int16* Jump = JumpDistance.GetData() + Dir * NumCells;
+        int16* Run = WalkableRun.GetData() + Dir * NumCells;
+
+        // پیمایش خلاف جهت حرکت تا مقدار سلول بعدی همیشه آماده باشد
+        const int32 XStart = DX > 0 ? Width - 1 : 0;
+        const int32 XStep = DX > 0 ? -1 : 1;
+        const int32 YStart = DY > 0 ? Height - 1 : 0;
+        const int32 YStep = DY > 0 ? -1 : 1;
+
+        for (int32 Row = 0, Y = YStart; Row < Height; Row++, Y += YStep)
+        {
+            for (int32 Column = 0, X = XStart; Column < Width; Column++, X += XStep)
+            {
+                const int32 Index = Y * Width + X;
+                if (!(*Walkable)[Index])
+                {
+                    Run[Index] = 0;
+                    Jump[Index] = -1;
+                    continue;
+                }
+
+                const int32 NextX = X + DX;
+                const int32 NextY = Y + DY;
+                const bool bNextInside = NextX >= 0 && NextY >= 0 && NextX < Width && NextY < Height;
+                const int32 Next = NextY * Width + NextX;
+
+                Run[Index] = 1 + (bNextInside ? Run[Next] : 0);
+                if (HasForcedNeighbour(X, Y, DX, DY))
+                {
+                    Jump[Index] = 0;
+                }
+                else
+                {
+                    Jump[Index] = (bNextInside && Jump[Next] >= 0) ? Jump[Next] + 1 : -1;
+                }
+            }
+        }
+    }
+}
+
+int32 FGridJumpPointSearch::JumpStraight(int32 X, int32 Y, int32 DX, int32 DY) const
+{
+    if (bSearchUsesJumpTable)
+    {
+        if (!IsWalkable(X, Y))
+            return INDEX_NONE;
+
+        const int32 Dir = DX > 0 ? East : DX < 0 ? West : DY > 0 ? North : South;
+        const int32 TableIndex = Dir * Width * Height + Y * Width + X;
+        const int32 Run = WalkableRun[TableIndex];
+        const int32 Jump = JumpDistance[TableIndex];
+
+        // جدول مستقل از مقصد است → مقصدی که روی همین خط و قبل از دیوار/Jump Point باشد جداگانه
+        const int32 GoalSteps = DX != 0
+            ? (GoalCell.Y == Y ? (GoalCell.X - X) * DX : -1)
+            : (GoalCell.X == X ? (GoalCell.Y - Y) * DY : -1);
+        if (GoalSteps >= 0 && GoalSteps < Run && (Jump < 0 || GoalSteps <= Jump))
+            return GoalCell.Y * Width + GoalCell.X;
+
+        return Jump >= 0 ? (Y + Jump * DY) * Width + (X + Jump * DX) : INDEX_NONE;
+    }
+
+    while (IsWalkable(X, Y))
+    {
+        if (IsTargetCell(X, Y) || HasForcedNeighbour(X, Y, DX, DY))
+            return Y * Width + X;
+
+        X += DX;
+        Y += DY;
+    }
+    return INDEX_NONE;
+}
+
+int32 FGridJumpPointSearch::JumpDiagonal(int32 X, int32 Y, int32 DX, int32 DY) const
+{
+    while (IsWalkable(X, Y))
+    {
+        if (IsTargetCell(X, Y))
+            return Y * Width + X;
+
+        // هر پرش مستقیمی که از این سلول به جایی برسد آن را Jump Point می‌کند
+        if (JumpStraight(X + DX, Y, DX, 0) != INDEX_NONE || JumpStraight(X, Y + DY, 0, DY) != INDEX_NONE)
+            return Y * Width + X;
+
+        // بدون بریدن گوشه: هر دو همسایه مستقیم باید باز باشند
+        if (!IsWalkable(X + DX, Y) || !IsWalkable(X, Y + DY))
+            return INDEX_NONE;
+
+        X += DX;
+        Y += DY;
+    }
+    return INDEX_NONE;
+}
+
+bool FGridJumpPointSearch::IsOpenEntryBetter(const FOpenEntry& A, const FOpenEntry& B)
+{
+    // F کمتر اول؛ در F برابر گره عمیق‌تر (نزدیک‌تر به مقصد)
+    return A.F != B.F ? A.F < B.F : A.G > B.G;
+}
+
+void FGridJumpPointSearch::AddSuccessor(int32 Node, int32 Successor)
+{
+    FNodeState& State = Nodes[Successor];
+    if (State.Generation != Generation)
+    {
+        State.G = TNumericLimits<float>::Max();
+        State.Parent = INDEX_NONE;
+        State.Generation = Generation;
+        State.bClosed = false;
+    }
+    if (State.bClosed)
+        return;
+
+    const int32 X = Node % Width;
+    const int32 Y = Node / Width;
+    const int32 SX = Successor % Width;
+    const int32 SY = Successor / Width;
+
+    const float G = Nodes[Node].G + GridJumpPoint::OctileDistance(SX - X, SY - Y);
+    if (G >= State.G)
+        return;
+
+    State.G = G;
+    State.Parent = Node;
+
+    // ورودی‌های قدیمی همین گره در Heap می‌مانند و موقع Pop رد می‌شوند
+    FOpenEntry Entry;
+    Entry.G = G;
+    Entry.F = G + Heuristic(SX, SY);
+    Entry.Node = Successor;
+    OpenList.HeapPush(Entry, &FGridJumpPointSearch::IsOpenEntryBetter);
+}
+
+float FGridJumpPointSearch::Heuristic(int32 X, int32 Y) const
+{
+    return bMultiTarget ? 0.f : GridJumpPoint::OctileDistance(GoalCell.X - X, GoalCell.Y - Y);
+}
+
+void FGridJumpPointSearch::BeginSearch(const FIntPoint& Start)
+{
+    if (Nodes.Num() < Width * Height)
+    {
+        Nodes.SetNum(Width * Height);
+    }
+
+    // نسل جدید = همه گره‌ها دست‌نخورده؛ فقط وقتی شمارنده دور بزند پاک می‌شوند
+    if (++Generation == 0)
+    {
+        for (FNodeState& State : Nodes)
+        {
+            State.Generation = 0;
+        }
+        Generation = 1;
+    }
+
+    OpenList.Reset();
+
+    const int32 StartIndex = Start.Y * Width + Start.X;
+    FNodeState& StartState = Nodes[StartIndex];
+    StartState.G = 0.f;
+    StartState.Parent = INDEX_NONE;
+    StartState.Generation = Generation;
+    StartState.bClosed = false;
+
+    FOpenEntry StartEntry;
+    StartEntry.F = Heuristic(Start.X, Start.Y);
+    StartEntry.Node = StartIndex;
+    OpenList.Add(StartEntry);
+}
+
+void FGridJumpPointSearch::ExpandNode(int32 Node)
+{
+    const FNodeState& Current = Nodes[Node];
+    const int32 X = Node % Width;
+    const int32 Y = Node / Width;
+
+    // جهت‌های هرس‌شده (قوانین JPS بدون بریدن گوشه)؛ گره شروع همه هشت جهت را دارد
+    FIntPoint Directions[8];
+    int32 NumDirections = 0;
+
+    if (Current.Parent == INDEX_NONE)
+    {
+        for (int32 DY = -1; DY <= 1; DY++)
+        {
+            for (int32 DX = -1; DX <= 1; DX++)
+            {
+                if ((DX != 0 || DY != 0) && IsWalkable(X + DX, Y + DY)
+                    && (DX == 0 || DY == 0 || (IsWalkable(X + DX, Y) && IsWalkable(X, Y + DY))))
+                {
+                    Directions[NumDirections++] = FIntPoint(DX, DY);
+                }
+            }
+        }
+    }
+    else
+    {
+        const int32 DX = FMath::Sign(X - Current.Parent % Width);
+        const int32 DY = FMath::Sign(Y - Current.Parent / Width);
+
+        if (DX != 0 && DY != 0)
+        {
+            const bool bVertical = IsWalkable(X, Y + DY);
+            const bool bHorizontal = IsWalkable(X + DX, Y);
+            if (bVertical) Directions[NumDirections++] = FIntPoint(0, DY);
+            if (bHorizontal) Directions[NumDirections++] = FIntPoint(DX, 0);
+            if (bVertical && bHorizontal) Directions[NumDirections++] = FIntPoint(DX, DY);
+        }
+        else if (DX != 0)
+        {
+            const bool bNext = IsWalkable(X + DX, Y);
+            const bool bUp = IsWalkable(X, Y + 1);
+            const bool bDown = IsWalkable(X, Y - 1);
+            if (bNext)
+            {
+                Directions[NumDirections++] = FIntPoint(DX, 0);
+                if (bUp) Directions[NumDirections++] = FIntPoint(DX, 1);
+                if (bDown) Directions[NumDirections++] = FIntPoint(DX, -1);
+            }
+            if (bUp) Directions[NumDirections++] = FIntPoint(0, 1);
+            if (bDown) Directions[NumDirections++] = FIntPoint(0, -1);
+        }
+        else
+        {
+            const bool bNext = IsWalkable(X, Y + DY);
+            const bool bRight = IsWalkable(X + 1, Y);
+            const bool bLeft = IsWalkable(X - 1, Y);
+            if (bNext)
+            {
+                Directions[NumDirections++] = FIntPoint(0, DY);
+                if (bRight) Directions[NumDirections++] = FIntPoint(1, DY);
+                if (bLeft) Directions[NumDirections++] = FIntPoint(-1, DY);
+            }
+            if (bRight) Directions[NumDirections++] = FIntPoint(1, 0);
+            if (bLeft) Directions[NumDirections++] = FIntPoint(-1, 0);
+        }
+    }
+
+    for (int32 DirIndex = 0; DirIndex < NumDirections; DirIndex++)
+    {
+        const FIntPoint& Dir = Directions[DirIndex];
+        const int32 JumpPoint = (Dir.X != 0 && Dir.Y != 0)
+            ? JumpDiagonal(X + Dir.X, Y + Dir.Y, Dir.X, Dir.Y)
+            : JumpStraight(X + Dir.X, Y + Dir.Y, Dir.X, Dir.Y);
+
+        if (JumpPoint != INDEX_NONE)
+        {
+            AddSuccessor(Node, JumpPoint);
+        }
+    }
+}
+
+bool FGridJumpPointSearch::FindPath(const FIntPoint& Start, const FIntPoint& Goal, TArray<FIntPoint>& OutPoints, bool bUseJumpTable)
+{
+    OutPoints.Reset();
+    LastExpandedNodes = 0;
+
+    if (!Walkable || !IsWalkable(Start.X, Start.Y) || !IsWalkable(Goal.X, Goal.Y))
+        return false;
+
+    GoalCell = Goal;
+    bMultiTarget = false;
+    bSearchUsesJumpTable = bUseJumpTable && HasJumpTable();
+    BeginSearch(Start);
+
+    const int32 GoalIndex = Goal.Y * Width + Goal.X;
+
+    while (OpenList.Num() > 0)
+    {
+        FOpenEntry Entry;
+        OpenList.HeapPop(Entry, &FGridJumpPointSearch::IsOpenEntryBetter, EAllowShrinking::No);
+
+        FNodeState& Current = Nodes[Entry.Node];
+        if (Current.bClosed || Entry.G > Current.G)
+            continue;
+
+        Current.bClosed = true;
+        LastExpandedNodes++;
+
+        if (Entry.Node == GoalIndex)
+        {
+            for (int32 Node = GoalIndex; Node != INDEX_NONE; Node = Nodes[Node].Parent)
+            {
+                OutPoints.Add(FIntPoint(Node % Width, Node / Width));
+            }
+            Algo::Reverse(OutPoints);
+            return true;
+        }
+
+        ExpandNode(Entry.Node);
+    }
+
+    return false;
+}
+
+bool FGridJumpPointSearch::FindPathsToSource(const FIntPoint& Source, TConstArrayView<FIntPoint> Targets, TArray<TArray<FIntPoint>>& OutPaths)
+{
+    OutPaths.Reset();
+    OutPaths.SetNum(Targets.Num());
+    LastExpandedNodes = 0;
+
+    if (!Walkable || !IsWalkable(Source.X, Source.Y))
+        return false;
+
+    if (TargetMask.Num() != Width * Height)
+    {
+        TargetMask.Init(false, Width * Height);
+    }
+
+    int32 NumRemaining = 0;
+    for (const FIntPoint& Target : Targets)
+    {
+        if (IsWalkable(Target.X, Target.Y) && !TargetMask[Target.Y * Width + Target.X])
+        {
+            TargetMask[Target.Y * Width + Target.X] = true;
+            NumRemaining++;
+        }
+    }
+
+    // حرکت‌ها متقارن‌اند، پس درخت کوتاه‌ترین مسیر از Source همان مسیرهای رو به Source است
+    bMultiTarget = true;
+    bSearchUsesJumpTable = false;
+    BeginSearch(Source);
+
+    while (NumRemaining > 0 && OpenList.Num() > 0)
+    {
+        FOpenEntry Entry;
+        OpenList.HeapPop(Entry, &FGridJumpPointSearch::IsOpenEntryBetter, EAllowShrinking::No);
+
+        FNodeState& Current = Nodes[Entry.Node];
+        if (Current.bClosed || Entry.G > Current.G)
+            continue;
+
+        Current.bClosed = true;
+        LastExpandedNodes++;
+
+        if (TargetMask[Entry.Node])
+        {
+            NumRemaining--;
+        }
+
+        ExpandNode(Entry.Node);
+    }
+
+    bool bAnyPath = false;
+    for (int32 TargetIndex = 0; TargetIndex < Targets.Num(); TargetIndex++)
+    {
+        const FIntPoint& Target = Targets[TargetIndex];
+        if (!IsWalkable(Target.X, Target.Y))
+            continue;
+
+        const int32 TargetNode = Target.Y * Width + Target.X;
+        TargetMask[TargetNode] = false;
+
+        const FNodeState& State = Nodes[TargetNode];
+        if (State.Generation != Generation || !State.bClosed)
+            continue;
+
+        for (int32 Node = TargetNode; Node != INDEX_NONE; Node = Nodes[Node].Parent)
+        {
+            OutPaths[TargetIndex].Add(FIntPoint(Node % Width, Node / Width));
+        }
+        bAnyPath = true;
+    }
+
+    bMultiTarget = false;
+    return bAnyPath;
+}
@@ -1,9 +1,106 @@
 #include "Ai/GridPathfinderComponent.h"
+#include "AI/UGridPathRequestSubsystem.h"
+#include "AI/UWalkabilityCacheSubsystem.h"
 #include "GameFramework/Pawn.h"
 #include "NavigationSystem.h"
 #include "NavMesh/RecastNavMesh.h"
-#include "DrawDebugHelpers.h"
+#include "AI/UAIDebugDrawSubsystem.h"
 #include "Components/CapsuleComponent.h"
+#include "Engine/OverlapResult.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+
+namespace GridPathBenchmark
+{
+    struct FStats
+    {
+        double TotalMs = 0.0;
+        double TotalLength = 0.0;
+        int32 NumFound = 0;
+
+        void Add(double Ms, const TArray<FVector>& Path)
+        {
+            TotalMs += Ms;
+            if (Path.Num() < 2) return;
+
+            NumFound++;
+            for (int32 i = 1; i < Path.Num(); i++)
+            {
+                TotalLength += FVector::Dist(Path[i - 1], Path[i]);
+            }
+        }
+
+        void Log(const TCHAR* Name, int32 NumPairs) const
+        {
+            UE_LOG(LogTemp, Log, TEXT("GridPath benchmark %-14s: %.3f ms/query, %d/%d found, avg length %.0f cm"),
+                Name, TotalMs / FMath::Max(NumPairs, 1), NumFound, NumPairs, NumFound > 0 ? TotalLength / NumFound : 0.0);
+        }
+    };
+
+    // ai.GridPath.Benchmark [NumPairs] [RadiusCm]
+    // جفت نقاط تصادفی قابل دسترس اطراف اولین Pawn بازیکن؛ هر جفت با NavMesh، JPS و JPS+ (سرد = با ساخت پنجره، گرم = تکرار همان جفت)
+    void Run(const TArray<FString>& Args, UWorld* World)
+    {
+        UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+        UWalkabilityCacheSubsystem* WalkabilityCache = World ? World->GetSubsystem<UWalkabilityCacheSubsystem>() : nullptr;
+        if (!NavSys || !WalkabilityCache)
+        {
+            UE_LOG(LogTemp, Warning, TEXT("GridPath benchmark: Navigation system or walkability cache missing."));
+            return;
+        }
+
+        const int32 NumPairs = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100;
+        const float Radius = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 5000.f;
+
+        const APawn* Pawn = UGameplayStatics::GetPlayerPawn(World, 0);
+        const FVector Origin = Pawn ? Pawn->GetActorLocation() : FVector::ZeroVector;
+
+        FStats NavMesh, JumpPointCold, JumpPointWarm, JumpPointPlusCold, JumpPointPlusWarm;
+        int64 ExpandedNodes = 0;
+        TArray<FVector> GridPath;
+
+        for (int32 PairIndex = 0; PairIndex < NumPairs; PairIndex++)
+        {
+            FNavLocation A, B;
+            if (!NavSys->GetRandomReachablePointInRadius(Origin, Radius, A) || !NavSys->GetRandomReachablePointInRadius(Origin, Radius, B))
+                continue;
+
+            double Begin = FPlatformTime::Seconds();
+            const UNavigationPath* NavPath = NavSys->FindPathToLocationSynchronously(World, A.Location, B.Location);
+            NavMesh.Add((FPlatformTime::Seconds() - Begin) * 1000.0, NavPath ? NavPath->PathPoints : TArray<FVector>());
+
+            // سرد: پنجره جفت جدید (و برای JPS+ جدولش) ساخته می‌شود؛ تایل‌های کش مثل بازی واقعی گرم می‌مانند
+            Begin = FPlatformTime::Seconds();
+            WalkabilityCache->FindGridPath(A.Location, B.Location, 0.f, false, GridPath);
+            JumpPointCold.Add((FPlatformTime::Seconds() - Begin) * 1000.0, GridPath);
+
+            Begin = FPlatformTime::Seconds();
+            WalkabilityCache->FindGridPath(A.Location, B.Location, 0.f, false, GridPath);
+            JumpPointWarm.Add((FPlatformTime::Seconds() - Begin) * 1000.0, GridPath);
+            ExpandedNodes += WalkabilityCache->GetLastGridPathExpandedNodes();
+
+            Begin = FPlatformTime::Seconds();
+            WalkabilityCache->FindGridPath(A.Location, B.Location, 0.f, true, GridPath);
+            JumpPointPlusCold.Add((FPlatformTime::Seconds() - Begin) * 1000.0, GridPath);
+
+            Begin = FPlatformTime::Seconds();
+            WalkabilityCache->FindGridPath(A.Location, B.Location, 0.f, true, GridPath);
+            JumpPointPlusWarm.Add((FPlatformTime::Seconds() - Begin) * 1000.0, GridPath);
+        }
+
+        NavMesh.Log(TEXT("NavMesh"), NumPairs);
+        JumpPointCold.Log(TEXT("JPS (cold)"), NumPairs);
+        JumpPointWarm.Log(TEXT("JPS (warm)"), NumPairs);
+        JumpPointPlusCold.Log(TEXT("JPS+ (cold)"), NumPairs);
+        JumpPointPlusWarm.Log(TEXT("JPS+ (warm)"), NumPairs);
+        UE_LOG(LogTemp, Log, TEXT("GridPath benchmark: %.1f expanded nodes per JPS query."), (double)ExpandedNodes / NumPairs);
+    }
+}
+
+static FAutoConsoleCommandWithWorldAndArgs GridPathBenchmarkCommand(
+    TEXT("ai.GridPath.Benchmark"),
+    TEXT("Times navmesh, JPS and JPS+ paths between random reachable points. Args: [NumPairs=100] [RadiusCm=5000]"),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&GridPathBenchmark::Run));
 
 void UGridPathfinderComponent::BeginPlay()
 {
@@ -34,27 +131,28 @@ UGridPathfinderComponent::UGridPathfinderComponent()
 
 bool UGridPathfinderComponent::IsLocationWalkable(const FVector& Location) const
 {
-    if (!GetWorld()) return false;
-
-    // ۱) چک NavMesh
-    UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
-    if (!NavSys) return false;
+    UWorld* World = GetWorld();
+    if (!World) return false;
 
-    FNavLocation NavLocation;
-    if (!NavSys->ProjectPointToNavigation(Location, NavLocation))
+    // ۱) NavMesh و موانع ثابت: یک بیت از تایل کش‌شده (تایل اولین بار یک‌جا ساخته می‌شود)
+    if (UWalkabilityCacheSubsystem* WalkabilityCache = World->GetSubsystem<UWalkabilityCacheSubsystem>())
     {
-        return false; // نقطه خارج از NavMesh است
+        if (!WalkabilityCache->IsWalkable(Location, GetWalkabilityClearance(*WalkabilityCache)))
+            return false;
+    }
+    else if (!IsLocationStaticallyWalkable(World, Location, CharacterRadius * 0.9f))
+    {
+        return false;
     }
 
-    // ۲) چک Collision (مانع فیزیکی یا یونیت سر راه)
+    // ۲) یونیت‌ها متحرک‌اند و کش نمی‌شوند → فقط Overlap کانال یونیت‌ها
     FCollisionObjectQueryParams ObjectQueryParams;
-    ObjectQueryParams.AddObjectTypesToQuery(ECollisionChannel::ECC_GameTraceChannel1); // موانع
     ObjectQueryParams.AddObjectTypesToQuery(ECollisionChannel::ECC_GameTraceChannel2); // یونیت‌ها
 
     FCollisionQueryParams QueryParams;
     QueryParams.AddIgnoredActor(GetOwner());
 
-    bool bBlocked = GetWorld()->OverlapAnyTestByObjectType(
+    bool bBlocked = World->OverlapAnyTestByObjectType(
         Location,
         FQuat::Identity,
         ObjectQueryParams,
@@ -65,8 +163,38 @@ bool UGridPathfinderComponent::IsLocationWalkable(const FVector& Location) const
     return !bBlocked;
 }
 
+bool UGridPathfinderComponent::IsLocationStaticallyWalkable(const UWorld* World, const FVector& Location, float ObstacleInflation)
+{
+    // ۱) چک NavMesh
+    UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+    if (!NavSys) return false;
+
+    FNavLocation NavLocation;
+    if (!NavSys->ProjectPointToNavigation(Location, NavLocation))
+    {
+        return false; // نقطه خارج از NavMesh است
+    }
+
+    // ۲) چک Collision موانع ثابت
+    FCollisionObjectQueryParams ObjectQueryParams;
+    ObjectQueryParams.AddObjectTypesToQuery(ECollisionChannel::ECC_GameTraceChannel1); // موانع
+
+    return !World->OverlapAnyTestByObjectType(
+        Location,
+        FQuat::Identity,
+        ObjectQueryParams,
+        FCollisionShape::MakeSphere(ObstacleInflation)
+    );
+}
+
 bool UGridPathfinderComponent::FindClosestWalkable(const FVector& Origin, FVector& OutLocation) const
 {
+	// اول جستجوی حلقه‌ای روی بیت‌های کش (بدون Query ناوبری)
+	if (UWalkabilityCacheSubsystem* WalkabilityCache = GetWorld() ? GetWorld()->GetSubsystem<UWalkabilityCacheSubsystem>() : nullptr)
+	{
+		return WalkabilityCache->FindClosestWalkable(Origin, this->SearchRadius, OutLocation, GetWalkabilityClearance(*WalkabilityCache));
+	}
+
 	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
 	if (!NavSys) return false;
 
@@ -80,44 +208,236 @@ bool UGridPathfinderComponent::FindClosestWalkable(const FVector& Origin, FVecto
 	return false;
 }
 
-TArray<FVector> UGridPathfinderComponent::FindPathShared(const FVector& StartWorld, const FVector& GoalWorld)
+bool UGridPathfinderComponent::GatherWalkabilityGeometry(const FBox& Bounds, FWalkabilityGeometry& OutGeometry) const
 {
-    TArray<FVector> FinalPath;
+    // همان شعاع تست Overlap در IsLocationWalkable
+    return GatherWorldWalkabilityGeometry(GetWorld(), Bounds, CharacterRadius * 0.9f, EWalkabilityLayers::All, GetOwner(), OutGeometry);
+}
 
-    // --- مرحله ۰: تست مسیر مستقیم ---
+bool UGridPathfinderComponent::GatherWorldWalkabilityGeometry(
+    const UWorld* World,
+    const FBox& Bounds,
+    float ObstacleInflation,
+    EWalkabilityLayers Layers,
+    const AActor* IgnoredActor,
+    FWalkabilityGeometry& OutGeometry)
+{
+    OutGeometry = FWalkabilityGeometry();
+    OutGeometry.ObstacleInflation = ObstacleInflation;
+
+    if (!World) return false;
+
+    // ۱) پلی‌های NavMesh داخل محدوده (یک Query برای کل گرید)
+    if (EnumHasAnyFlags(Layers, EWalkabilityLayers::NavMesh))
+    {
+        UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+        if (!NavSys) return false;
+
+        const ARecastNavMesh* NavMesh = Cast<ARecastNavMesh>(NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate));
+        if (!NavMesh) return false;
+
+        TArray<FNavPoly> Polys;
+        NavMesh->GetPolysInBox(Bounds, Polys);
+
+        OutGeometry.PolyStart.Reserve(Polys.Num() + 1);
+        OutGeometry.PolyStart.Add(0);
+
+        TArray<FVector> PolyVerts;
+        for (const FNavPoly& Poly : Polys)
+        {
+            PolyVerts.Reset();
+            if (!NavMesh->GetPolyVerts(Poly.Ref, PolyVerts) || PolyVerts.Num() < 3)
+                continue;
+
+            for (const FVector& V : PolyVerts)
+            {
+                OutGeometry.PolyVerts.Add(FVector2D(V.X, V.Y));
+            }
+            OutGeometry.PolyStart.Add(OutGeometry.PolyVerts.Num());
+        }
+    }
+
+    // ۲) موانع و یونیت‌ها با یک Overlap روی کل محدوده
+    FCollisionObjectQueryParams ObjectQueryParams;
+    if (EnumHasAnyFlags(Layers, EWalkabilityLayers::StaticObstacles))
     {
-        FCollisionObjectQueryParams ObjectQueryParams;
         ObjectQueryParams.AddObjectTypesToQuery(ECollisionChannel::ECC_GameTraceChannel1); // موانع
+    }
+    if (EnumHasAnyFlags(Layers, EWalkabilityLayers::Units))
+    {
         ObjectQueryParams.AddObjectTypesToQuery(ECollisionChannel::ECC_GameTraceChannel2); // یونیت‌ها
+    }
+    if (!ObjectQueryParams.IsValid())
+        return true;
+
+    FCollisionQueryParams QueryParams;
+    QueryParams.AddIgnoredActor(IgnoredActor);
+
+    TArray<FOverlapResult> Overlaps;
+    World->OverlapMultiByObjectType(
+        Overlaps,
+        Bounds.GetCenter(),
+        FQuat::Identity,
+        ObjectQueryParams,
+        FCollisionShape::MakeBox(Bounds.GetExtent()),
+        QueryParams
+    );
+
+    OutGeometry.Obstacles.Reserve(Overlaps.Num());
+    for (const FOverlapResult& Overlap : Overlaps)
+    {
+        const UPrimitiveComponent* Comp = Overlap.GetComponent();
+        if (!Comp) continue;
+
+        FWalkabilityGeometry::FObstacleBox& Obstacle = OutGeometry.Obstacles.AddDefaulted_GetRef();
+        Obstacle.LocalToWorld = Comp->GetComponentTransform();
+        Obstacle.LocalBox = Comp->CalcBounds(FTransform::Identity).GetBox();
+        Obstacle.WorldBounds = Comp->Bounds.GetBox().ExpandBy(OutGeometry.ObstacleInflation);
+    }
+
+    return true;
+}
 
-        FCollisionQueryParams QueryParams;
-        QueryParams.AddIgnoredActor(GetOwner());
-
-        FHitResult HitResult;
-        bool bBlocked = GetWorld()->SweepSingleByObjectType(
-            HitResult,
-            StartWorld,
-            GoalWorld,
-            FQuat::Identity,
-            ObjectQueryParams,
-            FCollisionShape::MakeSphere(CharacterRadius),
-            QueryParams
-        );
-
-        if (!bBlocked)
+// محدوده سلول‌هایی که مرکزشان داخل مستطیل XY داده شده است
+static bool GetRasterCellRange(
+    const FVector2D& GridOrigin,
+    double InvCellSize,
+    int32 Width,
+    int32 Height,
+    const FVector2D& BoundsMin,
+    const FVector2D& BoundsMax,
+    FIntPoint& OutMin,
+    FIntPoint& OutMax)
+{
+    OutMin.X = FMath::Max(0, FMath::CeilToInt((BoundsMin.X - GridOrigin.X) * InvCellSize - 0.5));
+    OutMin.Y = FMath::Max(0, FMath::CeilToInt((BoundsMin.Y - GridOrigin.Y) * InvCellSize - 0.5));
+    OutMax.X = FMath::Min(Width - 1, FMath::FloorToInt((BoundsMax.X - GridOrigin.X) * InvCellSize - 0.5));
+    OutMax.Y = FMath::Min(Height - 1, FMath::FloorToInt((BoundsMax.Y - GridOrigin.Y) * InvCellSize - 0.5));
+    return OutMin.X <= OutMax.X && OutMin.Y <= OutMax.Y;
+}
+
+void UGridPathfinderComponent::RasterizeWalkability(
+    const FWalkabilityGeometry& Geometry,
+    const FVector2D& GridOrigin,
+    float CellSize,
+    int32 Width,
+    int32 Height,
+    TBitArray<>& OutWalkable)
+{
+    OutWalkable.Init(false, FMath::Max(0, Width * Height));
+    if (Width <= 0 || Height <= 0 || CellSize <= 0.f) return;
+
+    const double InvCellSize = 1.0 / CellSize;
+
+    // ۱) NavMesh: سلولی که مرکزش داخل یک پلی (پلی‌های Recast محدب هستند) باشد قابل عبور است
+    for (int32 PolyIndex = 0; PolyIndex < Geometry.NumPolys(); ++PolyIndex)
+    {
+        const int32 First = Geometry.PolyStart[PolyIndex];
+        const int32 NumVerts = Geometry.PolyStart[PolyIndex + 1] - First;
+        const FVector2D* Verts = Geometry.PolyVerts.GetData() + First;
+
+        FVector2D PolyMin = Verts[0];
+        FVector2D PolyMax = Verts[0];
+        double TwiceArea = 0.0;
+        for (int32 i = 0; i < NumVerts; ++i)
         {
-            UE_LOG(LogTemp, Log, TEXT("Direct path is clear. Returning straight line."));
+            const FVector2D& A = Verts[i];
+            const FVector2D& B = Verts[(i + 1) % NumVerts];
+            PolyMin = FVector2D::Min(PolyMin, A);
+            PolyMax = FVector2D::Max(PolyMax, A);
+            TwiceArea += FVector2D::CrossProduct(A, B);
+        }
 
-            FinalPath.Add(StartWorld);
-            FinalPath.Add(GoalWorld);
+        FIntPoint CellMin, CellMax;
+        if (!GetRasterCellRange(GridOrigin, InvCellSize, Width, Height, PolyMin, PolyMax, CellMin, CellMax)) continue;
 
-            // برای دیدن دیباگ
-            DrawDebugLine(GetWorld(), StartWorld, GoalWorld, FColor::Black, false, 5.f, 0, 3.f);
+        // جهت چرخش رئوس (برای اینکه تست داخل بودن به ترتیب رئوس وابسته نباشد)
+        const double Winding = TwiceArea >= 0.0 ? 1.0 : -1.0;
 
-            return FinalPath; // مسیر مستقیم برمی‌گردونیم
+        for (int32 y = CellMin.Y; y <= CellMax.Y; ++y)
+        {
+            const double CenterY = GridOrigin.Y + (y + 0.5) * CellSize;
+            for (int32 x = CellMin.X; x <= CellMax.X; ++x)
+            {
+                const int32 Index = y * Width + x;
+                if (OutWalkable[Index]) continue;
+
+                const double CenterX = GridOrigin.X + (x + 0.5) * CellSize;
+                bool bInside = true;
+                for (int32 i = 0; i < NumVerts && bInside; ++i)
+                {
+                    const FVector2D& A = Verts[i];
+                    const FVector2D& B = Verts[(i + 1) % NumVerts];
+                    const double Side = (B.X - A.X) * (CenterY - A.Y) - (B.Y - A.Y) * (CenterX - A.X);
+                    bInside = Side * Winding >= 0.0;
+                }
+
+                if (bInside)
+                {
+                    OutWalkable[Index] = true;
+                }
+            }
         }
     }
 
+    // ۲) موانع
+    RasterizeObstacles(Geometry, GridOrigin, CellSize, Width, Height, OutWalkable);
+}
+
+void UGridPathfinderComponent::RasterizeObstacles(
+    const FWalkabilityGeometry& Geometry,
+    const FVector2D& GridOrigin,
+    float CellSize,
+    int32 Width,
+    int32 Height,
+    TBitArray<>& InOutWalkable)
+{
+    if (Width <= 0 || Height <= 0 || CellSize <= 0.f || InOutWalkable.Num() != Width * Height) return;
+
+    const double InvCellSize = 1.0 / CellSize;
+
+    // سلولی که مرکزش (در XY) نزدیک‌تر از Inflation به جعبه مانع باشد مسدود است
+    const double InflationSq = FMath::Square((double)Geometry.ObstacleInflation);
+    for (const FWalkabilityGeometry::FObstacleBox& Obstacle : Geometry.Obstacles)
+    {
+        FIntPoint CellMin, CellMax;
+        const FVector2D BoundsMin(Obstacle.WorldBounds.Min.X, Obstacle.WorldBounds.Min.Y);
+        const FVector2D BoundsMax(Obstacle.WorldBounds.Max.X, Obstacle.WorldBounds.Max.Y);
+        if (!GetRasterCellRange(GridOrigin, InvCellSize, Width, Height, BoundsMin, BoundsMax, CellMin, CellMax)) continue;
+
+        const double SampleZ = Obstacle.LocalToWorld.TransformPosition(Obstacle.LocalBox.GetCenter()).Z;
+
+        for (int32 y = CellMin.Y; y <= CellMax.Y; ++y)
+        {
+            const double CenterY = GridOrigin.Y + (y + 0.5) * CellSize;
+            for (int32 x = CellMin.X; x <= CellMax.X; ++x)
+            {
+                const int32 Index = y * Width + x;
+                if (!InOutWalkable[Index]) continue;
+
+                const FVector CellWorld(GridOrigin.X + (x + 0.5) * CellSize, CenterY, SampleZ);
+                const FVector LocalPoint = Obstacle.LocalToWorld.InverseTransformPosition(CellWorld);
+                const FVector Closest = Obstacle.LocalToWorld.TransformPosition(Obstacle.LocalBox.GetClosestPointTo(LocalPoint));
+
+                if (FVector::DistSquaredXY(CellWorld, Closest) <= InflationSq)
+                {
+                    InOutWalkable[Index] = false;
+                }
+            }
+        }
+    }
+}
+
+TArray<FVector> UGridPathfinderComponent::FindPathShared(const FVector& StartWorld, const FVector& GoalWorld)
+{
+    TArray<FVector> FinalPath;
+
+    // --- مرحله ۰: تست مسیر مستقیم ---
+    if (FindDirectPath(StartWorld, GoalWorld, FinalPath))
+    {
+        return FinalPath; // مسیر مستقیم برمی‌گردونیم
+    }
+
     // --- مرحله ۱: NavMesh Path ---
     UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
     if (!NavSys) 
@@ -126,14 +446,19 @@ TArray<FVector> UGridPathfinderComponent::FindPathShared(const FVector& StartWor
         return FinalPath;
     }
 
-    FVector ActualGoal = GoalWorld;
-    if (!IsLocationWalkable(GoalWorld))
+    FVector ActualGoal;
+    if (!ResolveGoal(GoalWorld, ActualGoal))
     {
-        if (!FindClosestWalkable(GoalWorld, ActualGoal))
-        {
-            UE_LOG(LogTemp, Warning, TEXT("FindPathShared: Goal is not walkable."));
-            return FinalPath;
-        }
+        UE_LOG(LogTemp, Warning, TEXT("FindPathShared: Goal is not walkable."));
+        return FinalPath;
+    }
+
+    // در حالت گرید اول JPS؛ اگر پنجره کافی نبود یا مسیری نداشت همان NavMesh
+    TArray<FVector> GridPoints;
+    if (FindGridPath(StartWorld, ActualGoal, GridPoints))
+    {
+        UE_LOG(LogTemp, Log, TEXT("FindPathShared: Grid jump points: %d"), GridPoints.Num());
+        return FinalizeNavPath(GridPoints);
     }
 
     UNavigationPath* NavPath = NavSys->FindPathToLocationSynchronously(GetWorld(), StartWorld, ActualGoal);
@@ -146,21 +471,100 @@ TArray<FVector> UGridPathfinderComponent::FindPathShared(const FVector& StartWor
     UE_LOG(LogTemp, Log, TEXT("FindPathShared: Raw path points: %d"), NavPath->PathPoints.Num());
 
     // --- مرحله ۲: Resample قبل از Smooth ---
-    TArray<FVector> ResampledPath = ResamplePath(NavPath->PathPoints, CharacterRadius * 2.f);
-    FinalPath = ProcessFinalPath(ResampledPath);
+    FinalPath = FinalizeNavPath(NavPath->PathPoints);
 
     UE_LOG(LogTemp, Log, TEXT("FindPathShared: Final path points: %d"), FinalPath.Num());
 
     return FinalPath;
 }
 
-TArray<FVector> UGridPathfinderComponent::ProcessFinalPath(const TArray<FVector>& InputPath)
+uint32 UGridPathfinderComponent::FindPathAsync(const FVector& StartWorld, const FVector& GoalWorld, FOnGridPathComplete OnComplete, int32 Priority, uint32 SharedGoalGroup)
 {
-    TArray<FVector> SmoothedPath;
+    UWorld* World = GetWorld();
+    UGridPathRequestSubsystem* Requests = World ? World->GetSubsystem<UGridPathRequestSubsystem>() : nullptr;
+    if (!Requests)
+        return 0;
 
-    if(InputPath.Num() < 2)
-        return InputPath; // مسیر کوتاه یا خالی
+    return Requests->RequestPath(this, StartWorld, GoalWorld, Priority, MoveTemp(OnComplete), SharedGoalGroup);
+}
+
+void UGridPathfinderComponent::CancelPathRequest(uint32 RequestId)
+{
+    UWorld* World = GetWorld();
+    if (UGridPathRequestSubsystem* Requests = World ? World->GetSubsystem<UGridPathRequestSubsystem>() : nullptr)
+    {
+        Requests->CancelRequest(RequestId);
+    }
+}
+
+bool UGridPathfinderComponent::FindDirectPath(const FVector& StartWorld, const FVector& GoalWorld, TArray<FVector>& OutPath) const
+{
+    // یونیت‌ها در خط دید کش نیستند (جابه‌جا می‌شوند و Avoidance محلی از کنارشان رد می‌شود)
+    if (!IsLineClear(StartWorld, GoalWorld))
+        return false;
+
+    UE_LOG(LogTemp, Log, TEXT("Direct path is clear. Returning straight line."));
+
+    OutPath.Reset();
+    OutPath.Add(StartWorld);
+    OutPath.Add(GoalWorld);
+
+    // برای دیدن دیباگ
+    AIDebugDraw::Line(GetWorld(), EAIDebugChannel::Path, StartWorld, GoalWorld, FColor::Black, 5.f, 3.f);
+
+    return true;
+}
+
+bool UGridPathfinderComponent::ResolveGoal(const FVector& GoalWorld, FVector& OutGoal) const
+{
+    OutGoal = GoalWorld;
+    if (IsLocationWalkable(GoalWorld))
+        return true;
+
+    return FindClosestWalkable(GoalWorld, OutGoal);
+}
+
+bool UGridPathfinderComponent::FindGridPath(const FVector& StartWorld, const FVector& GoalWorld, TArray<FVector>& OutPoints) const
+{
+    if (PathfindingMode == EGridPathfindingMode::NavMesh)
+        return false;
+
+    UWalkabilityCacheSubsystem* WalkabilityCache = GetWorld() ? GetWorld()->GetSubsystem<UWalkabilityCacheSubsystem>() : nullptr;
+    if (!WalkabilityCache)
+        return false;
 
+    return WalkabilityCache->FindGridPath(StartWorld, GoalWorld, GetWalkabilityClearance(*WalkabilityCache), PathfindingMode == EGridPathfindingMode::JumpPointPlus, OutPoints);
+}
+
+bool UGridPathfinderComponent::FindGridPathsToGoal(TConstArrayView<FVector> StartsWorld, const FVector& GoalWorld, TArray<TArray<FVector>>& OutPoints) const
+{
+    if (PathfindingMode == EGridPathfindingMode::NavMesh)
+        return false;
+
+    UWalkabilityCacheSubsystem* WalkabilityCache = GetWorld() ? GetWorld()->GetSubsystem<UWalkabilityCacheSubsystem>() : nullptr;
+    if (!WalkabilityCache)
+        return false;
+
+    // جستجوی چند مقصدی Dijkstra است و جدول JPS+ را استفاده نمی‌کند
+    return WalkabilityCache->FindGridPathsToGoal(GoalWorld, StartsWorld, GetWalkabilityClearance(*WalkabilityCache), OutPoints);
+}
+
+float UGridPathfinderComponent::GetWalkabilityClearance(const UWalkabilityCacheSubsystem& WalkabilityCache) const
+{
+    return CharacterRadius * 0.9f - WalkabilityCache.GetObstacleInflation();
+}
+
+bool UGridPathfinderComponent::IsLineClear(const FVector& Start, const FVector& End) const
+{
+    if (UWalkabilityCacheSubsystem* WalkabilityCache = GetWorld() ? GetWorld()->GetSubsystem<UWalkabilityCacheSubsystem>() : nullptr)
+    {
+        return WalkabilityCache->HasLineOfSight(Start, End, GetWalkabilityClearance(*WalkabilityCache));
+    }
+    return IsSweepClear(Start, End);
+}
+
+bool UGridPathfinderComponent::IsSweepClear(const FVector& Start, const FVector& End) const
+{
     FCollisionObjectQueryParams ObjectQueryParams;
     ObjectQueryParams.AddObjectTypesToQuery(ECollisionChannel::ECC_GameTraceChannel1); // موانع
     ObjectQueryParams.AddObjectTypesToQuery(ECollisionChannel::ECC_GameTraceChannel2); // یونیت‌ها
@@ -168,38 +572,154 @@ TArray<FVector> UGridPathfinderComponent::ProcessFinalPath(const TArray<FVector>
     FCollisionQueryParams QueryParams;
     QueryParams.AddIgnoredActor(GetOwner());
 
+    FHitResult HitResult;
+    return !GetWorld()->SweepSingleByObjectType(
+        HitResult,
+        Start,
+        End,
+        FQuat::Identity,
+        ObjectQueryParams,
+        FCollisionShape::MakeSphere(CharacterRadius),
+        QueryParams
+    );
+}
+
+TArray<FVector> UGridPathfinderComponent::FinalizeNavPath(const TArray<FVector>& NavPoints)
+{
+    TArray<FVector> ResampledPath = ResamplePath(NavPoints, CharacterRadius * 2.f);
+    return ProcessFinalPath(ResampledPath);
+}
+
+TArray<FVector> UGridPathfinderComponent::StitchSharedPath(const FVector& StartWorld, const FVector& GoalWorld, const TArray<FVector>& SharedPath) const
+{
+    TArray<FVector> Stitched;
+    if (SharedPath.Num() < 2)
+        return Stitched;
+
+    Stitched.Reserve(SharedPath.Num() + 2);
+    Stitched.Add(StartWorld);
+
+    // StartWorld و SharedPath[0] روی همان پلی محدب‌اند، پس خط بینشان روی NavMesh است؛
+    // اگر تا نقطه دوم هم مستقیم باز باشد، نقطه اول مسیر مشترک حذف می‌شود (یک تست خط دید)
+    const bool bBlocked = !IsLineClear(StartWorld, SharedPath[1]);
+
+    Stitched.Append(SharedPath.GetData() + (bBlocked ? 0 : 1), SharedPath.Num() - (bBlocked ? 0 : 1));
+
+    // مقصد هم روی همان پلی محدب آخر است
+    if (!Stitched.Last().Equals(GoalWorld, 1.f))
+    {
+        Stitched.Add(GoalWorld);
+    }
+
+    return Stitched;
+}
+
+TArray<FVector> UGridPathfinderComponent::ProcessFinalPath(const TArray<FVector>& InputPath)
+{
+    TArray<FVector> SmoothedPath;
+
+    if(InputPath.Num() < 2)
+        return InputPath; // مسیر کوتاه یا خالی
+
+    // با کش Walkability: خط دید روی Bitmap (NavMesh + موانع ثابت با Inflation) و بدون هیچ Query فیزیکی
+    UWalkabilityCacheSubsystem* WalkabilityCache = GetWorld() ? GetWorld()->GetSubsystem<UWalkabilityCacheSubsystem>() : nullptr;
+    const float WalkabilityClearance = WalkabilityCache ? GetWalkabilityClearance(*WalkabilityCache) : 0.f;
+
+    // بدون کش: Raycast روی NavMesh برای جستجو، Sweep فیزیکی فقط برای تأیید پاره‌خط انتخاب‌شده
+    UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+    const ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate) : nullptr;
+    const FSharedConstNavQueryFilter NavFilter = NavData ? NavData->GetDefaultQueryFilter() : nullptr;
+
+    auto IsNavClear = [&](const FVector& Start, const FVector& End) -> bool
+    {
+        if (WalkabilityCache)
+            return WalkabilityCache->HasLineOfSight(Start, End, WalkabilityClearance);
+
+        if (!NavData)
+            return IsSweepClear(Start, End);
+
+        FVector HitLocation;
+        return !NavData->Raycast(Start, End, HitLocation, NavFilter, GetOwner());
+    };
+
+    // دورترین نقطه قابل دید در (Good, Bad) با جستجوی دودویی؛ فرض: اگر نقطه‌ای دیده شود، نقاط قبلش هم دیده می‌شوند
+    auto NarrowVisible = [](int32 Good, int32 Bad, TFunctionRef<bool(int32)> IsVisible) -> int32
+    {
+        while (Bad - Good > 1)
+        {
+            const int32 Mid = Good + (Bad - Good) / 2;
+            if (IsVisible(Mid)) Good = Mid;
+            else Bad = Mid;
+        }
+        return Good;
+    };
+
+    const int32 LastIndex = InputPath.Num() - 1;
     int32 StartIndex = 0;
     SmoothedPath.Add(InputPath[0]);
 
-    while(StartIndex < InputPath.Num() - 1)
+    TArray<int32> ProbeIndices;
+    TArray<FVector> ProbeStarts;
+    TArray<FVector> ProbeEnds;
+    TArray<bool> ProbeVisible;
+
+    // قبلاً برای هر نقطه از انتهای مسیر به عقب Sweep می‌زدیم (O(n²) Sweep)
+    // حالا: جستجوی نمایی + دودویی با Raycast روی NavMesh → O(log n) تست برای هر گوشه مسیر
+    while(StartIndex < LastIndex)
     {
-        int32 EndIndex = InputPath.Num() - 1;
+        const FVector& Start = InputPath[StartIndex];
+        auto IsNavVisible = [&](int32 Index) { return IsNavClear(Start, InputPath[Index]); };
+
+        // نقطه بعدی (Resample شده) همیشه قابل رسیدن است
+        int32 Good = StartIndex + 1;
+        int32 Bad = LastIndex + 1;
+        if (WalkabilityCache && Good < LastIndex)
+        {
+            // همه Probeهای نمایی (StartIndex + 2, 4, 8, ...) در یک Batch
+            ProbeIndices.Reset();
+            ProbeEnds.Reset();
+            for (int32 Offset = 2; ; Offset *= 2)
+            {
+                const int32 Probe = FMath::Min(StartIndex + Offset, LastIndex);
+                ProbeIndices.Add(Probe);
+                ProbeEnds.Add(InputPath[Probe]);
+                if (Probe == LastIndex) break;
+            }
+            ProbeStarts.Init(Start, ProbeEnds.Num());
+            ProbeVisible.SetNumUninitialized(ProbeEnds.Num());
+            WalkabilityCache->HasLineOfSightBatch(ProbeStarts, ProbeEnds, WalkabilityClearance, ProbeVisible);
 
-        // مسیر مستقیم باز بین Start و End پیدا کن
-        while(EndIndex > StartIndex + 1)
+            for (int32 ProbeIndex = 0; ProbeIndex < ProbeIndices.Num(); ProbeIndex++)
+            {
+                if (!ProbeVisible[ProbeIndex])
+                {
+                    Bad = ProbeIndices[ProbeIndex];
+                    break;
+                }
+                Good = ProbeIndices[ProbeIndex];
+            }
+        }
+        else
         {
-            FVector Start = InputPath[StartIndex];
-            FVector End = InputPath[EndIndex];
-
-            // استفاده از SphereSweep برای چک مسیر مستقیم
-            FHitResult HitResult;
-            bool bBlocked = GetWorld()->SweepSingleByObjectType(
-                HitResult,
-                Start,
-                End,
-                FQuat::Identity,
-                ObjectQueryParams,
-                FCollisionShape::MakeSphere(CharacterRadius),
-                QueryParams
-            );
-
-            if(!bBlocked)
+            int32 Step = 1;
+            while (Good < LastIndex)
             {
-                // مسیر مستقیم باز است → نقاط بین را حذف کن
-                break;
+                const int32 Probe = FMath::Min(Good + Step, LastIndex);
+                if (!IsNavVisible(Probe))
+                {
+                    Bad = Probe;
+                    break;
+                }
+                Good = Probe;
+                Step *= 2;
             }
+        }
+        int32 EndIndex = NarrowVisible(Good, Bad, IsNavVisible);
 
-            EndIndex--; // مسیر بسته بود → یک نقطه قبل را امتحان کن
+        // NavMesh یونیت‌ها و موانع متحرک را نمی‌بیند → بدون کش پاره‌خط انتخابی با یک Sweep تأیید می‌شود
+        if (!WalkabilityCache && EndIndex > StartIndex + 1 && !IsSweepClear(Start, InputPath[EndIndex]))
+        {
+            EndIndex = NarrowVisible(StartIndex + 1, EndIndex, [&](int32 Index) { return IsSweepClear(Start, InputPath[Index]); });
         }
 
         SmoothedPath.Add(InputPath[EndIndex]);
@@ -207,15 +727,18 @@ TArray<FVector> UGridPathfinderComponent::ProcessFinalPath(const TArray<FVector>
     }
 
     // دیباگ خطوط مسیر اصلی و مسیر پردازش شده
-    for(int32 i = 0; i < InputPath.Num() - 1; i++)
+    if (AIDebugDraw::IsEnabled(EAIDebugChannel::Path))
     {
-        DrawDebugLine(GetWorld(), InputPath[i], InputPath[i + 1], FColor::Red, false, 1.f, 0, 2.f);
-    }
+        for(int32 i = 0; i < InputPath.Num() - 1; i++)
+        {
+            AIDebugDraw::Line(GetWorld(), EAIDebugChannel::Path, InputPath[i], InputPath[i + 1], FColor::Red, 1.f, 2.f);
+        }
 
-    for(int32 i = 0; i < SmoothedPath.Num() - 1; i++)
-    {
-        DrawDebugLine(GetWorld(), SmoothedPath[i], SmoothedPath[i + 1], FColor::Blue, false, 7.f, 0, 3.f);
-        DrawDebugSphere(GetWorld(), SmoothedPath[i], 10.f, 8, FColor::Green, false, 1.f);
+        for(int32 i = 0; i < SmoothedPath.Num() - 1; i++)
+        {
+            AIDebugDraw::Line(GetWorld(), EAIDebugChannel::Path, SmoothedPath[i], SmoothedPath[i + 1], FColor::Blue, 7.f, 3.f);
+            AIDebugDraw::Sphere(GetWorld(), EAIDebugChannel::Path, SmoothedPath[i], 10.f, 8, FColor::Green, 1.f);
+        }
     }
 
     return SmoothedPath;
@@ -228,8 +751,10 @@ TArray<FVector> UGridPathfinderComponent::ResamplePath(const TArray<FVector>& In
     if (InputPath.Num() < 2)
         return InputPath;
 
+    const bool bDrawDebug = AIDebugDraw::IsEnabled(EAIDebugChannel::Path);
+
     Resampled.Add(InputPath[0]); // همیشه نقطه شروع نگه می‌داریم
-    DrawDebugSphere(GetWorld(), InputPath[0], 12.f, 8, FColor::Green, false, 7.f); // نقطه شروع
+    if (bDrawDebug) AIDebugDraw::Sphere(GetWorld(), EAIDebugChannel::Path, InputPath[0], 12.f, 8, FColor::Green, 7.f); // نقطه شروع
 
     float Remaining = SegmentLength;
     FVector Current = InputPath[0];
@@ -246,7 +771,7 @@ TArray<FVector> UGridPathfinderComponent::ResamplePath(const TArray<FVector>& In
             Resampled.Add(NewPoint);
 
             // 🔵 نمایش گره‌های اضافه‌شده با رنگ آبی
-            DrawDebugSphere(GetWorld(), NewPoint, 10.f, 8, FColor::Blue, false, 1.f);
+            if (bDrawDebug) AIDebugDraw::Sphere(GetWorld(), EAIDebugChannel::Path, NewPoint, 10.f, 8, FColor::Blue, 1.f);
 
             Current = NewPoint;
             Dist -= Remaining;
@@ -257,14 +782,14 @@ TArray<FVector> UGridPathfinderComponent::ResamplePath(const TArray<FVector>& In
         Current = Next;
 
         // 🟢 نمایش گره‌های اصلی با رنگ سبز
-        DrawDebugSphere(GetWorld(), Next, 12.f, 8, FColor::Green, false, 1.f);
+        if (bDrawDebug) AIDebugDraw::Sphere(GetWorld(), EAIDebugChannel::Path, Next, 12.f, 8, FColor::Green, 1.f);
     }
 
     // آخر مسیر همیشه باید نقطه نهایی باشه
     if (!Resampled.Last().Equals(InputPath.Last(), KINDA_SMALL_NUMBER))
     {
         Resampled.Add(InputPath.Last());
-        DrawDebugSphere(GetWorld(), InputPath.Last(), 12.f, 8, FColor::Green, false, 7.f);
+        if (bDrawDebug) AIDebugDraw::Sphere(GetWorld(), EAIDebugChannel::Path, InputPath.Last(), 12.f, 8, FColor::Green, 7.f);
     }
 
     return Resampled;
@@ -0,0 +1,165 @@
+#include "AI/UAIDebugDrawSubsystem.h"
+#include "DrawDebugHelpers.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+#if ENABLE_AI_DEBUG_DRAW
+
+static int32 GAIDebugChannels[(int32)EAIDebugChannel::Num] = {};
+
+static FAutoConsoleVariableRef CVarAIDebugPath(
+    TEXT("ai.Debug.Path"),
+    GAIDebugChannels[(int32)EAIDebugChannel::Path],
+    TEXT("Draw raw, resampled and smoothed grid paths."));
+
+static FAutoConsoleVariableRef CVarAIDebugCorridor(
+    TEXT("ai.Debug.Corridor"),
+    GAIDebugChannels[(int32)EAIDebugChannel::Corridor],
+    TEXT("Draw flow field corridor walls."));
+
+static FAutoConsoleVariableRef CVarAIDebugField(
+    TEXT("ai.Debug.Field"),
+    GAIDebugChannels[(int32)EAIDebugChannel::Field],
+    TEXT("Draw flow field cell directions and dead ends."));
+
+static FAutoConsoleVariableRef CVarAIDebugFormation(
+    TEXT("ai.Debug.Formation"),
+    GAIDebugChannels[(int32)EAIDebugChannel::Formation],
+    TEXT("Draw formation slots and unit-to-slot assignments."));
+
+static FAutoConsoleVariableRef CVarAIDebugRepulsion(
+    TEXT("ai.Debug.Repulsion"),
+    GAIDebugChannels[(int32)EAIDebugChannel::Repulsion],
+    TEXT("Draw flow field obstacle cells and repulsion."));
+
+bool AIDebugDraw::IsEnabled(EAIDebugChannel Channel)
+{
+    return GAIDebugChannels[(int32)Channel] != 0;
+}
+
+static UAIDebugDrawSubsystem* GetDebugDraw(const UWorld* World, EAIDebugChannel Channel)
+{
+    if (!World || !AIDebugDraw::IsEnabled(Channel))
+        return nullptr;
+
+    return World->GetSubsystem<UAIDebugDrawSubsystem>();
+}
+
+void AIDebugDraw::Line(const UWorld* World, EAIDebugChannel Channel, const FVector& Start, const FVector& End, const FColor& Color, float LifeTime, float Thickness)
+{
+    if (UAIDebugDrawSubsystem* DebugDraw = GetDebugDraw(World, Channel))
+    {
+        DebugDraw->AddLine(Start, End, Color, LifeTime, Thickness);
+    }
+}
+
+void AIDebugDraw::Arrow(const UWorld* World, EAIDebugChannel Channel, const FVector& Start, const FVector& End, float ArrowSize, const FColor& Color, float LifeTime, float Thickness)
+{
+    UAIDebugDrawSubsystem* DebugDraw = GetDebugDraw(World, Channel);
+    if (!DebugDraw)
+        return;
+
+    DebugDraw->AddLine(Start, End, Color, LifeTime, Thickness);
+
+    // سر فلش در صفحه افقی (همه فلش‌های AI روی زمین‌اند)
+    const FVector Dir = (End - Start).GetSafeNormal2D();
+    if (Dir.IsNearlyZero())
+        return;
+
+    const FVector Side = FVector::CrossProduct(Dir, FVector::UpVector);
+    DebugDraw->AddLine(End, End - Dir * ArrowSize + Side * (ArrowSize * 0.5f), Color, LifeTime, Thickness);
+    DebugDraw->AddLine(End, End - Dir * ArrowSize - Side * (ArrowSize * 0.5f), Color, LifeTime, Thickness);
+}
+
+void AIDebugDraw::Sphere(const UWorld* World, EAIDebugChannel Channel, const FVector& Center, float Radius, int32 Segments, const FColor& Color, float LifeTime, float Thickness)
+{
+    UAIDebugDrawSubsystem* DebugDraw = GetDebugDraw(World, Channel);
+    if (!DebugDraw)
+        return;
+
+    // سه دایره عمود بر هم
+    Segments = FMath::Max(Segments, 4);
+    const float AngleStep = 2.f * PI / Segments;
+    const FVector Axes[3][2] = {
+        { FVector::ForwardVector, FVector::RightVector },
+        { FVector::ForwardVector, FVector::UpVector },
+        { FVector::RightVector, FVector::UpVector },
+    };
+
+    for (const FVector (&Plane)[2] : Axes)
+    {
+        FVector Prev = Center + Plane[0] * Radius;
+        for (int32 i = 1; i <= Segments; i++)
+        {
+            float SinA, CosA;
+            FMath::SinCos(&SinA, &CosA, AngleStep * i);
+            const FVector Next = Center + (Plane[0] * CosA + Plane[1] * SinA) * Radius;
+            DebugDraw->AddLine(Prev, Next, Color, LifeTime, Thickness);
+            Prev = Next;
+        }
+    }
+}
+
+void AIDebugDraw::Point(const UWorld* World, EAIDebugChannel Channel, const FVector& Position, float Size, const FColor& Color, float LifeTime)
+{
+    UAIDebugDrawSubsystem* DebugDraw = GetDebugDraw(World, Channel);
+    if (!DebugDraw)
+        return;
+
+    // علامت + کوچک به جای Point (که جدا از خطوط Batch می‌شود)
+    const float Half = Size * 0.5f;
+    DebugDraw->AddLine(Position - FVector(Half, 0, 0), Position + FVector(Half, 0, 0), Color, LifeTime, 0.f);
+    DebugDraw->AddLine(Position - FVector(0, Half, 0), Position + FVector(0, Half, 0), Color, LifeTime, 0.f);
+}
+
+void AIDebugDraw::String(const UWorld* World, EAIDebugChannel Channel, const FVector& Location, const FString& Text, const FColor& Color, float LifeTime)
+{
+    if (World && IsEnabled(Channel))
+    {
+        DrawDebugString(World, Location, Text, nullptr, Color, LifeTime);
+    }
+}
+
+#endif // ENABLE_AI_DEBUG_DRAW
+
+bool UAIDebugDrawSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+    return ENABLE_AI_DEBUG_DRAW && Super::ShouldCreateSubsystem(Outer);
+}
+
+void UAIDebugDrawSubsystem::Deinitialize()
+{
+    PendingLines.Empty();
+    PendingFrameLines.Empty();
+    Super::Deinitialize();
+}
+
+TStatId UAIDebugDrawSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UAIDebugDrawSubsystem, STATGROUP_Tickables);
+}
+
+void UAIDebugDrawSubsystem::AddLine(const FVector& Start, const FVector& End, const FColor& Color, float LifeTime, float Thickness)
+{
+    TArray<FBatchedLine>& Lines = LifeTime > 0.f ? PendingLines : PendingFrameLines;
+    Lines.Emplace(Start, End, FLinearColor(Color), LifeTime, Thickness, SDPG_World);
+}
+
+void UAIDebugDrawSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    // یک DrawLines برای هر Batcher به جای یک MarkRenderStateDirty برای هر خط
+    UWorld* World = GetWorld();
+    if (PendingLines.Num() > 0 && World->PersistentLineBatcher)
+    {
+        World->PersistentLineBatcher->DrawLines(PendingLines);
+    }
+    if (PendingFrameLines.Num() > 0 && World->LineBatcher)
+    {
+        World->LineBatcher->DrawLines(PendingFrameLines);
+    }
+
+    PendingLines.Reset();
+    PendingFrameLines.Reset();
+}
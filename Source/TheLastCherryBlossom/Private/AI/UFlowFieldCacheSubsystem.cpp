@@ -0,0 +1,230 @@
+#include "AI/UFlowFieldCacheSubsystem.h"
+#include "AI/UFlowFieldComponent.h"
+#include "AI/UWalkabilityCacheSubsystem.h"
+#include "NavigationSystem.h"
+#include "HAL/IConsoleManager.h"
+#include "TimerManager.h"
+
+static int32 GFlowFieldCacheBudgetMB = 32;
+static FAutoConsoleVariableRef CVarFlowFieldCacheBudgetMB(
+    TEXT("ai.FlowFieldCache.BudgetMB"),
+    GFlowFieldCacheBudgetMB,
+    TEXT("Memory budget (MB) of the world flow field cache. 0 disables caching."));
+
+void UFlowFieldCacheSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+    Super::OnWorldBeginPlay(InWorld);
+
+    // هر بار که NavMesh دوباره ساخته شود، فیلدهای قبلی ممکن است از موانع قدیمی ساخته شده باشند
+    if (UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(&InWorld))
+    {
+        NavSys->OnNavigationGenerationFinishedDelegate.AddUniqueDynamic(this, &UFlowFieldCacheSubsystem::OnNavigationGenerationFinished);
+    }
+}
+
+void UFlowFieldCacheSubsystem::Deinitialize()
+{
+    if (UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld()))
+    {
+        NavSys->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &UFlowFieldCacheSubsystem::OnNavigationGenerationFinished);
+    }
+
+    PendingDirtyBounds.Empty();
+    PendingStaticDirtyBounds.Empty();
+    Invalidate();
+    Super::Deinitialize();
+}
+
+FFlowFieldCacheKey UFlowFieldCacheSubsystem::MakeSectorKey(const FIntPoint& SectorCoord, const FFlowFieldBuildInput& Input)
+{
+    const float Quantum = FMath::Max(Input.CellSize, 1.f);
+
+    FFlowFieldCacheKey Key;
+    Key.SectorCoord = SectorCoord;
+    Key.CorridorWidthCm = Input.CorridorWidthCm;
+    Key.CellSizeCm = FMath::RoundToInt(Input.CellSize);
+
+    // مقصد فقط وقتی داخل پنجره سکتور باشد روی فیلد آن اثر دارد
+    const FIntPoint LocalDestination(
+        FMath::FloorToInt((Input.Destination.X - Input.Origin.X) / Quantum),
+        FMath::FloorToInt((Input.Destination.Y - Input.Origin.Y) / Quantum));
+    const bool bDestinationInWindow = LocalDestination.X >= 0 && LocalDestination.Y >= 0 && LocalDestination.X < Input.Width && LocalDestination.Y < Input.Height;
+    Key.DestinationCell = bDestinationInWindow
+        ? FIntPoint(FMath::FloorToInt(Input.Destination.X / Quantum), FMath::FloorToInt(Input.Destination.Y / Quantum))
+        : FIntPoint(MAX_int32, MAX_int32);
+
+    Key.WindowCells = Input.Width;
+    Key.SmoothingIterations = Input.SmoothingIterations;
+
+    // مسیر (بریده‌شده به پنجره) کوانتیزه به اندازه سلول → مسیرهای تقریباً یکسان یک کلید می‌گیرند
+    Key.PathCells.Reserve(Input.Path.Num());
+    for (const FVector& Point : Input.Path)
+    {
+        Key.PathCells.Add(FIntPoint(FMath::RoundToInt(Point.X / Quantum), FMath::RoundToInt(Point.Y / Quantum)));
+    }
+
+    // سکتور بعدی هدف محلی این سکتور است
+    Key.PortalRects = Input.PortalRects;
+
+    uint32 Hash = HashCombine(GetTypeHash(Key.WindowCells), GetTypeHash(Key.PathCells.Num()));
+    Hash = HashCombine(Hash, GetTypeHash(Key.SmoothingIterations));
+    for (const FIntPoint& Cell : Key.PathCells)
+    {
+        Hash = HashCombine(Hash, GetTypeHash(Cell));
+    }
+    for (const FIntRect& Portal : Key.PortalRects)
+    {
+        Hash = HashCombine(Hash, HashCombine(GetTypeHash(Portal.Min), GetTypeHash(Portal.Max)));
+    }
+    Key.PathHash = Hash;
+
+    return Key;
+}
+
+TSharedPtr<const FFlowFieldGrid> UFlowFieldCacheSubsystem::Find(const FFlowFieldCacheKey& Key)
+{
+    FEntry* Entry = Entries.Find(Key);
+    if (!Entry)
+        return nullptr;
+
+    Entry->LastUsed = ++UseCounter;
+    return Entry->Grid;
+}
+
+void UFlowFieldCacheSubsystem::Add(const FFlowFieldCacheKey& Key, const TSharedRef<const FFlowFieldGrid>& Grid)
+{
+    const SIZE_T BudgetBytes = (SIZE_T)FMath::Max(0, GFlowFieldCacheBudgetMB) * 1024 * 1024;
+    const SIZE_T Bytes = Grid->GetAllocatedSize() + Key.PathCells.GetAllocatedSize() + Key.PortalRects.GetAllocatedSize();
+    if (Bytes > BudgetBytes)
+        return; // بزرگ‌تر از کل بودجه
+
+    if (FEntry* Existing = Entries.Find(Key))
+    {
+        UsedBytes -= Existing->Bytes;
+        Entries.Remove(Key);
+    }
+
+    EvictToBudget(BudgetBytes - Bytes);
+
+    FEntry& Entry = Entries.Add(Key);
+    Entry.Grid = Grid;
+    Entry.Bytes = Bytes;
+    Entry.LastUsed = ++UseCounter;
+    UsedBytes += Bytes;
+}
+
+void UFlowFieldCacheSubsystem::Invalidate()
+{
+    ObstacleEpoch++;
+    Entries.Empty();
+    UsedBytes = 0;
+}
+
+void UFlowFieldCacheSubsystem::EvictToBudget(SIZE_T BudgetBytes)
+{
+    // تعداد ورودی‌ها کم است؛ پیدا کردن قدیمی‌ترین با یک پیمایش خطی کافی است
+    while (UsedBytes > BudgetBytes && Entries.Num() > 0)
+    {
+        FFlowFieldCacheKey OldestKey;
+        uint64 OldestUse = MAX_uint64;
+        for (const TPair<FFlowFieldCacheKey, FEntry>& Pair : Entries)
+        {
+            if (Pair.Value.LastUsed < OldestUse)
+            {
+                OldestUse = Pair.Value.LastUsed;
+                OldestKey = Pair.Key;
+            }
+        }
+
+        UsedBytes -= Entries.FindChecked(OldestKey).Bytes;
+        Entries.Remove(OldestKey);
+    }
+}
+
+void UFlowFieldCacheSubsystem::NotifyObstaclesChanged(const FBox& DirtyBounds)
+{
+    QueueObstacleChange(DirtyBounds, true);
+}
+
+void UFlowFieldCacheSubsystem::NotifyUnitObstaclesChanged(const FBox& DirtyBounds)
+{
+    QueueObstacleChange(DirtyBounds, false);
+}
+
+void UFlowFieldCacheSubsystem::QueueObstacleChange(const FBox& DirtyBounds, bool bStatic)
+{
+    if (!DirtyBounds.IsValid)
+        return;
+
+    // چند گزارش در یک فریم (مثلاً چند یونیت که با هم پارک می‌کنند) فقط یک بار تعمیر می‌شوند
+    if (PendingDirtyBounds.Num() == 0 && GetWorld())
+    {
+        GetWorld()->GetTimerManager().SetTimerForNextTick(this, &UFlowFieldCacheSubsystem::FlushObstacleChanges);
+    }
+    PendingDirtyBounds.Add(DirtyBounds);
+    if (bStatic)
+    {
+        PendingStaticDirtyBounds.Add(DirtyBounds);
+    }
+}
+
+void UFlowFieldCacheSubsystem::FlushObstacleChanges()
+{
+    if (PendingDirtyBounds.Num() == 0)
+        return;
+
+    const TArray<FBox> DirtyBounds = MoveTemp(PendingDirtyBounds);
+    const TArray<FBox> StaticDirtyBounds = MoveTemp(PendingStaticDirtyBounds);
+    PendingDirtyBounds.Reset();
+    PendingStaticDirtyBounds.Reset();
+
+    // اول کش‌ها، تا تعمیر FlowFieldها سکتور یا تایل Walkability کهنه را برنگرداند
+    InvalidateBounds(DirtyBounds);
+    if (StaticDirtyBounds.Num() > 0)
+    {
+        // تایل‌های Walkability فقط لایه‌های Static را دارند؛ یونیت پارک‌شده نباید Version و کش‌های وابسته را بشکند
+        if (UWalkabilityCacheSubsystem* WalkabilityCache = GetWorld() ? GetWorld()->GetSubsystem<UWalkabilityCacheSubsystem>() : nullptr)
+        {
+            WalkabilityCache->InvalidateObstacleBounds(StaticDirtyBounds);
+        }
+        OnStaticObstaclesChanged.Broadcast(StaticDirtyBounds);
+    }
+    OnObstaclesChanged.Broadcast(DirtyBounds);
+}
+
+void UFlowFieldCacheSubsystem::InvalidateBounds(const TArray<FBox>& DirtyBounds)
+{
+    ObstacleEpoch++;
+
+    TArray<FFlowFieldCacheKey> StaleKeys;
+    for (const TPair<FFlowFieldCacheKey, FEntry>& Pair : Entries)
+    {
+        const FFlowFieldGrid& Grid = *Pair.Value.Grid;
+        // تعداد تکرار Smoothing سازنده سکتور معلوم نیست → حاشیه با بیشینه آن (محافظه‌کارانه)
+        const float HaloCm = UFlowFieldComponent::GetSectorHaloCells(Grid.CellSize, UFlowFieldComponent::MaxSmoothingIterations) * Grid.CellSize;
+        const FBox2D Window(
+            FVector2D(Grid.Origin.X - HaloCm, Grid.Origin.Y - HaloCm),
+            FVector2D(Grid.Origin.X + Grid.Width * Grid.CellSize + HaloCm, Grid.Origin.Y + Grid.Height * Grid.CellSize + HaloCm));
+
+        for (const FBox& Dirty : DirtyBounds)
+        {
+            if (Window.Intersect(FBox2D(FVector2D(Dirty.Min), FVector2D(Dirty.Max))))
+            {
+                StaleKeys.Add(Pair.Key);
+                break;
+            }
+        }
+    }
+
+    for (const FFlowFieldCacheKey& Key : StaleKeys)
+    {
+        UsedBytes -= Entries.FindChecked(Key).Bytes;
+        Entries.Remove(Key);
+    }
+}
+
+void UFlowFieldCacheSubsystem::OnNavigationGenerationFinished(ANavigationData* NavData)
+{
+    UE_LOG(LogTemp, Log, TEXT("FlowFieldCache: NavMesh rebuilt, dropping %d cached fields."), Entries.Num());
+    Invalidate();
+}
@@ -1,11 +1,91 @@
 #include "AI/UFlowFieldComponent.h"
-#include "DrawDebugHelpers.h"
+#include "AI/UFlowFieldCacheSubsystem.h"
+#include "AI/UAIDebugDrawSubsystem.h"
+#include "AI/UWalkabilityCacheSubsystem.h"
 #include "Kismet/KismetSystemLibrary.h"
 #include "Containers/Queue.h"  // برای TQueue در Flood Fill
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Algo/Sort.h"
+
+// ثابت‌های ساخت — حاشیه پنجره هر سکتور هم از همین‌ها محاسبه می‌شود
+namespace FlowFieldBuild
+{
+    constexpr float RepulsionRadiusCm = 200.f;      // شعاع تأثیر فاصله از مانع
+    constexpr float RepulsionStrength = 2.0f;       // جریمه هزینه کنار مانع (۲ یعنی ورود به سلول چسبیده به مانع ۳ برابر گران‌تر)
+    constexpr int32 StraightStepCost = 10;          // هزینه یک قدم مستقیم در میدان انتگرال (واحد: یک‌دهم سلول)
+    constexpr int32 DiagonalStepCost = 14;
+}
+
+void FFlowFieldGrid::Init(const FVector& InOrigin, float InCellSize, int32 InWidth, int32 InHeight)
+{
+    Origin = InOrigin;
+    CellSize = InCellSize;
+    Width = InWidth;
+    Height = InHeight;
+
+    const int32 NumCells = Width * Height;
+    Cost.Init(UnreachableCost, NumCells);
+    Flags.Init(0, NumCells);
+    Direction.Init(0, NumCells);
+    PathDirection.Init(0, NumCells);
+}
+
+void FFlowFieldGrid::Reset()
+{
+    Width = 0;
+    Height = 0;
+    Cost.Empty();
+    Flags.Empty();
+    Direction.Empty();
+    PathDirection.Empty();
+}
+
+const FFlowFieldGrid* FFlowFieldSectorMap::FindCell(const FVector& WorldLocation, int32& OutIndex) const
+{
+    const TSharedPtr<const FFlowFieldGrid>* Sector = Sectors.Find(WorldToSector(WorldLocation));
+    if (!Sector)
+        return nullptr;
+
+    const FFlowFieldGrid& Grid = **Sector;
+    const FIntPoint Local = Grid.WorldToGrid(WorldLocation);
+
+    // سکتور از قبل مشخص است؛ Clamp فقط خطای اعشاری روی مرز را جذب می‌کند
+    OutIndex = Grid.ToIndex(FMath::Clamp(Local.X, 0, Grid.Width - 1), FMath::Clamp(Local.Y, 0, Grid.Height - 1));
+    return &Grid;
+}
+
+int32 FFlowFieldSectorMap::Num() const
+{
+    int32 Total = 0;
+    for (const TPair<FIntPoint, TSharedPtr<const FFlowFieldGrid>>& Pair : Sectors)
+    {
+        Total += Pair.Value->Num();
+    }
+    return Total;
+}
+
+SIZE_T FFlowFieldSectorMap::GetAllocatedSize() const
+{
+    SIZE_T Bytes = Sectors.GetAllocatedSize();
+    for (const TPair<FIntPoint, TSharedPtr<const FFlowFieldGrid>>& Pair : Sectors)
+    {
+        Bytes += Pair.Value->GetAllocatedSize();
+    }
+    return Bytes;
+}
 
 UFlowFieldComponent::UFlowFieldComponent()
 {
-    PrimaryComponentTick.bCanEverTick = false;
+    // Tick فقط وقتی یونیتی فیلد را دنبال می‌کند روشن است
+    PrimaryComponentTick.bCanEverTick = true;
+    PrimaryComponentTick.bStartWithTickEnabled = false;
+}
+
+const FFlowFieldSectorMap& UFlowFieldComponent::GetSectorMap() const
+{
+    static const FFlowFieldSectorMap EmptyMap;
+    return Field.IsValid() ? *Field : EmptyMap;
 }
 
 void UFlowFieldComponent::BeginPlay()
@@ -16,6 +96,28 @@ void UFlowFieldComponent::BeginPlay()
     {
         UE_LOG(LogTemp, Error, TEXT("FlowFieldComponent: PathfinderComp not found on %s"), *GetOwner()->GetName());
     }
+
+    // ساختمان جدید یا یونیت پارک‌شده → تعمیر محلی به جای ساخت دوباره کل فیلد
+    if (UFlowFieldCacheSubsystem* Cache = GetWorld()->GetSubsystem<UFlowFieldCacheSubsystem>())
+    {
+        ObstaclesChangedHandle = Cache->OnObstaclesChanged.AddUObject(this, &UFlowFieldComponent::OnObstaclesChanged);
+    }
+}
+
+void UFlowFieldComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    if (UFlowFieldCacheSubsystem* Cache = GetWorld() ? GetWorld()->GetSubsystem<UFlowFieldCacheSubsystem>() : nullptr)
+    {
+        Cache->OnObstaclesChanged.Remove(ObstaclesChangedHandle);
+    }
+    ObstaclesChangedHandle.Reset();
+
+    Super::EndPlay(EndPlayReason);
+}
+
+int32 UFlowFieldComponent::GetSectorHaloCells(float InCellSize, int32 InSmoothingIterations)
+{
+    return FMath::CeilToInt(FlowFieldBuild::RepulsionRadiusCm / FMath::Max(InCellSize, 1.f)) + FMath::Clamp(InSmoothingIterations, 0, MaxSmoothingIterations) + 1;
 }
 
 FVector UFlowFieldComponent::GridIndexToWorld(const FIntVector& Index) const
@@ -43,145 +145,566 @@ FIntPoint UFlowFieldComponent::WorldToGrid(const FVector& WorldLocation) const
 
 FFlowFieldCell UFlowFieldComponent::GetCell(const FIntPoint& Coord) const
 {
-    // اگر خارج از محدوده گرید باشد، یک سلول خالی برگردون
+    // اگر خارج از محدوده سکتورها باشد، یک سلول خالی برگردون
     if (Coord.X < 0 || Coord.Y < 0 || Coord.X >= GridWidth || Coord.Y >= GridHeight)
     {
         return FFlowFieldCell();
     }
 
-    int32 Index = Coord.Y * GridWidth + Coord.X;
-    if (FlowFieldGrid.IsValidIndex(Index))
+    int32 Index = INDEX_NONE;
+    const FFlowFieldGrid* Grid = GetSectorMap().FindCell(GridIndexToWorld(FIntVector(Coord.X, Coord.Y, 0)), Index);
+    if (!Grid)
+    {
+        return FFlowFieldCell(); // سکتوری که کریدور از آن نمی‌گذرد
+    }
+
+    FFlowFieldCell Cell;
+    Cell.Cost = Grid->Cost[Index] == FFlowFieldGrid::UnreachableCost ? -1 : Grid->Cost[Index];
+    Cell.bInCorridor = Grid->HasFlag(Index, FFlowFieldGrid::Flag_InCorridor);
+    Cell.bObstacle = Grid->HasFlag(Index, FFlowFieldGrid::Flag_Obstacle);
+    Cell.PathVector = Grid->GetPathVector(Index);
+    Cell.Direction = Grid->GetDirection(Index);
+    return Cell;
+}
+
+bool UFlowFieldComponent::SampleDirection(const FVector& Location, FVector& OutDirection) const
+{
+    bool bInCorridor = false;
+    SampleDirections(MakeArrayView(&Location, 1), MakeArrayView(&OutDirection, 1), MakeArrayView(&bInCorridor, 1));
+    return bInCorridor;
+}
+
+// تقسیم صحیح رو به پایین (برای مختصات منفی سلول)
+static FORCEINLINE int32 FloorDivide(int32 Value, int32 Divisor)
+{
+    return Value >= 0 ? Value / Divisor : (Value - Divisor + 1) / Divisor;
+}
+
+void UFlowFieldComponent::SampleDirections(TConstArrayView<FVector> Positions, TArrayView<FVector> OutDirections, TArrayView<bool> OutInCorridor) const
+{
+    check(OutDirections.Num() >= Positions.Num() && OutInCorridor.Num() >= Positions.Num());
+
+    const FFlowFieldSectorMap& Map = GetSectorMap();
+    const int32 SectorCells = Map.SectorSizeCells;
+    const float InvCellSize = 1.f / Map.CellSize;
+
+    constexpr uint8 OpenMask = FFlowFieldGrid::Flag_InCorridor | FFlowFieldGrid::Flag_Obstacle;
+
+    // سلول‌ها با World هم‌ترازند، پس مختصات سراسری سلول مستقیم به (سکتور، سلول محلی) تبدیل می‌شود
+    // ۱) گروه‌بندی یک‌باره نمونه‌ها بر اساس سکتور گوشه پایین-چپ درون‌یابی (مرتب‌سازی کلید، بدون Map برای هر نمونه)
+    auto ToSectorCoord = [InvCellSize, SectorCells](const FVector& Position)
+    {
+        return FIntPoint(
+            FloorDivide(FMath::FloorToInt((float)Position.X * InvCellSize - 0.5f), SectorCells),
+            FloorDivide(FMath::FloorToInt((float)Position.Y * InvCellSize - 0.5f), SectorCells));
+    };
+
+    TArray<TPair<uint64, int32>> Keyed;
+    Keyed.SetNumUninitialized(Positions.Num());
+    for (int32 i = 0; i < Positions.Num(); i++)
+    {
+        const FIntPoint SectorCoord = ToSectorCoord(Positions[i]);
+        Keyed[i] = TPair<uint64, int32>(((uint64)(uint32)SectorCoord.X << 32) | (uint32)SectorCoord.Y, i);
+    }
+    Algo::SortBy(Keyed, [](const TPair<uint64, int32>& Entry) { return Entry.Key; });
+
+    // ۲) هر گروه: سکتور خودش و سه همسایه راست/بالا (گوشه‌های روی درز) یک بار از Map،
+    // بعد درون‌یابی مستقیم روی آرایه‌های پیوسته Flags/Direction همان سکتورها
+    for (int32 GroupStart = 0; GroupStart < Keyed.Num();)
+    {
+        int32 GroupEnd = GroupStart + 1;
+        while (GroupEnd < Keyed.Num() && Keyed[GroupEnd].Key == Keyed[GroupStart].Key)
+        {
+            GroupEnd++;
+        }
+
+        const FIntPoint SectorCoord = ToSectorCoord(Positions[Keyed[GroupStart].Value]);
+        const FFlowFieldGrid* QuadrantGrids[4];
+        for (int32 Quadrant = 0; Quadrant < 4; Quadrant++)
+        {
+            const TSharedPtr<const FFlowFieldGrid>* Found = Map.Sectors.Find(SectorCoord + FIntPoint(Quadrant & 1, Quadrant >> 1));
+            QuadrantGrids[Quadrant] = Found ? Found->Get() : nullptr;
+        }
+        const int32 BaseX = SectorCoord.X * SectorCells;
+        const int32 BaseY = SectorCoord.Y * SectorCells;
+
+        for (int32 k = GroupStart; k < GroupEnd; k++)
+        {
+            const int32 i = Keyed[k].Value;
+
+            // مختصات پیوسته نسبت به مراکز سلول‌ها، محلی به سکتور گروه
+            const float GX = (float)Positions[i].X * InvCellSize - 0.5f;
+            const float GY = (float)Positions[i].Y * InvCellSize - 0.5f;
+            const int32 X0 = FMath::FloorToInt(GX);
+            const int32 Y0 = FMath::FloorToInt(GY);
+            const float FX = GX - X0;
+            const float FY = GY - Y0;
+
+            // سلول شامل نقطه همیشه یکی از ۴ گوشه است و عضویت در کریدور را تعیین می‌کند
+            const int32 CellX = FMath::FloorToInt((float)Positions[i].X * InvCellSize);
+            const int32 CellY = FMath::FloorToInt((float)Positions[i].Y * InvCellSize);
+
+            FVector Sum = FVector::ZeroVector;
+            FVector Fallback = FVector::ZeroVector;
+            bool bInCorridor = false;
+
+            for (int32 Corner = 0; Corner < 4; Corner++)
+            {
+                const int32 X = X0 + (Corner & 1);
+                const int32 Y = Y0 + (Corner >> 1);
+                const float Weight = ((Corner & 1) ? FX : 1.f - FX) * ((Corner >> 1) ? FY : 1.f - FY);
+
+                int32 LocalX = X - BaseX;
+                int32 LocalY = Y - BaseY;
+                const int32 Quadrant = (LocalX >= SectorCells ? 1 : 0) | (LocalY >= SectorCells ? 2 : 0);
+                const FFlowFieldGrid* Grid = QuadrantGrids[Quadrant];
+                if (!Grid) continue;
+
+                if (Quadrant & 1) LocalX -= SectorCells;
+                if (Quadrant & 2) LocalY -= SectorCells;
+
+                const int32 Index = Grid->ToIndex(LocalX, LocalY);
+                const uint8 CellFlags = Grid->Flags[Index];
+                if ((CellFlags & OpenMask) != FFlowFieldGrid::Flag_InCorridor) continue;
+
+                if (X == CellX && Y == CellY)
+                {
+                    bInCorridor = true;
+                    Fallback = Grid->GetPathVector(Index);
+                }
+
+                if (CellFlags & FFlowFieldGrid::Flag_HasDirection)
+                {
+                    Sum += FFlowFieldGrid::DecodeAngle(Grid->Direction[Index]) * Weight;
+                }
+            }
+
+            // اولویت با Direction درون‌یابی‌شده، در غیر این صورت PathVector سلول
+            OutInCorridor[i] = bInCorridor;
+            OutDirections[i] = !bInCorridor ? FVector::ZeroVector : (Sum.IsNearlyZero() ? Fallback : Sum.GetSafeNormal());
+        }
+
+        GroupStart = GroupEnd;
+    }
+}
+
+int32 UFlowFieldComponent::AddFollower(AActor* Follower)
+{
+    int32 Slot;
+    if (FreeFollowerSlots.Num() > 0)
+    {
+        Slot = FreeFollowerSlots.Pop(EAllowShrinking::No);
+    }
+    else
+    {
+        Slot = Followers.Add(nullptr);
+        FollowerStates.Add(EFollowerSlot::Free);
+        FollowerPositions.AddZeroed();
+        FollowerDirections.AddZeroed();
+        FollowerInCorridor.Add(false);
+    }
+
+    Followers[Slot] = Follower;
+    FollowerStates[Slot] = EFollowerSlot::Registered;
+    NumFollowers++;
+
+    SetComponentTickEnabled(true);
+    return Slot;
+}
+
+void UFlowFieldComponent::RemoveFollower(int32 FollowerSlot)
+{
+    if (!FollowerStates.IsValidIndex(FollowerSlot) || FollowerStates[FollowerSlot] == EFollowerSlot::Free)
+        return;
+
+    Followers[FollowerSlot] = nullptr;
+    FollowerStates[FollowerSlot] = EFollowerSlot::Free;
+    FreeFollowerSlots.Add(FollowerSlot);
+    NumFollowers--;
+}
+
+bool UFlowFieldComponent::GetFollowerDirection(int32 FollowerSlot, FVector& OutDirection, bool& bOutInCorridor) const
+{
+    if (!FollowerStates.IsValidIndex(FollowerSlot) || FollowerStates[FollowerSlot] != EFollowerSlot::Sampled)
+        return false;
+
+    OutDirection = FollowerDirections[FollowerSlot];
+    bOutInCorridor = FollowerInCorridor[FollowerSlot];
+    return true;
+}
+
+void UFlowFieldComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+    Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+    // موقعیت همه دنبال‌کننده‌ها → یک نمونه‌برداری دسته‌ای → یونیت‌ها در Tick خودشان فقط نتیجه را می‌خوانند
+    for (int32 Slot = 0; Slot < Followers.Num(); Slot++)
+    {
+        if (FollowerStates[Slot] == EFollowerSlot::Free) continue;
+
+        const AActor* Follower = Followers[Slot].Get();
+        if (!Follower)
+        {
+            RemoveFollower(Slot); // یونیت از بین رفته
+            continue;
+        }
+        FollowerPositions[Slot] = Follower->GetActorLocation();
+    }
+
+    if (NumFollowers == 0)
     {
-        return FlowFieldGrid[Index];
+        SetComponentTickEnabled(false);
+        return;
     }
 
-    return FFlowFieldCell(); // در صورت نامعتبر بودن ایندکس
+    SampleDirections(FollowerPositions, FollowerDirections, FollowerInCorridor);
+
+    for (EFollowerSlot& State : FollowerStates)
+    {
+        if (State == EFollowerSlot::Registered)
+        {
+            State = EFollowerSlot::Sampled;
+        }
+    }
+}
+
+bool UFlowFieldComponent::GetDistanceToGoal(const FVector& Location, float& OutDistanceCm) const
+{
+    const FFlowFieldSectorMap& Map = GetSectorMap();
+
+    int32 Index = INDEX_NONE;
+    const FFlowFieldGrid* Grid = Map.FindCell(Location, Index);
+    if (!Grid || Grid->Cost[Index] == FFlowFieldGrid::UnreachableCost)
+        return false;
+
+    const uint32* Offset = Map.CostOffsets.Find(Map.WorldToSector(Location));
+    const uint32 TotalCost = Grid->Cost[Index] + (Offset ? *Offset : 0);
+    OutDistanceCm = (float)TotalCost / FlowFieldBuild::StraightStepCost * Grid->CellSize;
+    return true;
 }
 
 FVector UFlowFieldComponent::GetDirectionAtLocation(const FVector& Location) const
 {
-    FIntPoint Index = WorldToGrid(Location);
-    if (Index.X >= 0 && Index.X < GridWidth && Index.Y >= 0 && Index.Y < GridHeight)
+    int32 Index = INDEX_NONE;
+    if (const FFlowFieldGrid* Grid = GetSectorMap().FindCell(Location, Index))
     {
-        const FFlowFieldCell& Cell = FlowFieldGrid[Index.Y * GridWidth + Index.X];
-        return Cell.Direction;
+        return Grid->GetDirection(Index);
     }
     return FVector::ZeroVector;
 }
 
-void UFlowFieldComponent::MarkReachableCellsFromDestination()
+// میدان انتگرال: Dijkstra با صف سطلی (Dial) از مقصد — یا پورتال‌ها در سکتورهای میانی — روی سلول‌های باز کریدور
+// هزینه ورود به هر سلول نزدیک مانع بیشتر است، پس کوتاه‌ترین مسیر خودش از لبه موانع فاصله می‌گیرد
+// سلول‌های کریدور که به هدف نمی‌رسند (Dead End) از کریدور حذف می‌شوند
+static void IntegrateCostField(FFlowFieldGrid& Grid, const FFlowFieldBuildInput& Input, const TArray<float>& ObstacleDistSq)
 {
-    if (FlowFieldGrid.Num() == 0) return;
+    if (Grid.Num() == 0) return;
 
-    TArray<bool> Visited;
-    Visited.Init(false, GridWidth * GridHeight);
+    const int32 GridWidth = Grid.Width;
+    const int32 GridHeight = Grid.Height;
 
-    TQueue<FIntPoint> Queue;
+    constexpr uint8 OpenMask = FFlowFieldGrid::Flag_InCorridor | FFlowFieldGrid::Flag_Obstacle;
 
-    FIntPoint DestGrid = WorldToGrid(FlowFieldDestination);
-    if (DestGrid.X >= 0 && DestGrid.X < GridWidth && DestGrid.Y >= 0 && DestGrid.Y < GridHeight)
+    // هزینه ورود به سلول: پایه + جریمه فاصله تا مانع (همان شعاع و قدرت دافعه قبلی)
+    const float ClearanceRadiusCellsSq = FMath::Square(FlowFieldBuild::RepulsionRadiusCm / Grid.CellSize);
+    TArray<uint8> EnterCost;
+    EnterCost.SetNumUninitialized(Grid.Num());
+    for (int32 Index = 0; Index < Grid.Num(); Index++)
     {
-        int32 DestIndex = DestGrid.Y * GridWidth + DestGrid.X;
-        const FFlowFieldCell& DestCell = FlowFieldGrid[DestIndex];
-        if (!DestCell.bObstacle && DestCell.bInCorridor)
+        float Penalty = 0.f;
+        if (ObstacleDistSq[Index] < ClearanceRadiusCellsSq)
         {
-            Queue.Enqueue(DestGrid);
-            Visited[DestIndex] = true;
+            const float Proximity = 1.f - FMath::Sqrt(ObstacleDistSq[Index] / ClearanceRadiusCellsSq);
+            Penalty = Proximity * FlowFieldBuild::RepulsionStrength;
         }
+        EnterCost[Index] = (uint8)FMath::RoundToInt(FlowFieldBuild::StraightStepCost * (1.f + Penalty));
     }
 
-    // 8 جهت برای اتصال بهتر (مورب هم اجازه می‌ده)
-    const TArray<FIntPoint> Directions = {
-        FIntPoint(0,1), FIntPoint(0,-1), FIntPoint(1,0), FIntPoint(-1,0),
+    const int32 MaxStepCost = FMath::CeilToInt(FlowFieldBuild::StraightStepCost * (1.f + FlowFieldBuild::RepulsionStrength)) * FlowFieldBuild::DiagonalStepCost / FlowFieldBuild::StraightStepCost + 1;
+    const int32 NumBuckets = MaxStepCost + 1;
+
+    // صف سطلی دایره‌ای: بیشترین هزینه یال کمتر از تعداد سطل‌هاست پس سطل‌ها تداخل ندارند
+    TArray<TArray<int32>> Buckets;
+    Buckets.SetNum(NumBuckets);
+    int32 Pending = 0;
+
+    auto Seed = [&Grid, &Buckets, &Pending](int32 Index)
+    {
+        if ((Grid.Flags[Index] & OpenMask) != FFlowFieldGrid::Flag_InCorridor || Grid.Cost[Index] == 0) return;
+        Grid.Cost[Index] = 0;
+        Buckets[0].Add(Index);
+        Pending++;
+    };
+
+    const FIntPoint DestGrid = Grid.WorldToGrid(Input.Destination);
+    if (Grid.IsValidCoord(DestGrid.X, DestGrid.Y))
+    {
+        Seed(Grid.ToIndex(DestGrid.X, DestGrid.Y));
+    }
+
+    // هدف سکتورهای میانی همان سلول‌های کریدور در سکتور بعدی است
+    for (const FIntRect& Portal : Input.PortalRects)
+    {
+        for (int32 y = Portal.Min.Y; y < Portal.Max.Y; y++)
+        {
+            for (int32 x = Portal.Min.X; x < Portal.Max.X; x++)
+            {
+                Seed(y * GridWidth + x);
+            }
+        }
+    }
+
+    // ۸ جهت؛ حرکت مورب فقط وقتی هر دو سلول مستقیم کنارش باز باشند (بدون بریدن گوشه مانع)
+    static const FIntPoint Directions[8] = {
+        FIntPoint(1,0), FIntPoint(-1,0), FIntPoint(0,1), FIntPoint(0,-1),
         FIntPoint(1,1), FIntPoint(1,-1), FIntPoint(-1,1), FIntPoint(-1,-1)
     };
 
-    while (!Queue.IsEmpty())
+    auto IsOpen = [&Grid, GridWidth, GridHeight](int32 X, int32 Y)
     {
-        FIntPoint Current;
-        Queue.Dequeue(Current);
+        return X >= 0 && Y >= 0 && X < GridWidth && Y < GridHeight &&
+            (Grid.Flags[Y * GridWidth + X] & OpenMask) == FFlowFieldGrid::Flag_InCorridor;
+    };
 
-        for (const FIntPoint& Dir : Directions)
+    for (int32 Current = 0; Pending > 0; Current++)
+    {
+        TArray<int32>& Bucket = Buckets[Current % NumBuckets];
+        while (Bucket.Num() > 0)
         {
-            FIntPoint Neighbor = Current + Dir;
-            if (Neighbor.X >= 0 && Neighbor.X < GridWidth && Neighbor.Y >= 0 && Neighbor.Y < GridHeight)
+            const int32 Index = Bucket.Pop(EAllowShrinking::No);
+            Pending--;
+            if (Grid.Cost[Index] != Current) continue; // ورودی قدیمی
+
+            const int32 X = Index % GridWidth;
+            const int32 Y = Index / GridWidth;
+
+            for (int32 d = 0; d < 8; d++)
             {
-                int32 NIndex = Neighbor.Y * GridWidth + Neighbor.X;
-                const FFlowFieldCell& NCell = FlowFieldGrid[NIndex];
-                if (!Visited[NIndex] && !NCell.bObstacle && NCell.bInCorridor)
+                const int32 NX = X + Directions[d].X;
+                const int32 NY = Y + Directions[d].Y;
+                if (!IsOpen(NX, NY)) continue;
+
+                const bool bDiagonal = d >= 4;
+                if (bDiagonal && (!IsOpen(NX, Y) || !IsOpen(X, NY))) continue;
+
+                const int32 NIndex = NY * GridWidth + NX;
+                const int32 Step = bDiagonal ? EnterCost[NIndex] * FlowFieldBuild::DiagonalStepCost / FlowFieldBuild::StraightStepCost : EnterCost[NIndex];
+                const int32 NewCost = Current + Step;
+                if (NewCost < Grid.Cost[NIndex] && NewCost < FFlowFieldGrid::UnreachableCost)
                 {
-                    Visited[NIndex] = true;
-                    Queue.Enqueue(Neighbor);
+                    Grid.Cost[NIndex] = (uint16)NewCost;
+                    Buckets[NewCost % NumBuckets].Add(NIndex);
+                    Pending++;
                 }
             }
         }
     }
 
-    // حذف سلول‌هایی که به مقصد وصل نیستند (Dead Ends)
+    // حذف سلول‌هایی که به هدف وصل نیستند (Dead Ends)
     int32 RemovedCount = 0;
-    for (int32 i = 0; i < FlowFieldGrid.Num(); i++)
+    for (int32 i = 0; i < Grid.Num(); i++)
     {
-        if (FlowFieldGrid[i].bInCorridor && !Visited[i])
+        if (Grid.HasFlag(i, FFlowFieldGrid::Flag_InCorridor) && Grid.Cost[i] == FFlowFieldGrid::UnreachableCost)
         {
-            FlowFieldGrid[i].bInCorridor = false;
-            FlowFieldGrid[i].PathVector = FVector::ZeroVector;
-            FlowFieldGrid[i].Direction = FVector::ZeroVector;
+            Grid.ClearFlag(i, FFlowFieldGrid::Flag_InCorridor);
+            Grid.SetPathVector(i, FVector::ZeroVector);
+            Grid.SetDirection(i, FVector::ZeroVector);
             RemovedCount++;
         }
     }
 
-    UE_LOG(LogTemp, Warning, TEXT("MarkReachableCells: Removed %d dead-end cells."), RemovedCount);
+    UE_LOG(LogTemp, Verbose, TEXT("IntegrateCostField: Removed %d dead-end cells."), RemovedCount);
 }
 
-void UFlowFieldComponent::SmoothDirections(int32 Iterations /*= 5*/) // افزایش تکرار برای نرم‌تر شدن
+// جهت هر سلول = خلاف گرادیان هزینه (Sobel روی ۸ همسایه)؛ همسایه بسته هزینه خود سلول را می‌گیرد
+// اگر گرادیان صفر باشد (قله/زین) کم‌هزینه‌ترین همسایه، و در نهایت PathVector استفاده می‌شود
+static void DirectionsFromCostGradient(FFlowFieldGrid& Grid)
 {
-    if (FlowFieldGrid.Num() == 0 || Iterations <= 0) return;
-
-    TArray<FFlowFieldCell> TempGrid = FlowFieldGrid;
+    const int32 GridWidth = Grid.Width;
+    const int32 GridHeight = Grid.Height;
 
-    const TArray<FIntPoint> Directions = {
-        FIntPoint(0,1), FIntPoint(0,-1), FIntPoint(1,0), FIntPoint(-1,0)
-    };
+    constexpr uint8 OpenMask = FFlowFieldGrid::Flag_InCorridor | FFlowFieldGrid::Flag_Obstacle;
 
-    for (int32 Iter = 0; Iter < Iterations; ++Iter)
+    for (int32 y = 0; y < GridHeight; y++)
     {
-        for (int32 y = 0; y < GridHeight; ++y)
+        for (int32 x = 0; x < GridWidth; x++)
         {
-            for (int32 x = 0; x < GridWidth; ++x)
-            {
-                int32 Index = y * GridWidth + x;
-                const FFlowFieldCell& Cell = FlowFieldGrid[Index];
-                if (Cell.bObstacle || !Cell.bInCorridor) continue;
+            const int32 Index = y * GridWidth + x;
+            if ((Grid.Flags[Index] & OpenMask) != FFlowFieldGrid::Flag_InCorridor) continue;
 
-                FVector AvgDir = Cell.Direction;
-                int32 Count = 1;
+            const float Own = Grid.Cost[Index];
+            float C[3][3];
+            float BestCost = Own;
+            FVector BestDir = FVector::ZeroVector;
 
-                for (const FIntPoint& Dir : Directions)
+            for (int32 oy = -1; oy <= 1; oy++)
+            {
+                for (int32 ox = -1; ox <= 1; ox++)
                 {
-                    int32 nx = x + Dir.X;
-                    int32 ny = y + Dir.Y;
-                    if (nx >= 0 && nx < GridWidth && ny >= 0 && ny < GridHeight)
+                    const int32 NX = x + ox;
+                    const int32 NY = y + oy;
+                    float NeighborCost = Own;
+                    if (Grid.IsValidCoord(NX, NY))
                     {
-                        int32 NIndex = ny * GridWidth + nx;
-                        const FFlowFieldCell& NCell = FlowFieldGrid[NIndex];
-                        if (!NCell.bObstacle && NCell.bInCorridor && !NCell.Direction.IsNearlyZero())
+                        const int32 NIndex = NY * GridWidth + NX;
+                        if ((Grid.Flags[NIndex] & OpenMask) == FFlowFieldGrid::Flag_InCorridor)
                         {
-                            AvgDir += NCell.Direction;
-                            Count++;
+                            NeighborCost = Grid.Cost[NIndex];
                         }
                     }
-                }
+                    C[oy + 1][ox + 1] = NeighborCost;
 
-                if (Count > 1)
-                {
-                    TempGrid[Index].Direction = (AvgDir / Count).GetSafeNormal();
+                    if (NeighborCost < BestCost)
+                    {
+                        BestCost = NeighborCost;
+                        BestDir = FVector(ox, oy, 0.f);
+                    }
                 }
             }
+
+            const float GradX = (C[0][2] + 2.f * C[1][2] + C[2][2]) - (C[0][0] + 2.f * C[1][0] + C[2][0]);
+            const float GradY = (C[2][0] + 2.f * C[2][1] + C[2][2]) - (C[0][0] + 2.f * C[0][1] + C[0][2]);
+            const FVector Downhill(-GradX, -GradY, 0.f);
+
+            if (!Downhill.IsNearlyZero())
+                Grid.SetDirection(Index, Downhill.GetSafeNormal());
+            else if (!BestDir.IsZero())
+                Grid.SetDirection(Index, BestDir.GetSafeNormal());
+            else
+                Grid.SetDirection(Index, Grid.GetPathVector(Index)); // خود هدف
+        }
+    }
+}
+
+// صفحه‌های کاری Smoothing — برای هر Thread یک بار رزرو و بعد فقط دوباره استفاده می‌شوند
+struct FFlowFieldSmoothingScratch
+{
+    TArray<float> X[2];
+    TArray<float> Y[2];
+    TArray<float> Valid[2];     // ۱ = سلول کریدور با جهت معتبر (وزن همسایه)
+    TArray<float> Open;         // ۱ = سلول کریدور بدون مانع (قابل به‌روزرسانی)
+
+    void Prepare(int32 NumPadded)
+    {
+        for (int32 Buffer = 0; Buffer < 2; Buffer++)
+        {
+            X[Buffer].SetNumUninitialized(NumPadded, EAllowShrinking::No);
+            Y[Buffer].SetNumUninitialized(NumPadded, EAllowShrinking::No);
+            Valid[Buffer].SetNumUninitialized(NumPadded, EAllowShrinking::No);
         }
-        FlowFieldGrid = TempGrid;
+        Open.SetNumUninitialized(NumPadded, EAllowShrinking::No);
     }
+};
+
+// میانگین ۴ همسایه روی صفحه‌های float2 با حاشیه یک‌سلولی صفر (بدون شرط مرزی) و بافر Ping-Pong
+// حلقه داخلی بدون انشعاب است تا کامپایلر بتواند آن را Vectorize کند؛ هزینه هر تکرار فقط یک پیمایش گرید است
+static void SmoothDirections(FFlowFieldGrid& Grid, int32 Iterations) // افزایش تکرار برای نرم‌تر شدن
+{
+    if (Grid.Num() == 0 || Iterations <= 0) return;
+
+    const int32 W = Grid.Width;
+    const int32 H = Grid.Height;
+    const int32 PW = W + 2;                 // عرض با حاشیه
+    const int32 NumPadded = PW * (H + 2);
+
+    constexpr uint8 OpenMask = FFlowFieldGrid::Flag_InCorridor | FFlowFieldGrid::Flag_Obstacle;
+    constexpr float MinLengthSq = 1e-8f;    // همان آستانه GetSafeNormal
 
-    UE_LOG(LogTemp, Warning, TEXT("Smoothed directions over %d iterations."), Iterations);
+    static thread_local FFlowFieldSmoothingScratch Scratch;
+    Scratch.Prepare(NumPadded);
+
+    // حاشیه همیشه صفر است (نه جهت، نه وزن)
+    for (int32 Buffer = 0; Buffer < 2; Buffer++)
+    {
+        FMemory::Memzero(Scratch.X[Buffer].GetData(), NumPadded * sizeof(float));
+        FMemory::Memzero(Scratch.Y[Buffer].GetData(), NumPadded * sizeof(float));
+        FMemory::Memzero(Scratch.Valid[Buffer].GetData(), NumPadded * sizeof(float));
+    }
+    FMemory::Memzero(Scratch.Open.GetData(), NumPadded * sizeof(float));
+
+    // یک بار Decode از زاویه‌های فشرده
+    for (int32 y = 0; y < H; y++)
+    {
+        for (int32 x = 0; x < W; x++)
+        {
+            const int32 Index = y * W + x;
+            const int32 P = (y + 1) * PW + (x + 1);
+            const uint8 CellFlags = Grid.Flags[Index];
+            const bool bOpen = (CellFlags & OpenMask) == FFlowFieldGrid::Flag_InCorridor;
+
+            Scratch.Open[P] = bOpen ? 1.f : 0.f;
+            if (bOpen && (CellFlags & FFlowFieldGrid::Flag_HasDirection))
+            {
+                const FVector Dir = FFlowFieldGrid::DecodeAngle(Grid.Direction[Index]);
+                Scratch.X[0][P] = (float)Dir.X;
+                Scratch.Y[0][P] = (float)Dir.Y;
+                Scratch.Valid[0][P] = 1.f;
+            }
+        }
+    }
+
+    int32 Src = 0;
+    for (int32 Iter = 0; Iter < Iterations; ++Iter)
+    {
+        const int32 Dst = Src ^ 1;
+        const float* RESTRICT SX = Scratch.X[Src].GetData();
+        const float* RESTRICT SY = Scratch.Y[Src].GetData();
+        const float* RESTRICT SV = Scratch.Valid[Src].GetData();
+        const float* RESTRICT Open = Scratch.Open.GetData();
+        float* RESTRICT DX = Scratch.X[Dst].GetData();
+        float* RESTRICT DY = Scratch.Y[Dst].GetData();
+        float* RESTRICT DV = Scratch.Valid[Dst].GetData();
+
+        for (int32 y = 1; y <= H; y++)
+        {
+            const int32 RowStart = y * PW + 1;
+            const int32 RowEnd = RowStart + W;
+            for (int32 P = RowStart; P < RowEnd; P++)
+            {
+                // خود سلول همیشه با وزن ۱ شمرده می‌شود (حتی بدون جهت) — مثل نسخه قبلی
+                const float NeighborCount = SV[P - 1] + SV[P + 1] + SV[P - PW] + SV[P + PW];
+                const float SumX = SX[P] + SX[P - 1] + SX[P + 1] + SX[P - PW] + SX[P + PW];
+                const float SumY = SY[P] + SY[P - 1] + SY[P + 1] + SY[P - PW] + SY[P + PW];
+
+                const float InvCount = 1.f / (1.f + NeighborCount);
+                const float AvgX = SumX * InvCount;
+                const float AvgY = SumY * InvCount;
+                const float LengthSq = AvgX * AvgX + AvgY * AvgY;
+                const bool bHasLength = LengthSq > MinLengthSq;
+                const float InvLength = bHasLength ? FMath::InvSqrt(LengthSq) : 0.f;
+
+                // فقط سلول باز با حداقل یک همسایه معتبر تغییر می‌کند
+                const bool bUpdate = Open[P] * NeighborCount > 0.f;
+                DX[P] = bUpdate ? AvgX * InvLength : SX[P];
+                DY[P] = bUpdate ? AvgY * InvLength : SY[P];
+                DV[P] = bUpdate ? (bHasLength ? 1.f : 0.f) : SV[P];
+            }
+        }
+        Src = Dst;
+    }
+
+    // یک بار Encode به زاویه‌های فشرده
+    for (int32 y = 0; y < H; y++)
+    {
+        for (int32 x = 0; x < W; x++)
+        {
+            const int32 Index = y * W + x;
+            const int32 P = (y + 1) * PW + (x + 1);
+            if (Scratch.Open[P] == 0.f) continue;
+
+            if (Scratch.Valid[Src][P] > 0.f)
+            {
+                Grid.SetFlag(Index, FFlowFieldGrid::Flag_HasDirection);
+                Grid.Direction[Index] = FFlowFieldGrid::EncodeAngle(FVector(Scratch.X[Src][P], Scratch.Y[Src][P], 0.f));
+            }
+            else
+            {
+                Grid.ClearFlag(Index, FFlowFieldGrid::Flag_HasDirection);
+            }
+        }
+    }
+
+    UE_LOG(LogTemp, Verbose, TEXT("Smoothed directions over %d iterations."), Iterations);
 }
 
 static float DistanceFromPath(const FVector& Point, const TArray<FVector>& Path)
@@ -202,10 +725,89 @@ static float DistanceFromPath(const FVector& Point, const TArray<FVector>& Path)
     return MinDist;
 }
 
-void UFlowFieldComponent::BuildCorridorFromPath(const TArray<FVector>& Path, int32 CorridorWidthCm)
+// Distance Transform یک‌بعدی (Felzenszwalb-Huttenlocher) روی پوش پایینی سهمی‌ها
+// F: مقدار هر نقطه، OutD: کمترین (q-p)^2 + F[p]
+static void DistanceTransform1D(const float* F, int32 N, float* OutD, int32* V, float* Z)
+{
+    const float Inf = 1e20f;
+    int32 K = 0;
+    V[0] = 0;
+    Z[0] = -Inf;
+    Z[1] = Inf;
+
+    for (int32 Q = 1; Q < N; Q++)
+    {
+        float S = ((F[Q] + Q * Q) - (F[V[K]] + V[K] * V[K])) / (2 * Q - 2 * V[K]);
+        while (S <= Z[K])
+        {
+            K--;
+            S = ((F[Q] + Q * Q) - (F[V[K]] + V[K] * V[K])) / (2 * Q - 2 * V[K]);
+        }
+        K++;
+        V[K] = Q;
+        Z[K] = S;
+        Z[K + 1] = Inf;
+    }
+
+    K = 0;
+    for (int32 Q = 0; Q < N; Q++)
+    {
+        while (Z[K + 1] < Q) K++;
+        OutD[Q] = FMath::Square((float)(Q - V[K])) + F[V[K]];
+    }
+}
+
+// فاصله اقلیدسی دقیق (به توان ۲، بر حسب سلول) هر سلول تا نزدیک‌ترین مانع — ورودی هزینه نزدیکی به مانع در میدان انتگرال
+// دو پاس جدا (ستون‌ها سپس سطرها) → O(تعداد سلول‌ها)
+static void ComputeObstacleDistanceTransform(const FFlowFieldGrid& Grid, TArray<float>& OutDistSq)
+{
+    const int32 W = Grid.Width;
+    const int32 H = Grid.Height;
+    const float Inf = 1e20f;
+
+    OutDistSq.SetNumUninitialized(W * H);
+
+    const int32 MaxDim = FMath::Max(W, H);
+    TArray<float> F, D, Z;
+    TArray<int32> V;
+    F.SetNumUninitialized(MaxDim);
+    D.SetNumUninitialized(MaxDim);
+    Z.SetNumUninitialized(MaxDim + 1);
+    V.SetNumUninitialized(MaxDim);
+
+    // پاس ۱: هر ستون → نزدیک‌ترین مانع در همان ستون
+    TArray<float> ColDistSq;
+    ColDistSq.SetNumUninitialized(W * H);
+
+    for (int32 x = 0; x < W; x++)
+    {
+        for (int32 y = 0; y < H; y++)
+        {
+            F[y] = Grid.HasFlag(y * W + x, FFlowFieldGrid::Flag_Obstacle) ? 0.f : Inf;
+        }
+        DistanceTransform1D(F.GetData(), H, D.GetData(), V.GetData(), Z.GetData());
+        for (int32 y = 0; y < H; y++)
+        {
+            ColDistSq[y * W + x] = D[y];
+        }
+    }
+
+    // پاس ۲: هر سطر روی نتیجه ستون‌ها → نزدیک‌ترین مانع در کل گرید
+    for (int32 y = 0; y < H; y++)
+    {
+        const int32 Row = y * W;
+        DistanceTransform1D(ColDistSq.GetData() + Row, W, OutDistSq.GetData() + Row, V.GetData(), Z.GetData());
+    }
+}
+
+static void BuildCorridorFromPath(FFlowFieldGrid& Grid, const TArray<FVector>& Path, int32 CorridorWidthCm)
 {
     if (Path.Num() < 2) return;
 
+    const float CellSize = Grid.CellSize;
+    const int32 GridWidth = Grid.Width;
+    const int32 GridHeight = Grid.Height;
+
     int32 HalfWidthCells = FMath::CeilToInt((CorridorWidthCm * 0.5f) / CellSize);
     HalfWidthCells = FMath::Max(1, HalfWidthCells);
 
@@ -227,17 +829,16 @@ void UFlowFieldComponent::BuildCorridorFromPath(const TArray<FVector>& Path, int
             for (int32 offset = -HalfWidthCells; offset <= HalfWidthCells; offset++)
             {
                 FVector OffsetPos = Center + RightDir * offset * CellSize;
-                FIntPoint CellIndex = WorldToGrid(OffsetPos);
+                FIntPoint CellIndex = Grid.WorldToGrid(OffsetPos);
 
                 if (CellIndex.X >= 0 && CellIndex.X < GridWidth && CellIndex.Y >= 0 && CellIndex.Y < GridHeight)
                 {
                     int32 FlatIndex = CellIndex.Y * GridWidth + CellIndex.X;
-                    FFlowFieldCell& Cell = FlowFieldGrid[FlatIndex];
 
-                    if (!Cell.bObstacle)
+                    if (!Grid.HasFlag(FlatIndex, FFlowFieldGrid::Flag_Obstacle))
                     {
-                        Cell.bInCorridor = true;
-                        Cell.PathVector = ForwardDir;
+                        Grid.SetFlag(FlatIndex, FFlowFieldGrid::Flag_InCorridor);
+                        Grid.SetPathVector(FlatIndex, ForwardDir);
                     }
                 }
             }
@@ -252,19 +853,18 @@ void UFlowFieldComponent::BuildCorridorFromPath(const TArray<FVector>& Path, int
                 for (int32 ox = -HalfWidthCells; ox <= HalfWidthCells; ox++)
                 {
                     FVector SamplePos = CornerCenter + FVector(ox * CellSize, oy * CellSize, 0);
-                    FIntPoint CornerIndex = WorldToGrid(SamplePos);
+                    FIntPoint CornerIndex = Grid.WorldToGrid(SamplePos);
 
                     if (CornerIndex.X >= 0 && CornerIndex.X < GridWidth && CornerIndex.Y >= 0 && CornerIndex.Y < GridHeight)
                     {
                         int32 FlatIndex = CornerIndex.Y * GridWidth + CornerIndex.X;
-                        FFlowFieldCell& Cell = FlowFieldGrid[FlatIndex];
 
-                        if (!Cell.bObstacle)
+                        if (!Grid.HasFlag(FlatIndex, FFlowFieldGrid::Flag_Obstacle))
                         {
-                            Cell.bInCorridor = true;
+                            Grid.SetFlag(FlatIndex, FFlowFieldGrid::Flag_InCorridor);
                             FVector PrevF = (Path[i + 1] - Path[i]).GetSafeNormal();
                             FVector NextF = (Path[i + 2] - Path[i + 1]).GetSafeNormal();
-                            Cell.PathVector = (PrevF + NextF).GetSafeNormal();
+                            Grid.SetPathVector(FlatIndex, (PrevF + NextF).GetSafeNormal());
                         }
                     }
                 }
@@ -273,190 +873,741 @@ void UFlowFieldComponent::BuildCorridorFromPath(const TArray<FVector>& Path, int
     }
 }
 
-void UFlowFieldComponent::GenerateFlowField(const FVector& Destination, const TArray<FVector>& Path, int32 CorridorWidthCm)
+// برش پارامتری پاره‌خط با مستطیل (Liang-Barsky)؛ false یعنی پاره‌خط از مستطیل نمی‌گذرد
+static bool ClipSegmentToBox(const FVector& A, const FVector& B, const FBox2D& Box, double& OutT0, double& OutT1)
+{
+    const double Dx = B.X - A.X;
+    const double Dy = B.Y - A.Y;
+    const double P[4] = { -Dx, Dx, -Dy, Dy };
+    const double Q[4] = { A.X - Box.Min.X, Box.Max.X - A.X, A.Y - Box.Min.Y, Box.Max.Y - A.Y };
+
+    OutT0 = 0.0;
+    OutT1 = 1.0;
+    for (int32 k = 0; k < 4; k++)
+    {
+        if (FMath::IsNearlyZero(P[k]))
+        {
+            if (Q[k] < 0.0) return false; // موازی و بیرون
+            continue;
+        }
+
+        const double T = Q[k] / P[k];
+        if (P[k] < 0.0)
+            OutT0 = FMath::Max(OutT0, T);
+        else
+            OutT1 = FMath::Min(OutT1, T);
+
+        if (OutT0 > OutT1) return false;
+    }
+    return true;
+}
+
+bool UFlowFieldComponent::PrepareBuildPlan(const FVector& Destination, const TArray<FVector>& Path, int32 CorridorWidthCm, FFlowFieldBuildPlan& OutPlan, const TSet<FIntPoint>* OnlySectors) const
 {
     if (!PathfinderComp || Path.Num() < 2)
     {
         UE_LOG(LogTemp, Warning, TEXT("FlowFieldComponent: Cannot generate flowfield - missing path or pathfinder."));
-        return;
+        return false;
     }
 
-    FlowFieldDestination = Destination;
+    const float LocalCellSize = GetCellSize();
+
+    // حاشیه پنجره باید دافعه و چند تکرار Smoothing را از سکتورهای همسایه ببیند تا روی مرزها درز نیفتد
+    // سکتور هم نباید از حاشیه کوچک‌تر باشد تا پنجره فقط به همسایه‌های مستقیم برسد
+    const int32 SmoothingPasses = FMath::Clamp(SmoothingIterations, 0, MaxSmoothingIterations);
+    const int32 HaloCells = GetSectorHaloCells(LocalCellSize, SmoothingPasses);
+    const int32 SectorCells = FMath::Max(SectorSizeCells, HaloCells);
+    const float SectorCm = LocalCellSize * SectorCells;
+
+    OutPlan.Destination = Destination;
+    OutPlan.Path = Path;
+    OutPlan.CorridorWidthCm = CorridorWidthCm;
+    OutPlan.CellSize = LocalCellSize;
+    OutPlan.SectorSizeCells = SectorCells;
+    OutPlan.HaloCells = HaloCells;
+
+    // 1. زنجیره سکتورها به ترتیب مسیر
+    // مسیر NavMesh خودش جستجوی درشت است؛ هر نمونه مسیر سکتورهای زیر پهنای کریدور (+ یک سلول) را اضافه می‌کند
+    const float ReachCm = FMath::Max(1, FMath::CeilToInt((CorridorWidthCm * 0.5f) / LocalCellSize)) * LocalCellSize + LocalCellSize;
+
+    TMap<FIntPoint, int32> ChainOrder;
+    auto AddSectorsAround = [&ChainOrder, &OutPlan, ReachCm, SectorCm](const FVector& Sample)
+    {
+        const int32 MinX = FMath::FloorToInt((Sample.X - ReachCm) / SectorCm);
+        const int32 MaxX = FMath::FloorToInt((Sample.X + ReachCm) / SectorCm);
+        const int32 MinY = FMath::FloorToInt((Sample.Y - ReachCm) / SectorCm);
+        const int32 MaxY = FMath::FloorToInt((Sample.Y + ReachCm) / SectorCm);
+
+        for (int32 sy = MinY; sy <= MaxY; sy++)
+        {
+            for (int32 sx = MinX; sx <= MaxX; sx++)
+            {
+                const FIntPoint SectorCoord(sx, sy);
+                if (!ChainOrder.Contains(SectorCoord))
+                {
+                    ChainOrder.Add(SectorCoord, OutPlan.SectorChain.Num());
+                    OutPlan.SectorChain.Add(SectorCoord);
+                }
+            }
+        }
+    };
+
+    // سکتور بعدی = جایی که مسیر برای آخرین بار از سکتور خارج می‌شود
+    // (زمان آخرین خروج در امتداد Next صعودی است، پس حلقه ساخته نمی‌شود)
+    TSet<FIntPoint> PathSectors;
+    FIntPoint PrevSector(MAX_int32, MAX_int32);
+    auto TrackExit = [&OutPlan, &PathSectors, &PrevSector, SectorCm](const FVector& Sample)
+    {
+        const FIntPoint SectorCoord(FMath::FloorToInt(Sample.X / SectorCm), FMath::FloorToInt(Sample.Y / SectorCm));
+        const FIntPoint Delta = SectorCoord - PrevSector;
+        if (PrevSector.X != MAX_int32 && SectorCoord != PrevSector && FMath::Abs(Delta.X) <= 1 && FMath::Abs(Delta.Y) <= 1)
+        {
+            OutPlan.NextSectors.Add(PrevSector, SectorCoord);
+        }
+        PathSectors.Add(SectorCoord);
+        PrevSector = SectorCoord;
+    };
 
-    // محاسبه Bounds با padding
-    FVector Min = Path[0];
-    FVector Max = Path[0];
-    for (const FVector& P : Path)
+    for (int32 i = 0; i < Path.Num() - 1; i++)
     {
-        Min = Min.ComponentMin(P);
-        Max = Max.ComponentMax(P);
+        const int32 NumSamples = FMath::Max(1, FMath::CeilToInt(FVector::Dist2D(Path[i], Path[i + 1]) / LocalCellSize));
+        for (int32 s = 0; s <= NumSamples; s++)
+        {
+            const FVector Sample = FMath::Lerp(Path[i], Path[i + 1], (float)s / NumSamples);
+            AddSectorsAround(Sample);
+            TrackExit(Sample);
+        }
     }
-    Min = Min.ComponentMin(Destination);
-    Max = Max.ComponentMax(Destination);
+    AddSectorsAround(Destination);
+    TrackExit(Destination);
 
-    const float PaddingCm = 500.f;
-    Min -= FVector(PaddingCm, PaddingCm, 0);
-    Max += FVector(PaddingCm, PaddingCm, 0);
+    // سکتورهای کناری کریدور (مسیر از آن‌ها نمی‌گذرد) به دورترین همسایه روی مسیر می‌ریزند
+    // فقط همسایه‌های دیرتر زنجیره، تا دو سکتور هدف هم نشوند
+    for (int32 ChainIndex = 0; ChainIndex < OutPlan.SectorChain.Num(); ChainIndex++)
+    {
+        const FIntPoint SectorCoord = OutPlan.SectorChain[ChainIndex];
+        if (PathSectors.Contains(SectorCoord)) continue;
 
-    float LocalCellSize = GetCellSize();
-    Origin = FVector(Min.X, Min.Y, 0);
-    GridWidth = FMath::Max(1, FMath::CeilToInt((Max.X - Min.X) / LocalCellSize));
-    GridHeight = FMath::Max(1, FMath::CeilToInt((Max.Y - Min.Y) / LocalCellSize));
+        const FIntPoint* BestNeighbor = nullptr;
+        int32 BestOrder = ChainIndex;
+        bool bBestOnPath = false;
+        for (int32 dy = -1; dy <= 1; dy++)
+        {
+            for (int32 dx = -1; dx <= 1; dx++)
+            {
+                const FIntPoint NeighborCoord = SectorCoord + FIntPoint(dx, dy);
+                const int32* NeighborOrder = ChainOrder.Find(NeighborCoord);
+                if (!NeighborOrder || *NeighborOrder <= ChainIndex) continue;
 
-    FlowFieldGrid.Init(FFlowFieldCell(), GridWidth * GridHeight);
-    DebugCorridorWidthCells = CorridorWidthCm;
+                const bool bOnPath = PathSectors.Contains(NeighborCoord);
+                if ((bOnPath && !bBestOnPath) || (bOnPath == bBestOnPath && *NeighborOrder > BestOrder))
+                {
+                    BestNeighbor = &OutPlan.SectorChain[*NeighborOrder];
+                    BestOrder = *NeighborOrder;
+                    bBestOnPath = bOnPath;
+                }
+            }
+        }
 
-    // 1. ساخت کریدور
-    BuildCorridorFromPath(Path, CorridorWidthCm);
+        if (BestNeighbor)
+        {
+            OutPlan.NextSectors.Add(SectorCoord, *BestNeighbor);
+        }
+    }
 
-    // 2. حذف Dead Ends
-    MarkReachableCellsFromDestination();
+    // 2. هر سکتور: پنجره ساخت (سکتور + حاشیه)، پورتال‌ها و بخش بریده‌شده مسیر
+    const int32 WindowCells = SectorCells + 2 * HaloCells;
+    const float WalkabilityHeightCm = 200.f; // بازه ارتفاع بالا/پایین مسیر برای جمع‌آوری موانع
 
-    // 3. رسم دیباگ کریدور
-    DrawDebugCorridor(Path, CorridorWidthCm);
+    UFlowFieldCacheSubsystem* Cache = GetWorld() ? GetWorld()->GetSubsystem<UFlowFieldCacheSubsystem>() : nullptr;
+    UWalkabilityCacheSubsystem* WalkabilityCache = GetWorld() ? GetWorld()->GetSubsystem<UWalkabilityCacheSubsystem>() : nullptr;
+    OutPlan.ObstacleEpoch = Cache ? Cache->GetObstacleEpoch() : 0;
 
-    // 4. شناسایی موانع (از Pathfinder)
-    for (int32 y = 0; y < GridHeight; y++)
+    for (int32 ChainIndex = 0; ChainIndex < OutPlan.SectorChain.Num(); ChainIndex++)
     {
-        for (int32 x = 0; x < GridWidth; x++)
+        const FIntPoint SectorCoord = OutPlan.SectorChain[ChainIndex];
+        if (OnlySectors && !OnlySectors->Contains(SectorCoord)) continue;
+
+        FFlowFieldBuildInput Input;
+        Input.Destination = Destination;
+        Input.CorridorWidthCm = CorridorWidthCm;
+        Input.CellSize = LocalCellSize;
+        Input.SmoothingIterations = SmoothingPasses;
+        Input.Origin = FVector(SectorCoord.X * SectorCm - HaloCells * LocalCellSize, SectorCoord.Y * SectorCm - HaloCells * LocalCellSize, 0);
+        Input.Width = WindowCells;
+        Input.Height = WindowCells;
+        Input.CoreRect = FIntRect(HaloCells, HaloCells, HaloCells + SectorCells, HaloCells + SectorCells);
+
+        // پورتال: فقط وجه مشترک با سکتور بعدی (حاشیه از یک سکتور بزرگ‌تر نیست)
+        // چند پورتال با Cost صفر روی مرز سکتورها پرش هزینه می‌ساخت
+        // اگر مقصد داخل پنجره باشد تنها هدف همان مقصد است؛ سکتورهای بعدی فقط دور مقصد هستند
+        const FIntPoint LocalDestination(
+            FMath::FloorToInt((Destination.X - Input.Origin.X) / LocalCellSize),
+            FMath::FloorToInt((Destination.Y - Input.Origin.Y) / LocalCellSize));
+        const bool bDestinationInWindow = LocalDestination.X >= 0 && LocalDestination.Y >= 0 && LocalDestination.X < WindowCells && LocalDestination.Y < WindowCells;
+
+        const FIntPoint* NextSector = OutPlan.NextSectors.Find(SectorCoord);
+        if (NextSector && !bDestinationInWindow)
+        {
+            const FIntPoint Offset = *NextSector - SectorCoord;
+            FIntRect Portal(
+                HaloCells + Offset.X * SectorCells, HaloCells + Offset.Y * SectorCells,
+                HaloCells + (Offset.X + 1) * SectorCells, HaloCells + (Offset.Y + 1) * SectorCells);
+            Portal.Clip(FIntRect(0, 0, WindowCells, WindowCells));
+            if (Portal.Area() > 0)
+            {
+                Input.PortalRects.Add(Portal);
+            }
+        }
+
+        // فقط بخشی از مسیر که به پنجره (به‌علاوه پهنای کریدور) می‌رسد؛ دو سر آن روی لبه بریده می‌شود
+        // تا سفارش‌هایی که از همین سکتور با همین خط می‌گذرند کلید کش یکسان بگیرند
+        const FBox2D ClipBox(
+            FVector2D(Input.Origin.X - ReachCm, Input.Origin.Y - ReachCm),
+            FVector2D(Input.Origin.X + WindowCells * LocalCellSize + ReachCm, Input.Origin.Y + WindowCells * LocalCellSize + ReachCm));
+
+        int32 FirstSegment = INDEX_NONE;
+        int32 LastSegment = INDEX_NONE;
+        double FirstT0 = 0.0, LastT1 = 1.0;
+        for (int32 i = 0; i < Path.Num() - 1; i++)
         {
-            int32 Index = y * GridWidth + x;
-            FFlowFieldCell& Cell = FlowFieldGrid[Index];
-            FVector WorldPos = GridIndexToWorld(FIntVector(x, y, 0));
-            if (!PathfinderComp->IsLocationWalkable(WorldPos))
+            double T0, T1;
+            if (!ClipSegmentToBox(Path[i], Path[i + 1], ClipBox, T0, T1)) continue;
+
+            if (FirstSegment == INDEX_NONE)
             {
-                Cell.bObstacle = true;
-                Cell.bInCorridor = false;
-                Cell.Direction = FVector::ZeroVector;
+                FirstSegment = i;
+                FirstT0 = T0;
             }
+            LastSegment = i;
+            LastT1 = T1;
         }
+
+        if (FirstSegment == INDEX_NONE) continue; // فقط مقصد نزدیک این سکتور بود
+
+        Input.Path.Reserve(LastSegment - FirstSegment + 2);
+        Input.Path.Add(FMath::Lerp(Path[FirstSegment], Path[FirstSegment + 1], FirstT0));
+        for (int32 i = FirstSegment + 1; i <= LastSegment; i++)
+        {
+            Input.Path.Add(Path[i]);
+        }
+        Input.Path.Add(FMath::Lerp(Path[LastSegment], Path[LastSegment + 1], LastT1));
+
+        // سکتوری که با همین کریدور قبلاً ساخته شده، دوباره ساخته نمی‌شود
+        const FFlowFieldCacheKey CacheKey = UFlowFieldCacheSubsystem::MakeSectorKey(SectorCoord, Input);
+        if (Cache)
+        {
+            TSharedPtr<const FFlowFieldGrid> Cached = Cache->Find(CacheKey);
+            if (Cached.IsValid())
+            {
+                OutPlan.CachedSectors.Add(SectorCoord, Cached);
+                continue;
+            }
+        }
+
+        // هندسه NavMesh و موانع پنجره روی Game Thread جمع‌آوری می‌شود (Rasterize بعداً و بدون World)
+        float MinZ = Input.Path[0].Z;
+        float MaxZ = Input.Path[0].Z;
+        for (const FVector& P : Input.Path)
+        {
+            MinZ = FMath::Min(MinZ, (float)P.Z);
+            MaxZ = FMath::Max(MaxZ, (float)P.Z);
+        }
+
+        const FBox WindowBounds(
+            FVector(Input.Origin.X, Input.Origin.Y, MinZ - WalkabilityHeightCm),
+            FVector(Input.Origin.X + WindowCells * LocalCellSize, Input.Origin.Y + WindowCells * LocalCellSize, MaxZ + WalkabilityHeightCm));
+
+        // NavMesh و موانع ثابت از کش Walkability (که تایل‌های Bake شده را مستقیم Decode می‌کند)؛ از World فقط یونیت‌ها
+        if (WalkabilityCache && WalkabilityCache->SampleWalkability(
+            FVector2D(Input.Origin.X, Input.Origin.Y), LocalCellSize, Input.Width, Input.Height, (MinZ + MaxZ) * 0.5f, Input.Walkable))
+        {
+            Input.bHasStaticWalkable = true;
+            Input.bHasGeometry = UGridPathfinderComponent::GatherWorldWalkabilityGeometry(
+                GetWorld(), WindowBounds, PathfinderComp->CharacterRadius * 0.9f, EWalkabilityLayers::Units, PathfinderComp->GetOwner(), Input.Geometry);
+            Input.bHasUnitObstacles = Input.Geometry.Obstacles.Num() > 0;
+        }
+        else
+        {
+            // لایه ثابت و یونیت‌ها جدا جمع می‌شوند تا معلوم باشد سکتور یونیت دارد یا نه
+            const float ObstacleInflation = PathfinderComp->CharacterRadius * 0.9f;
+            Input.bHasGeometry = UGridPathfinderComponent::GatherWorldWalkabilityGeometry(
+                GetWorld(), WindowBounds, ObstacleInflation, EWalkabilityLayers::Static, PathfinderComp->GetOwner(), Input.Geometry);
+
+            FWalkabilityGeometry UnitGeometry;
+            if (Input.bHasGeometry && UGridPathfinderComponent::GatherWorldWalkabilityGeometry(
+                GetWorld(), WindowBounds, ObstacleInflation, EWalkabilityLayers::Units, PathfinderComp->GetOwner(), UnitGeometry))
+            {
+                Input.bHasUnitObstacles = UnitGeometry.Obstacles.Num() > 0;
+                Input.Geometry.Obstacles.Append(MoveTemp(UnitGeometry.Obstacles));
+            }
+        }
+
+        if (!Input.bHasGeometry && !Input.bHasStaticWalkable)
+        {
+            // fallback: NavMesh از نوع Recast نیست → تست سلول به سلول (فقط روی Game Thread ممکن است)
+            // تست سلول یونیت‌ها را هم می‌بیند و جدا کردنشان ممکن نیست → محافظه‌کارانه کش نمی‌شود
+            Input.bHasUnitObstacles = true;
+            FFlowFieldGrid Layout;
+            Layout.Origin = Input.Origin;
+            Layout.CellSize = LocalCellSize;
+            Layout.Width = Input.Width;
+            Layout.Height = Input.Height;
+
+            Input.Walkable.Init(false, Input.Width * Input.Height);
+            for (int32 y = 0; y < Input.Height; y++)
+            {
+                for (int32 x = 0; x < Input.Width; x++)
+                {
+                    Input.Walkable[y * Input.Width + x] = PathfinderComp->IsLocationWalkable(Layout.GridToWorld(x, y));
+                }
+            }
+        }
+
+        FFlowFieldSectorBuild& Build = OutPlan.Builds.AddDefaulted_GetRef();
+        Build.SectorCoord = SectorCoord;
+        Build.CacheKey = CacheKey;
+        Build.Input = MoveTemp(Input);
     }
 
-    // 5. محاسبه بردار دافعه — فقط از موانع دقیقاً روبه‌رو
-    const float DesiredRepulsionCm = 200.f;           // شعاع تأثیر دافعه
-    const float RepulsionStrength = 2.0f;             // قدرت دافعه (افزایش یافته چون محدودتر شده)
-    const float FrontDotThreshold = 0.866f;           // cos(30°) → فقط موانع با زاویه کمتر از ۳۰ درجه نسبت به جلو
-    int32 RepulsionRadiusCells = FMath::Max(1, FMath::CeilToInt(DesiredRepulsionCm / LocalCellSize));
+    UE_LOG(LogTemp, Log, TEXT("FlowField: %d sectors on path, %d reused from cache, %d to build."),
+        OutPlan.SectorChain.Num(), OutPlan.CachedSectors.Num(), OutPlan.Builds.Num());
 
-    for (int32 y = 0; y < GridHeight; y++)
+    return OutPlan.CachedSectors.Num() + OutPlan.Builds.Num() > 0;
+}
+
+// ساخت کامل گرید فقط از روی اسنپ‌شات ورودی — به World دسترسی ندارد و روی هر Thread قابل اجراست
+static void BuildFlowFieldGrid(const FFlowFieldBuildInput& Input, FFlowFieldGrid& Grid)
+{
+    const TArray<FVector>& Path = Input.Path;
+    const float LocalCellSize = Input.CellSize;
+    const int32 GridWidth = Input.Width;
+
+    Grid.Init(Input.Origin, LocalCellSize, GridWidth, Input.Height);
+
+    // 1. ساخت کریدور
+    BuildCorridorFromPath(Grid, Path, Input.CorridorWidthCm);
+
+    // 2. شناسایی موانع — کل گرید در یک پاس Rasterize می‌شود
+    TBitArray<> RasterizedWalkable;
+    if (Input.bHasGeometry && Input.bHasStaticWalkable)
     {
-        for (int32 x = 0; x < GridWidth; x++)
+        // لایه ثابت آماده است؛ فقط یونیت‌ها رویش Rasterize می‌شوند
+        RasterizedWalkable = Input.Walkable;
+        UGridPathfinderComponent::RasterizeObstacles(Input.Geometry, FVector2D(Input.Origin.X, Input.Origin.Y), LocalCellSize, GridWidth, Input.Height, RasterizedWalkable);
+    }
+    else if (Input.bHasGeometry)
+    {
+        UGridPathfinderComponent::RasterizeWalkability(Input.Geometry, FVector2D(Input.Origin.X, Input.Origin.Y), LocalCellSize, GridWidth, Input.Height, RasterizedWalkable);
+    }
+    const TBitArray<>& Walkable = Input.bHasGeometry ? RasterizedWalkable : Input.Walkable;
+
+    for (int32 Index = 0; Index < Grid.Num(); Index++)
+    {
+        if (!Walkable[Index])
         {
-            int32 Index = y * GridWidth + x;
-            FFlowFieldCell& Cell = FlowFieldGrid[Index];
-            if (Cell.bObstacle || !Cell.bInCorridor || Cell.PathVector.IsNearlyZero()) continue;
+            Grid.SetFlag(Index, FFlowFieldGrid::Flag_Obstacle);
+            Grid.ClearFlag(Index, FFlowFieldGrid::Flag_InCorridor);
+            Grid.SetDirection(Index, FVector::ZeroVector);
+        }
+    }
+
+    // 3. فاصله هر سلول تا نزدیک‌ترین مانع با یک Distance Transform خطی (برای هزینه فاصله از مانع)
+    TArray<float> ObstacleDistSq;
+    ComputeObstacleDistanceTransform(Grid, ObstacleDistSq);
+
+    // 4. میدان انتگرال (هزینه تا هدف) + حذف Dead Ends — بعد از موانع، پس دور زدن مانع را هم می‌بیند
+    IntegrateCostField(Grid, Input, ObstacleDistSq);
+
+    // 5. جهت‌ها از گرادیان هزینه (جایگزین PathVector + بردار دافعه)
+    DirectionsFromCostGradient(Grid);
+
+    // 6. نرم کردن جهت‌ها (Smoothing)
+    SmoothDirections(Grid, Input.SmoothingIterations);
+}
+
+// برش ناحیه خود سکتور از پنجره ساخت (حاشیه دور ریخته می‌شود)
+static void ExtractSector(const FFlowFieldGrid& Window, const FIntRect& Core, FFlowFieldGrid& OutSector)
+{
+    const int32 W = Core.Width();
+    const int32 H = Core.Height();
+    OutSector.Init(Window.Origin + FVector(Core.Min.X * Window.CellSize, Core.Min.Y * Window.CellSize, 0.f), Window.CellSize, W, H);
+
+    for (int32 y = 0; y < H; y++)
+    {
+        const int32 Src = Window.ToIndex(Core.Min.X, Core.Min.Y + y);
+        const int32 Dst = y * W;
+        FMemory::Memcpy(&OutSector.Cost[Dst], &Window.Cost[Src], W * sizeof(uint16));
+        FMemory::Memcpy(&OutSector.Flags[Dst], &Window.Flags[Src], W * sizeof(uint8));
+        FMemory::Memcpy(&OutSector.Direction[Dst], &Window.Direction[Src], W * sizeof(uint16));
+        FMemory::Memcpy(&OutSector.PathDirection[Dst], &Window.PathDirection[Src], W * sizeof(uint16));
+    }
+}
+
+// ساخت گرید سکتورهای کش‌نشده؛ سکتورها مستقل‌اند پس موازی ساخته می‌شوند (به World دسترسی ندارد)
+static void BuildSectorFields(const FFlowFieldBuildPlan& Plan, TArray<TSharedPtr<const FFlowFieldGrid>>& OutSectors)
+{
+    OutSectors.SetNum(Plan.Builds.Num());
+    ParallelFor(Plan.Builds.Num(), [&Plan, &OutSectors](int32 BuildIndex)
+    {
+        const FFlowFieldBuildInput& Input = Plan.Builds[BuildIndex].Input;
 
-            FVector PathDir = Cell.PathVector.GetSafeNormal();
-            FVector Repulsion = FVector::ZeroVector;
-            FVector CellWorld = GridIndexToWorld(FIntVector(x, y, 0));
+        FFlowFieldGrid Window;
+        BuildFlowFieldGrid(Input, Window);
 
-            for (int32 dy = -RepulsionRadiusCells; dy <= RepulsionRadiusCells; dy++)
+        TSharedRef<FFlowFieldGrid> Sector = MakeShared<FFlowFieldGrid>();
+        ExtractSector(Window, Input.CoreRect, *Sector);
+        OutSectors[BuildIndex] = Sector;
+    });
+}
+
+// Cost هر سکتور فقط تا هدف محلی خودش (پورتال سکتور بعدی) است؛ هزینه باقی‌مانده تا مقصد
+// از کم‌هزینه‌ترین سلول مرزی سکتور بعدی برداشته می‌شود (تخمین، برای فاصله و ETA)
+static void ComputeSectorCostOffsets(FFlowFieldSectorMap& Map, const FFlowFieldBuildPlan& Plan)
+{
+    Map.CostOffsets.Reset();
+
+    const float SectorCm = Map.GetSectorSizeCm();
+    const float HaloCm = Plan.HaloCells * Plan.CellSize;
+
+    auto IsDestinationSector = [&Plan, SectorCm, HaloCm](const FIntPoint& SectorCoord)
+    {
+        const FBox2D Window(
+            FVector2D(SectorCoord.X * SectorCm - HaloCm, SectorCoord.Y * SectorCm - HaloCm),
+            FVector2D((SectorCoord.X + 1) * SectorCm + HaloCm, (SectorCoord.Y + 1) * SectorCm + HaloCm));
+        return Window.IsInside(FVector2D(Plan.Destination));
+    };
+
+    auto ComputeOffset = [&Map, &Plan](const FIntPoint& SectorCoord) -> uint32
+    {
+        const FIntPoint* NextSector = Plan.NextSectors.Find(SectorCoord);
+        const TSharedPtr<const FFlowFieldGrid>* NextGrid = NextSector ? Map.Sectors.Find(*NextSector) : nullptr;
+        const uint32* NextOffset = NextSector ? Map.CostOffsets.Find(*NextSector) : nullptr;
+        if (!NextGrid || !NextOffset)
+            return 0;
+
+        // ردیف/ستون (یا گوشه) سکتور بعدی که به این سکتور چسبیده است
+        const FIntPoint Offset = *NextSector - SectorCoord;
+        const FFlowFieldGrid& Grid = **NextGrid;
+        const int32 MinX = Offset.X < 0 ? Grid.Width - 1 : 0;
+        const int32 MaxX = Offset.X > 0 ? 0 : Grid.Width - 1;
+        const int32 MinY = Offset.Y < 0 ? Grid.Height - 1 : 0;
+        const int32 MaxY = Offset.Y > 0 ? 0 : Grid.Height - 1;
+
+        uint32 BestOffset = MAX_uint32;
+        for (int32 y = MinY; y <= MaxY; y++)
+        {
+            for (int32 x = MinX; x <= MaxX; x++)
             {
-                for (int32 dx = -RepulsionRadiusCells; dx <= RepulsionRadiusCells; dx++)
+                const uint16 EdgeCost = Grid.Cost[Grid.ToIndex(x, y)];
+                if (EdgeCost != FFlowFieldGrid::UnreachableCost)
                 {
-                    if (dx == 0 && dy == 0) continue;
-
-                    int32 nx = x + dx;
-                    int32 ny = y + dy;
-                    if (nx >= 0 && nx < GridWidth && ny >= 0 && ny < GridHeight)
-                    {
-                        int32 NIndex = ny * GridWidth + nx;
-                        if (FlowFieldGrid[NIndex].bObstacle)
-                        {
-                            FVector ObstWorld = GridIndexToWorld(FIntVector(nx, ny, 0));
-                            FVector DirToObst = (ObstWorld - CellWorld).GetSafeNormal();
-                            float Dot = FVector::DotProduct(PathDir, DirToObst);
-
-                            // فقط موانع دقیقاً روبه‌رو تأثیر می‌گذارند
-                            if (Dot > FrontDotThreshold)
-                            {
-                                float Dist = FVector::Dist(CellWorld, ObstWorld);
-                                if (Dist <= DesiredRepulsionCm)
-                                {
-                                    // شیب ملایم: هرچه نزدیک‌تر، دافعه قوی‌تر
-                                    float Weight = (1.f - Dist / DesiredRepulsionCm) * RepulsionStrength;
-
-                                    // جهت دافعه: مستقیماً دور شدن از مانع
-                                    FVector RepulseDir = (CellWorld - ObstWorld).GetSafeNormal();
-
-                                    Repulsion += RepulseDir * Weight;
-                                }
-                            }
-                        }
-                    }
+                    BestOffset = FMath::Min(BestOffset, (uint32)EdgeCost + *NextOffset);
                 }
             }
+        }
+        return BestOffset == MAX_uint32 ? 0 : BestOffset;
+    };
+
+    // ترتیب Next همیشه با ترتیب زنجیره یکی نیست (مسیری که به سکتور قبلی برمی‌گردد)؛
+    // از هر سکتور تا اولین سکتور حساب‌شده جلو می‌رویم و در برگشت Offset‌ها را پر می‌کنیم
+    TArray<FIntPoint> Pending;
+    for (const FIntPoint& StartCoord : Plan.SectorChain)
+    {
+        FIntPoint SectorCoord = StartCoord;
+        while (Map.Sectors.Contains(SectorCoord) && !Map.CostOffsets.Contains(SectorCoord))
+        {
+            Pending.Add(SectorCoord);
+
+            // هدف محلی سکتوری که مقصد در پنجره‌اش است خود مقصد است
+            const FIntPoint* NextSector = Plan.NextSectors.Find(SectorCoord);
+            if (!NextSector || IsDestinationSector(SectorCoord)) break;
+            SectorCoord = *NextSector;
+        }
 
-            Cell.RepulsionVector = Repulsion;
+        while (Pending.Num() > 0)
+        {
+            const FIntPoint Coord = Pending.Pop(EAllowShrinking::No);
+            Map.CostOffsets.Add(Coord, IsDestinationSector(Coord) ? 0 : ComputeOffset(Coord));
         }
     }
+}
+
+// سکتورهای آماده از کش + سکتورهای تازه ساخته‌شده → فیلد کامل سفارش
+static TSharedRef<const FFlowFieldSectorMap> MakeSectorMap(const FFlowFieldBuildPlan& Plan, const TArray<TSharedPtr<const FFlowFieldGrid>>& BuiltSectors)
+{
+    TSharedRef<FFlowFieldSectorMap> Map = MakeShared<FFlowFieldSectorMap>();
+    Map->CellSize = Plan.CellSize;
+    Map->SectorSizeCells = Plan.SectorSizeCells;
+    Map->Sectors = Plan.CachedSectors;
+    for (int32 i = 0; i < BuiltSectors.Num(); i++)
+    {
+        Map->Sectors.Add(Plan.Builds[i].SectorCoord, BuiltSectors[i]);
+    }
+    ComputeSectorCostOffsets(*Map, Plan);
+    return Map;
+}
 
-    // 6. ترکیب نهایی: PathVector + RepulsionVector
-    for (int32 i = 0; i < FlowFieldGrid.Num(); i++)
+void UFlowFieldComponent::CacheBuiltSectors(const FFlowFieldBuildPlan& Plan, const TArray<TSharedPtr<const FFlowFieldGrid>>& BuiltSectors) const
+{
+    UFlowFieldCacheSubsystem* Cache = GetWorld() ? GetWorld()->GetSubsystem<UFlowFieldCacheSubsystem>() : nullptr;
+    if (!Cache)
+        return;
+
+    // موانع حین ساخت عوض شده‌اند → این سکتورها از هندسه قدیمی‌اند و فقط برای همین سفارش (تا تعمیر) معتبرند
+    if (Cache->GetObstacleEpoch() != Plan.ObstacleEpoch)
+        return;
+
+    for (int32 i = 0; i < BuiltSectors.Num(); i++)
     {
-        FFlowFieldCell& Cell = FlowFieldGrid[i];
-        if (Cell.bObstacle || !Cell.bInCorridor) continue;
+        // کلید کش وضعیت یونیت‌ها را ندارد؛ یونیتی که بعداً جابه‌جا شود هیچ باطل‌سازی‌ای نمی‌فرستد
+        if (Plan.Builds[i].Input.bHasUnitObstacles) continue;
 
-        FVector FinalDir = Cell.PathVector + Cell.RepulsionVector;
+        Cache->Add(Plan.Builds[i].CacheKey, BuiltSectors[i].ToSharedRef());
+    }
+}
 
-        // اگر دافعه خیلی قوی باشه و جهت رو کامل معکوس کنه، حداقل جهت اصلی حفظ بشه
-        Cell.Direction = FinalDir.IsNearlyZero() ? Cell.PathVector : FinalDir.GetSafeNormal();
+void UFlowFieldComponent::ApplyField(const TSharedRef<const FFlowFieldSectorMap>& NewField, const TArray<FVector>& Path, int32 CorridorWidthCm)
+{
+    // انتشار اتمیک: خواننده‌ها (Tick یونیت‌ها روی Game Thread) یا فیلد قبلی را می‌بینند یا فیلد کامل جدید
+    Field = NewField;
+    FieldPath = Path;
+    FieldCorridorWidthCm = CorridorWidthCm;
+
+    // محدوده سکتورها فقط برای مختصات GetCell و دیباگ
+    FIntPoint MinSector(MAX_int32, MAX_int32);
+    FIntPoint MaxSector(MIN_int32, MIN_int32);
+    for (const TPair<FIntPoint, TSharedPtr<const FFlowFieldGrid>>& Pair : NewField->Sectors)
+    {
+        MinSector = MinSector.ComponentMin(Pair.Key);
+        MaxSector = MaxSector.ComponentMax(Pair.Key);
     }
 
-    // 7. نرم کردن جهت‌ها (Smoothing)
-    SmoothDirections(5);
+    const float SectorCm = NewField->GetSectorSizeCm();
+    Origin = FVector(MinSector.X * SectorCm, MinSector.Y * SectorCm, 0);
+    GridWidth = (MaxSector.X - MinSector.X + 1) * NewField->SectorSizeCells;
+    GridHeight = (MaxSector.Y - MinSector.Y + 1) * NewField->SectorSizeCells;
+    DebugCorridorWidthCells = CorridorWidthCm;
 
-    // 8. رسم نهایی Flow Field
+    // رسم دیباگ کریدور و Flow Field نهایی (هر کدام فقط اگر کانالش روشن باشد)
+    DrawDebugCorridor(Path, CorridorWidthCm);
     DrawDebugFlowField();
 
-    UE_LOG(LogTemp, Warning, TEXT("FlowField generated successfully. Grid=%dx%d CellSize=%.1f Origin=(%.1f,%.1f) Corridor=%dcm"),
-        GridWidth, GridHeight, LocalCellSize, Origin.X, Origin.Y, DebugCorridorWidthCells);
+    UE_LOG(LogTemp, Warning, TEXT("FlowField generated successfully. Sectors=%d Bounds=%dx%d CellSize=%.1f Origin=(%.1f,%.1f) Corridor=%dcm"),
+        NewField->Sectors.Num(), GridWidth, GridHeight, NewField->CellSize, Origin.X, Origin.Y, DebugCorridorWidthCells);
 
-    DebugPrintStats();
+    // آمار روی همه سلول‌ها پیمایش می‌کند → فقط هنگام دیباگ فیلد
+    if (AIDebugDraw::IsEnabled(EAIDebugChannel::Field))
+    {
+        DebugPrintStats();
+    }
+}
+
+void UFlowFieldComponent::GenerateFlowField(const FVector& Destination, const TArray<FVector>& Path, int32 CorridorWidthCm)
+{
+    FFlowFieldBuildPlan Plan;
+    if (!PrepareBuildPlan(Destination, Path, CorridorWidthCm, Plan))
+        return;
+
+    FlowFieldDestination = Destination;
+    ++BuildGeneration; // ساخت همگام هر ساخت پس‌زمینه قبلی را بی‌اثر می‌کند
+    bBuildInFlight = false;
+    PendingRepairBounds.Reset(); // هندسه همین حالا جمع‌آوری شد
+
+    TArray<TSharedPtr<const FFlowFieldGrid>> BuiltSectors;
+    BuildSectorFields(Plan, BuiltSectors);
+    CacheBuiltSectors(Plan, BuiltSectors);
+    ApplyField(MakeSectorMap(Plan, BuiltSectors), Path, CorridorWidthCm);
+}
+
+void UFlowFieldComponent::GenerateFlowFieldAsync(const FVector& Destination, const TArray<FVector>& Path, int32 CorridorWidthCm)
+{
+    // اسنپ‌شات تغییرناپذیر ورودی‌ها؛ بعد از این نقطه فقط خوانده می‌شود
+    TSharedRef<FFlowFieldBuildPlan> Plan = MakeShared<FFlowFieldBuildPlan>();
+    if (!PrepareBuildPlan(Destination, Path, CorridorWidthCm, *Plan))
+        return;
+
+    FlowFieldDestination = Destination;
+    const uint32 Generation = ++BuildGeneration;
+
+    // همه سکتورها در کش بودند → انتشار فوری، بدون هیچ ساختی
+    if (Plan->Builds.Num() == 0)
+    {
+        bBuildInFlight = false;
+        PendingRepairBounds.Reset();
+        ApplyField(MakeSectorMap(*Plan, TArray<TSharedPtr<const FFlowFieldGrid>>()), Path, CorridorWidthCm);
+        return;
+    }
+
+    // ساخت روی Thread Pool؛ نتیجه روی Game Thread منتشر می‌شود
+    bBuildInFlight = true;
+    Async(EAsyncExecution::ThreadPool, [WeakThis = TWeakObjectPtr<UFlowFieldComponent>(this), Plan, Generation]()
+    {
+        TSharedRef<TArray<TSharedPtr<const FFlowFieldGrid>>> BuiltSectors = MakeShared<TArray<TSharedPtr<const FFlowFieldGrid>>>();
+        BuildSectorFields(*Plan, *BuiltSectors);
+
+        AsyncTask(ENamedThreads::GameThread, [WeakThis, Plan, BuiltSectors, Generation]()
+        {
+            UFlowFieldComponent* This = WeakThis.Get();
+            if (!This)
+                return; // کامپوننت از بین رفته
+
+            // نتیجه قدیمی‌تر هم برای سفارش‌های بعدی معتبر است، مگر موانع حین ساخت عوض شده باشند (بررسی داخل CacheBuiltSectors)
+            This->CacheBuiltSectors(*Plan, *BuiltSectors);
+
+            if (This->BuildGeneration != Generation)
+                return; // سفارش جدیدتری ثبت شده
+
+            This->bBuildInFlight = false;
+            This->ApplyField(MakeSectorMap(*Plan, *BuiltSectors), Plan->Path, Plan->CorridorWidthCm);
+
+            // موانعی که حین ساخت تغییر کردند
+            if (This->PendingRepairBounds.Num() > 0)
+            {
+                const TArray<FBox> DirtyBounds = MoveTemp(This->PendingRepairBounds);
+                This->PendingRepairBounds.Reset();
+                This->RepairField(DirtyBounds);
+            }
+        });
+    });
+}
+
+void UFlowFieldComponent::OnObstaclesChanged(const TArray<FBox>& DirtyBounds)
+{
+    // هندسه ساخت در حال اجرا قبل از این تغییر جمع شده؛ بعد از انتشارش تعمیر می‌شود
+    if (bBuildInFlight)
+    {
+        PendingRepairBounds.Append(DirtyBounds);
+        return;
+    }
+
+    RepairField(DirtyBounds);
+}
+
+void UFlowFieldComponent::RepairField(const TArray<FBox>& DirtyBounds)
+{
+    if (!HasField() || FieldPath.Num() < 2)
+        return;
+
+    const FFlowFieldSectorMap& Map = *Field;
+    const float SectorCm = Map.GetSectorSizeCm();
+    const float HaloCm = GetSectorHaloCells(Map.CellSize, SmoothingIterations) * Map.CellSize;
+
+    // سکتورهای وابسته: هر سکتوری که پنجره ساختش (سکتور + حاشیه دافعه و Smoothing) با ناحیه کثیف تداخل دارد
+    // Flood Fill هر سکتور فقط از پورتال‌های خودش شروع می‌شود، پس وابستگی فراتر از همین پنجره‌ها نمی‌رود
+    TSet<FIntPoint> DirtySectors;
+    for (const TPair<FIntPoint, TSharedPtr<const FFlowFieldGrid>>& Pair : Map.Sectors)
+    {
+        const FBox2D Window(
+            FVector2D(Pair.Key.X * SectorCm - HaloCm, Pair.Key.Y * SectorCm - HaloCm),
+            FVector2D((Pair.Key.X + 1) * SectorCm + HaloCm, (Pair.Key.Y + 1) * SectorCm + HaloCm));
+
+        for (const FBox& Dirty : DirtyBounds)
+        {
+            if (Window.Intersect(FBox2D(FVector2D(Dirty.Min), FVector2D(Dirty.Max))))
+            {
+                DirtySectors.Add(Pair.Key);
+                break;
+            }
+        }
+    }
+
+    if (DirtySectors.Num() == 0)
+        return;
+
+    FFlowFieldBuildPlan Plan;
+    if (!PrepareBuildPlan(FlowFieldDestination, FieldPath, FieldCorridorWidthCm, Plan, &DirtySectors))
+        return;
+
+    // تعداد سکتورهای کثیف کم است؛ ساخت همگام تا یونیت‌ها از همین فریم جهت تعمیرشده را ببینند
+    TArray<TSharedPtr<const FFlowFieldGrid>> BuiltSectors;
+    BuildSectorFields(Plan, BuiltSectors);
+    CacheBuiltSectors(Plan, BuiltSectors);
+
+    // بقیه سکتورها بدون تغییر (فقط اشاره‌گر) از فیلد فعلی برداشته می‌شوند
+    TSharedRef<FFlowFieldSectorMap> Repaired = MakeShared<FFlowFieldSectorMap>(Map);
+    for (const TPair<FIntPoint, TSharedPtr<const FFlowFieldGrid>>& Pair : Plan.CachedSectors)
+    {
+        Repaired->Sectors.Add(Pair.Key, Pair.Value);
+    }
+    for (int32 i = 0; i < BuiltSectors.Num(); i++)
+    {
+        Repaired->Sectors.Add(Plan.Builds[i].SectorCoord, BuiltSectors[i]);
+    }
+    ComputeSectorCostOffsets(*Repaired, Plan);
+
+    UE_LOG(LogTemp, Log, TEXT("FlowField: repaired %d of %d sectors after obstacle change."), DirtySectors.Num(), Map.Sectors.Num());
+
+    // انتشار اتمیک مثل ساخت کامل
+    Field = Repaired;
 }
 
 void UFlowFieldComponent::DebugPrintStats() const
 {
-    int32 Total = FlowFieldGrid.Num();
+    const FFlowFieldSectorMap& Map = GetSectorMap();
+    int32 Total = Map.Num();
     int32 Obst = 0, InCorr = 0, DirCount = 0;
-    for (const FFlowFieldCell& C : FlowFieldGrid)
+    for (const TPair<FIntPoint, TSharedPtr<const FFlowFieldGrid>>& Pair : Map.Sectors)
     {
-        if (C.bObstacle) Obst++;
-        if (C.bInCorridor) InCorr++;
-        if (!C.Direction.IsNearlyZero()) DirCount++;
+        for (const uint8 F : Pair.Value->Flags)
+        {
+            if (F & FFlowFieldGrid::Flag_Obstacle) Obst++;
+            if (F & FFlowFieldGrid::Flag_InCorridor) InCorr++;
+            if (F & FFlowFieldGrid::Flag_HasDirection) DirCount++;
+        }
     }
-    UE_LOG(LogTemp, Warning, TEXT("FlowField stats: Total=%d Obst=%d InCorridor=%d WithDir=%d GridWxH=%dx%d CellSize=%.1f Origin=(%.1f,%.1f)"),
-        Total, Obst, InCorr, DirCount, GridWidth, GridHeight, CellSize, Origin.X, Origin.Y);
+    UE_LOG(LogTemp, Warning, TEXT("FlowField stats: Total=%d Obst=%d InCorridor=%d WithDir=%d Sectors=%d BoundsWxH=%dx%d CellSize=%.1f Origin=(%.1f,%.1f) Memory=%llu bytes"),
+        Total, Obst, InCorr, DirCount, Map.Sectors.Num(), GridWidth, GridHeight, CellSize, Origin.X, Origin.Y, (uint64)Map.GetAllocatedSize());
 }
 
 void UFlowFieldComponent::DrawDebugFlowField() const
 {
-    if (FlowFieldGrid.Num() == 0 || !GetWorld()) return;
+    const bool bDrawField = AIDebugDraw::IsEnabled(EAIDebugChannel::Field);
+    const bool bDrawObstacles = bDebugDrawObstacles && AIDebugDraw::IsEnabled(EAIDebugChannel::Repulsion);
+    if (!bDrawField && !bDrawObstacles) return;
+
+    const FFlowFieldSectorMap& Map = GetSectorMap();
+    if (Map.Sectors.Num() == 0 || !GetWorld()) return;
 
     const float ArrowSize = 15.f;
     const float PathArrowScale = 0.5f;
     const float DirectionThreshold = 0.01f;
 
-    for (int32 y = 0; y < GridHeight; y++)
+    for (const TPair<FIntPoint, TSharedPtr<const FFlowFieldGrid>>& Pair : Map.Sectors)
     {
-        for (int32 x = 0; x < GridWidth; x++)
+        const FFlowFieldGrid& Grid = *Pair.Value;
+        for (int32 Index = 0; Index < Grid.Num(); Index++)
         {
-            int32 Index = y * GridWidth + x;
-            const FFlowFieldCell& Cell = FlowFieldGrid[Index];
+            if (!Grid.HasFlag(Index, FFlowFieldGrid::Flag_InCorridor)) continue;
+
+            FVector Start = Grid.GridToWorld(Index % Grid.Width, Index / Grid.Width);
+
+            // سلول مسدود داخل کریدور (قرمز)
+            if (Grid.HasFlag(Index, FFlowFieldGrid::Flag_Obstacle))
+            {
+                if (bDrawObstacles)
+                {
+                    AIDebugDraw::Point(GetWorld(), EAIDebugChannel::Repulsion, Start, Grid.CellSize * 0.5f, FColor::Red, DebugDrawDuration);
+                }
+                continue;
+            }
 
-            if (!Cell.bInCorridor) continue;
+            if (!bDrawField) continue;
 
-            FVector Start = GridIndexToWorld(FIntVector(x, y, 0));
+            const FVector CellDirection = Grid.GetDirection(Index);
 
             // جهت نهایی (سبز)
-            if (!Cell.Direction.IsNearlyZero(DirectionThreshold))
+            if (!CellDirection.IsNearlyZero(DirectionThreshold))
             {
-                FVector End = Start + Cell.Direction.GetSafeNormal() * (CellSize * PathArrowScale);
-                DrawDebugDirectionalArrow(GetWorld(), Start, End, ArrowSize, FColor::Green, false, 5.f, 0, 1.5f);
+                if (bDebugDrawDirection)
+                {
+                    FVector End = Start + CellDirection * (Grid.CellSize * PathArrowScale);
+                    AIDebugDraw::Arrow(GetWorld(), EAIDebugChannel::Field, Start, End, ArrowSize, FColor::Green, 5.f, 1.5f);
+                }
             }
-            else
+            else if (bDebugDrawDeadEnds)
             {
-                DrawDebugPoint(GetWorld(), Start, 8.f, FColor::Yellow, false, 10.f);
+                AIDebugDraw::Point(GetWorld(), EAIDebugChannel::Field, Start, 8.f, FColor::Yellow, DebugDrawDuration);
             }
         }
     }
@@ -464,7 +1615,7 @@ void UFlowFieldComponent::DrawDebugFlowField() const
 
 void UFlowFieldComponent::DrawDebugCorridor(const TArray<FVector>& Path, float CorridorWidthCm)
 {
-    if (!GetWorld() || Path.Num() < 2) return;
+    if (!GetWorld() || Path.Num() < 2 || !AIDebugDraw::IsEnabled(EAIDebugChannel::Corridor)) return;
 
     UE_LOG(LogTemp, Warning, TEXT("[DrawDebugCorridor] CorridorWidth = %.1f cm, PathPoints = %d"), CorridorWidthCm, Path.Num());
 
@@ -484,9 +1635,9 @@ void UFlowFieldComponent::DrawDebugCorridor(const TArray<FVector>& Path, float C
         FVector LeftB = End - Perp * HalfWidth;
         FVector RightB = End + Perp * HalfWidth;
 
-        DrawDebugLine(GetWorld(), LeftA, LeftB, FColor::Yellow, false, 10.f, 0, 2.f);
-        DrawDebugLine(GetWorld(), RightA, RightB, FColor::Yellow, false, 10.f, 0, 2.f);
-        DrawDebugLine(GetWorld(), LeftA, RightA, FColor::Yellow, false, 10.f, 0, 1.f);
-        DrawDebugLine(GetWorld(), LeftB, RightB, FColor::Yellow, false, 10.f, 0, 1.f);
+        AIDebugDraw::Line(GetWorld(), EAIDebugChannel::Corridor, LeftA, LeftB, FColor::Yellow, 10.f, 2.f);
+        AIDebugDraw::Line(GetWorld(), EAIDebugChannel::Corridor, RightA, RightB, FColor::Yellow, 10.f, 2.f);
+        AIDebugDraw::Line(GetWorld(), EAIDebugChannel::Corridor, LeftA, RightA, FColor::Yellow, 10.f, 1.f);
+        AIDebugDraw::Line(GetWorld(), EAIDebugChannel::Corridor, LeftB, RightB, FColor::Yellow, 10.f, 1.f);
     }
 }
\ No newline at end of file
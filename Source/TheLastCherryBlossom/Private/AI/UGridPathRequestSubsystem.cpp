@@ -0,0 +1,525 @@
+#include "AI/UGridPathRequestSubsystem.h"
+#include "AI/UFlowFieldCacheSubsystem.h"
+#include "NavigationSystem.h"
+#include "NavigationData.h"
+#include "HAL/IConsoleManager.h"
+
+static float GPathRequestBudgetMs = 1.0f;
+static FAutoConsoleVariableRef CVarPathRequestBudgetMs(
+    TEXT("ai.PathRequests.BudgetMs"),
+    GPathRequestBudgetMs,
+    TEXT("Game thread time (ms) spent per frame starting and finalizing grid path requests. At least one request always progresses."));
+
+static int32 GPathRequestMaxInFlight = 8;
+static FAutoConsoleVariableRef CVarPathRequestMaxInFlight(
+    TEXT("ai.PathRequests.MaxInFlight"),
+    GPathRequestMaxInFlight,
+    TEXT("Maximum number of async navmesh path queries running at the same time."));
+
+static int32 GPathCacheSize = 64;
+static FAutoConsoleVariableRef CVarPathCacheSize(
+    TEXT("ai.PathRequests.CacheSize"),
+    GPathCacheSize,
+    TEXT("Number of recent grid paths kept for reuse (keyed by start/goal navmesh polygon). 0 disables the cache."));
+
+static float GPathCacheLifetime = 10.f;
+static FAutoConsoleVariableRef CVarPathCacheLifetime(
+    TEXT("ai.PathRequests.CacheLifetime"),
+    GPathCacheLifetime,
+    TEXT("Seconds a cached grid path stays valid (smoothing depends on unit positions, which are not tracked)."));
+
+void UGridPathRequestSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+    Super::OnWorldBeginPlay(InWorld);
+
+    // مسیرهای کش‌شده با ساخت مجدد NavMesh یا تغییر موانع کهنه می‌شوند
+    if (UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(&InWorld))
+    {
+        NavSys->OnNavigationGenerationFinishedDelegate.AddUniqueDynamic(this, &UGridPathRequestSubsystem::OnNavigationGenerationFinished);
+    }
+
+    if (UFlowFieldCacheSubsystem* FieldCache = InWorld.GetSubsystem<UFlowFieldCacheSubsystem>())
+    {
+        ObstaclesChangedHandle = FieldCache->OnStaticObstaclesChanged.AddUObject(this, &UGridPathRequestSubsystem::OnObstaclesChanged);
+    }
+}
+
+void UGridPathRequestSubsystem::Deinitialize()
+{
+    if (UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld()))
+    {
+        NavSys->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &UGridPathRequestSubsystem::OnNavigationGenerationFinished);
+    }
+
+    if (UFlowFieldCacheSubsystem* FieldCache = GetWorld() ? GetWorld()->GetSubsystem<UFlowFieldCacheSubsystem>() : nullptr)
+    {
+        FieldCache->OnStaticObstaclesChanged.Remove(ObstaclesChangedHandle);
+    }
+    ObstaclesChangedHandle.Reset();
+
+    // Query‌های در حال اجرا بدون صدا زدن Callback لغو می‌شوند
+    if (UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld()))
+    {
+        for (const TPair<uint32, FRequest>& Pair : Requests)
+        {
+            if (Pair.Value.Stage == ERequestStage::WaitingForNav)
+            {
+                NavSys->AbortAsyncFindPathRequest(Pair.Value.NavQueryId);
+            }
+        }
+    }
+
+    Requests.Empty();
+    Queue.Empty();
+    ReadyToFinalize.Empty();
+    ActiveByKey.Empty();
+    SharedGoalGroups.Empty();
+    InvalidatePathCache();
+    NumInFlight = 0;
+
+    Super::Deinitialize();
+}
+
+TStatId UGridPathRequestSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UGridPathRequestSubsystem, STATGROUP_Tickables);
+}
+
+uint32 UGridPathRequestSubsystem::RequestPath(UGridPathfinderComponent* Pathfinder, const FVector& Start, const FVector& Goal, int32 Priority, FOnGridPathComplete OnComplete, uint32 SharedGoalGroup)
+{
+    const uint32 RequestId = NextRequestId++;
+    if (NextRequestId == 0) NextRequestId = 1; // صفر یعنی «بدون درخواست»
+
+    FRequest& Request = Requests.Add(RequestId);
+    Request.Pathfinder = Pathfinder;
+    Request.Start = Start;
+    Request.Goal = Goal;
+    Request.Priority = Priority;
+    Request.OnComplete = MoveTemp(OnComplete);
+    Request.SharedGoalGroup = SharedGoalGroup;
+
+    if (SharedGoalGroup != 0)
+    {
+        SharedGoalGroups.FindOrAdd(SharedGoalGroup).Add(RequestId);
+    }
+
+    EnqueueRequest(RequestId, Request);
+    return RequestId;
+}
+
+uint32 UGridPathRequestSubsystem::NewSharedGoalGroup()
+{
+    const uint32 GroupId = NextSharedGoalGroup++;
+    if (NextSharedGoalGroup == 0) NextSharedGoalGroup = 1;
+    return GroupId;
+}
+
+void UGridPathRequestSubsystem::EnqueueRequest(uint32 RequestId, const FRequest& Request)
+{
+    Queue.HeapPush(FQueueEntry{ RequestId, Request.Priority, NextSequence++ });
+}
+
+void UGridPathRequestSubsystem::CancelRequest(uint32 RequestId)
+{
+    FRequest Request;
+    if (!Requests.RemoveAndCopyValue(RequestId, Request))
+        return;
+
+    // ورودی‌های Queue و ReadyToFinalize هنگام برداشتن نادیده گرفته می‌شوند
+    if (Request.Stage == ERequestStage::WaitingForNav)
+    {
+        NumInFlight--;
+        if (UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld()))
+        {
+            NavSys->AbortAsyncFindPathRequest(Request.NavQueryId);
+        }
+    }
+
+    if (Request.SharedGoalGroup != 0)
+    {
+        if (TArray<uint32>* Members = SharedGoalGroups.Find(Request.SharedGoalGroup))
+        {
+            Members->RemoveSingleSwap(RequestId, EAllowShrinking::No);
+            if (Members->Num() == 0)
+            {
+                SharedGoalGroups.Remove(Request.SharedGoalGroup);
+            }
+        }
+    }
+
+    ReleaseSharedQuery(RequestId, Request);
+}
+
+void UGridPathRequestSubsystem::ReleaseSharedQuery(uint32 RequestId, FRequest& Request)
+{
+    if (Request.bHasKey && ActiveByKey.FindRef(Request.Key) == RequestId)
+    {
+        ActiveByKey.Remove(Request.Key);
+    }
+
+    // درخواست‌هایی که منتظر این یکی بودند دوباره در صف قرار می‌گیرند (یکی‌شان Query را اجرا می‌کند)
+    for (uint32 MergedId : Request.MergedRequests)
+    {
+        if (FRequest* Merged = Requests.Find(MergedId))
+        {
+            Merged->Stage = ERequestStage::Queued;
+            EnqueueRequest(MergedId, *Merged);
+        }
+    }
+    Request.MergedRequests.Reset();
+}
+
+void UGridPathRequestSubsystem::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    const double Deadline = FPlatformTime::Seconds() + GPathRequestBudgetMs * 0.001;
+
+    // ۱) مسیرهای NavMesh رسیده → Resample و Smooth (قدیمی‌ترها اول)
+    // در هر فریم حداقل یک درخواست از هر مرحله جلو می‌رود تا صف هیچ‌وقت گیر نکند
+    // اندیس جلو می‌رود و بخش پردازش‌شده یک بار در انتها حذف می‌شود (Callback‌ها فقط به انتهای صف اضافه می‌کنند)
+    bool bFinalizedAny = false;
+    int32 NumProcessed = 0;
+    while (NumProcessed < ReadyToFinalize.Num() && (!bFinalizedAny || FPlatformTime::Seconds() < Deadline))
+    {
+        const uint32 RequestId = ReadyToFinalize[NumProcessed++];
+
+        if (FRequest* Request = Requests.Find(RequestId))
+        {
+            FinalizeRequest(RequestId, *Request);
+            bFinalizedAny = true;
+        }
+    }
+    ReadyToFinalize.RemoveAt(0, FMath::Min(NumProcessed, ReadyToFinalize.Num()), EAllowShrinking::No);
+
+    // ۲) شروع درخواست‌های جدید به ترتیب Priority
+    bool bStartedAny = false;
+    while (Queue.Num() > 0 && NumInFlight < GPathRequestMaxInFlight && (!bStartedAny || FPlatformTime::Seconds() < Deadline))
+    {
+        FQueueEntry Entry;
+        Queue.HeapPop(Entry, EAllowShrinking::No);
+
+        // درخواستی که جستجوی مشترک گروهش جواب داده دیگر در مرحله Queued نیست
+        FRequest* Request = Requests.Find(Entry.RequestId);
+        if (Request && Request->Stage == ERequestStage::Queued)
+        {
+            StartRequest(Entry.RequestId, *Request);
+            bStartedAny = true;
+        }
+    }
+}
+
+void UGridPathRequestSubsystem::StartRequest(uint32 RequestId, FRequest& Request)
+{
+    UGridPathfinderComponent* Pathfinder = Request.Pathfinder.Get();
+    if (!Pathfinder)
+    {
+        CompleteRequest(RequestId, TArray<FVector>());
+        return;
+    }
+
+    // مسیر مستقیم باز → بدون NavMesh تمام
+    TArray<FVector> DirectPath;
+    if (Pathfinder->FindDirectPath(Request.Start, Request.Goal, DirectPath))
+    {
+        CompleteRequest(RequestId, DirectPath);
+        return;
+    }
+
+    FVector ActualGoal;
+    if (!Pathfinder->ResolveGoal(Request.Goal, ActualGoal))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("RequestPath: Goal is not walkable."));
+        CompleteRequest(RequestId, TArray<FVector>());
+        return;
+    }
+
+    if (Request.SharedGoalGroup != 0)
+    {
+        RunSharedGoalSearch(Request, ActualGoal);
+        if (Request.Stage == ERequestStage::ReadyToFinalize)
+            return;
+    }
+
+    UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld());
+    const ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate) : nullptr;
+    if (!NavData)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("RequestPath: NavigationSystem not found."));
+        CompleteRequest(RequestId, TArray<FVector>());
+        return;
+    }
+
+    Request.ActualGoal = ActualGoal;
+    Request.bHasKey = MakePathKey(*NavData, Request.Start, ActualGoal, Request.Key);
+    if (Request.bHasKey)
+    {
+        // ۱) مسیر اخیر با همان پلی‌ها → فقط قطعه شروع و پایان این یونیت
+        if (const FCachedPath* Cached = FindInCache(Request.Key))
+        {
+            const TArray<FVector> Stitched = Pathfinder->StitchSharedPath(Request.Start, ActualGoal, Cached->Path);
+            CompleteRequest(RequestId, Stitched);
+            return;
+        }
+
+        // ۲) Query هم‌کلید در حال اجرا → منتظر نتیجه آن
+        if (const uint32* LeaderId = ActiveByKey.Find(Request.Key))
+        {
+            if (FRequest* Leader = Requests.Find(*LeaderId))
+            {
+                Leader->MergedRequests.Add(RequestId);
+                Request.Stage = ERequestStage::WaitingForShared;
+                return;
+            }
+        }
+
+        ActiveByKey.Add(Request.Key, RequestId);
+    }
+
+    // حالت گرید: JPS همین‌جا (داخل بودجه فریم) و بعد همان مسیر Finalize؛ در صورت شکست NavMesh
+    if (Pathfinder->FindGridPath(Request.Start, ActualGoal, Request.NavPoints))
+    {
+        Request.Stage = ERequestStage::ReadyToFinalize;
+        ReadyToFinalize.Add(RequestId);
+        return;
+    }
+
+    FPathFindingQuery Query(Pathfinder, *NavData, Request.Start, ActualGoal, NavData->GetDefaultQueryFilter());
+    Request.NavQueryId = NavSys->FindPathAsync(
+        NavData->GetConfig(),
+        Query,
+        FNavPathQueryDelegate::CreateUObject(this, &UGridPathRequestSubsystem::OnNavPathFound, RequestId));
+    Request.Stage = ERequestStage::WaitingForNav;
+    NumInFlight++;
+}
+
+void UGridPathRequestSubsystem::RunSharedGoalSearch(FRequest& Leader, const FVector& ActualGoal)
+{
+    TArray<uint32> Members;
+    SharedGoalGroups.RemoveAndCopyValue(Leader.SharedGoalGroup, Members);
+    Leader.SharedGoalGroup = 0;
+
+    const UGridPathfinderComponent* LeaderPathfinder = Leader.Pathfinder.Get();
+    if (!LeaderPathfinder || LeaderPathfinder->PathfindingMode == EGridPathfindingMode::NavMesh)
+        return;
+
+    // یک جستجو یک Clearance دارد → فقط اعضای منتظر با همان حالت و شعاع کاراکتر
+    TArray<uint32> SearchIds;
+    TArray<FVector> Starts;
+    for (uint32 MemberId : Members)
+    {
+        FRequest* Member = Requests.Find(MemberId);
+        if (!Member) continue;
+
+        Member->SharedGoalGroup = 0;
+
+        const UGridPathfinderComponent* Pathfinder = Member->Pathfinder.Get();
+        if (Member->Stage != ERequestStage::Queued || !Pathfinder
+            || Pathfinder->PathfindingMode != LeaderPathfinder->PathfindingMode
+            || !FMath::IsNearlyEqual(Pathfinder->CharacterRadius, LeaderPathfinder->CharacterRadius))
+            continue;
+
+        SearchIds.Add(MemberId);
+        Starts.Add(Member->Start);
+    }
+
+    // یک عضو تنها با JPS معمولی (و جدول JPS+) سریع‌تر است
+    if (SearchIds.Num() < 2)
+        return;
+
+    TArray<TArray<FVector>> Paths;
+    if (!LeaderPathfinder->FindGridPathsToGoal(Starts, ActualGoal, Paths))
+        return;
+
+    int32 NumServed = 0;
+    for (int32 Index = 0; Index < SearchIds.Num(); Index++)
+    {
+        if (Paths[Index].Num() < 2)
+            continue;
+
+        FRequest& Member = Requests[SearchIds[Index]];
+        Member.ActualGoal = ActualGoal;
+        Member.NavPoints = MoveTemp(Paths[Index]);
+        Member.Stage = ERequestStage::ReadyToFinalize;
+        ReadyToFinalize.Add(SearchIds[Index]);
+        NumServed++;
+    }
+
+    UE_LOG(LogTemp, Log, TEXT("RequestPath: Shared goal search served %d of %d requests."), NumServed, Members.Num());
+}
+
+void UGridPathRequestSubsystem::OnNavPathFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr NavPath, uint32 RequestId)
+{
+    FRequest* Request = Requests.Find(RequestId);
+    if (!Request || Request->Stage != ERequestStage::WaitingForNav || Request->NavQueryId != QueryId)
+        return; // لغو شده
+
+    NumInFlight--;
+
+    if (Result != ENavigationQueryResult::Success || !NavPath.IsValid() || NavPath->GetPathPoints().Num() < 2)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("RequestPath: Failed to generate nav path."));
+
+        // همان پلی‌ها → درخواست‌های ادغام‌شده هم مسیر ندارند
+        const TArray<uint32> MergedRequests = MoveTemp(Request->MergedRequests);
+        if (Request->bHasKey)
+        {
+            ActiveByKey.Remove(Request->Key);
+        }
+        CompleteRequest(RequestId, TArray<FVector>());
+        CompleteMergedRequests(MergedRequests, TArray<FVector>());
+        return;
+    }
+
+    Request->NavPoints.Reserve(NavPath->GetPathPoints().Num());
+    for (const FNavPathPoint& Point : NavPath->GetPathPoints())
+    {
+        Request->NavPoints.Add(Point.Location);
+    }
+
+    // Smooth با Sweep روی Game Thread هزینه دارد → در Tick و داخل بودجه انجام می‌شود
+    Request->Stage = ERequestStage::ReadyToFinalize;
+    ReadyToFinalize.Add(RequestId);
+}
+
+void UGridPathRequestSubsystem::FinalizeRequest(uint32 RequestId, FRequest& Request)
+{
+    UGridPathfinderComponent* Pathfinder = Request.Pathfinder.Get();
+    if (!Pathfinder)
+    {
+        // بدون Pathfinder (شعاع و Owner برای Sweep) نمی‌شود Smooth کرد → منتظرها دوباره در صف
+        ReleaseSharedQuery(RequestId, Request);
+        CompleteRequest(RequestId, TArray<FVector>());
+        return;
+    }
+
+    UE_LOG(LogTemp, Log, TEXT("RequestPath: Raw path points: %d"), Request.NavPoints.Num());
+    const TArray<FVector> FinalPath = Pathfinder->FinalizeNavPath(Request.NavPoints);
+
+    const TArray<uint32> MergedRequests = MoveTemp(Request.MergedRequests);
+    if (Request.bHasKey)
+    {
+        ActiveByKey.Remove(Request.Key);
+        if (FinalPath.Num() >= 2)
+        {
+            AddToCache(Request.Key, FinalPath);
+        }
+    }
+
+    CompleteRequest(RequestId, FinalPath);
+    CompleteMergedRequests(MergedRequests, FinalPath);
+}
+
+void UGridPathRequestSubsystem::CompleteMergedRequests(const TArray<uint32>& MergedRequests, const TArray<FVector>& SharedPath)
+{
+    for (uint32 MergedId : MergedRequests)
+    {
+        const FRequest* Merged = Requests.Find(MergedId);
+        if (!Merged) continue; // لغو شده
+
+        UGridPathfinderComponent* Pathfinder = Merged->Pathfinder.Get();
+        if (!Pathfinder || SharedPath.Num() < 2)
+        {
+            CompleteRequest(MergedId, TArray<FVector>());
+            continue;
+        }
+
+        const TArray<FVector> Stitched = Pathfinder->StitchSharedPath(Merged->Start, Merged->ActualGoal, SharedPath);
+        CompleteRequest(MergedId, Stitched);
+    }
+}
+
+bool UGridPathRequestSubsystem::MakePathKey(const ANavigationData& NavData, const FVector& Start, const FVector& Goal, FGridPathKey& OutKey) const
+{
+    const FVector Extent = NavData.GetConfig().DefaultQueryExtent;
+
+    FNavLocation StartLocation;
+    FNavLocation GoalLocation;
+    if (!NavData.ProjectPoint(Start, StartLocation, Extent) || !NavData.ProjectPoint(Goal, GoalLocation, Extent))
+        return false;
+
+    OutKey.StartPoly = StartLocation.NodeRef;
+    OutKey.GoalPoly = GoalLocation.NodeRef;
+    return OutKey.StartPoly != INVALID_NAVNODEREF && OutKey.GoalPoly != INVALID_NAVNODEREF;
+}
+
+void UGridPathRequestSubsystem::AddToCache(const FGridPathKey& Key, const TArray<FVector>& Path)
+{
+    if (GPathCacheSize <= 0)
+        return;
+
+    FCachedPath& Entry = PathCache.FindOrAdd(Key);
+    Entry.Path = Path;
+    Entry.Bounds = FBox(Path);
+    Entry.CreatedTime = GetWorld()->GetTimeSeconds();
+    Entry.LastUsed = ++CacheUseCounter;
+
+    // کمترین استفاده اخیر بیرون می‌رود (کش کوچک است، جستجوی خطی کافی است)
+    while (PathCache.Num() > GPathCacheSize)
+    {
+        FGridPathKey OldestKey;
+        uint64 OldestUse = MAX_uint64;
+        for (const TPair<FGridPathKey, FCachedPath>& Pair : PathCache)
+        {
+            if (Pair.Value.LastUsed < OldestUse)
+            {
+                OldestUse = Pair.Value.LastUsed;
+                OldestKey = Pair.Key;
+            }
+        }
+        PathCache.Remove(OldestKey);
+    }
+}
+
+const UGridPathRequestSubsystem::FCachedPath* UGridPathRequestSubsystem::FindInCache(const FGridPathKey& Key)
+{
+    FCachedPath* Entry = PathCache.Find(Key);
+    if (!Entry)
+        return nullptr;
+
+    if (GetWorld()->GetTimeSeconds() - Entry->CreatedTime > GPathCacheLifetime)
+    {
+        PathCache.Remove(Key);
+        return nullptr;
+    }
+
+    Entry->LastUsed = ++CacheUseCounter;
+    return Entry;
+}
+
+void UGridPathRequestSubsystem::InvalidatePathCache()
+{
+    PathCache.Empty();
+}
+
+void UGridPathRequestSubsystem::OnNavigationGenerationFinished(ANavigationData* NavData)
+{
+    InvalidatePathCache();
+}
+
+void UGridPathRequestSubsystem::OnObstaclesChanged(const TArray<FBox>& DirtyBounds)
+{
+    for (auto It = PathCache.CreateIterator(); It; ++It)
+    {
+        // Bounds مسیر با شعاع کاراکتر (که در کش نیست) گسترش داده نمی‌شود؛ حاشیه ثابت کافی است
+        const FBox PathBounds = It.Value().Bounds.ExpandBy(100.f);
+        for (const FBox& Dirty : DirtyBounds)
+        {
+            if (PathBounds.IntersectXY(Dirty))
+            {
+                It.RemoveCurrent();
+                break;
+            }
+        }
+    }
+}
+
+void UGridPathRequestSubsystem::CompleteRequest(uint32 RequestId, const TArray<FVector>& Path)
+{
+    // اول از صف حذف می‌شود تا Callback بتواند بدون مشکل درخواست جدید ثبت کند
+    FRequest Request;
+    if (Requests.RemoveAndCopyValue(RequestId, Request))
+    {
+        Request.OnComplete.ExecuteIfBound(Path);
+    }
+}
@@ -2,11 +2,14 @@
 #include "Characters/AUnitCharacter.h"
 #include "AI/UFlowFieldComponent.h"
 #include "AI/GridPathfinderComponent.h"
+#include "AI/UGridPathRequestSubsystem.h"
+#include "AI/UWalkabilityCacheSubsystem.h"
 #include "NavigationSystem.h"
 #include "Algo/Sort.h"
 #include "Components/CapsuleComponent.h"
-#include "DrawDebugHelpers.h"
+#include "AI/UAIDebugDrawSubsystem.h"
 #include "AI/UUnitClusterLibrary.h"
+#include "AI/FFormationTemplateLibrary.h"
 
 UUnitFormationManager::UUnitFormationManager()
 {
@@ -56,238 +59,182 @@ float UUnitFormationManager::CalculateCorridorWidthForCluster(
 	return CorridorWidthCm;
 }
 
-TArray<TArray<float>> UUnitFormationManager::GetFormationMatrix(int32 UnitCount) const
+// ---------- Collision avoidance tweak (spatial hash separation) ------------
+namespace FormationSeparation
 {
-	// مقدار -1 = خانه خالی، مقدار 1 = خانه پر
-	TArray<TArray<float>> Matrix;
+	constexpr int32 MaxIterations = 32;
 
-	switch (UnitCount)
-	{
-	case 1:
-		Matrix = { {1} };
-		break;
-	case 2:
-		Matrix = { {1,-1,1} };
-		break;
-	case 3:
-		Matrix = { {1,-1,1,-1,1} };
-		break;
-	case 4:
-		Matrix = { {1,-1,1},{-1,-1,-1,},{1,-1,1} };
-		break;
-	case 5:
-		Matrix = { {1,-1,1,-1,1,},{-1,-1,-1,-1,-1},{1,-1,-1,-1,1} };
-		break;
-	case 6:
-		Matrix = { {1,-1,1,-1,1,},{-1,-1,-1,-1,-1},{1,-1,1,-1,1,} };
-		break;
-	case 7:
-		Matrix = { {1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,-1,1,-1,-1,1} };
-		break;
-	case 8:
-		Matrix = { {1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1} };
-		break;
-	case 9:
-		Matrix = { {1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{-1,-1,-1,1,-1,-1,-1} };
-		break;
-	case 10:
-		Matrix = { {1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,-1,-1,-1,-1,1} };
-		break;
-	case 11:
-		Matrix = { {1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,-1,1,-1,-1,1} };
-		break;
-	case 12:
-		Matrix = { {1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1} };
-		break;
-	case 13:
-		Matrix = { {1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{-1,-1,-1,1,-1,-1,-1} };
-		break;
-	case 14:
-		Matrix = { {1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,-1,-1,-1,-1,1} };
-		break;
-	case 15:
-		Matrix = { {1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,-1,1,-1,-1,1} };
-		break;
-	case 16:
-		Matrix = { {1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1},{-1,-1,-1,-1,-1,-1,-1},{1,-1,1,-1,1,-1,1} };
-		break;
-	default:
-	{
-		int32 GridSize = FMath::CeilToInt(FMath::Sqrt((float)UnitCount));
-		Matrix.SetNum(GridSize);
-		for (int32 r = 0; r < GridSize; r++)
-		{
-			Matrix[r].SetNum(GridSize);
-			for (int32 c = 0; c < GridSize; c++)
-				Matrix[r][c] = (r*GridSize + c < UnitCount) ? 1.f : -1.f;
-		}
-	}
-	break;
-	}
-
-	return Matrix;
-}
-
-// ---------- BuildCostMatrix ------------
-void UUnitFormationManager::BuildCostMatrix(
-	const TArray<AUnitCharacter*>& Cluster,
-	const TArray<FVector>& Slots,
-	TArray<TArray<float>>& OutCost)
-{
-	int32 N = Cluster.Num();
-	int32 M = Slots.Num();
-	OutCost.SetNum(N);
+	// هدف هر جفت کمی بیشتر از MinSeparation تا Relax در بی‌نهایت قدم همگرا نشود
+	constexpr float Overshoot = 0.02f;
 
-	// <<< درست: از عضو کلاس استفاده کن (که قبلاً در AssignOptimalFormation ست شده) >>>
-	// FormationForward = InFormationForward;  ← این خط رو کامل حذف کن
+	constexpr int32 MedianBins = 64;
 
-	for (int32 i = 0; i < N; i++)
+	// Hash یکنواخت XY با سلول MinSeparation: هر جفت نزدیک‌تر از MinSeparation در سلول‌های مجاور است
+	struct FSlotHash
 	{
-		OutCost[i].SetNum(M);
-		FVector UnitPos = Cluster[i] ? Cluster[i]->GetActorLocation() : FVector::ZeroVector;
+		TArray<FIntPoint> Cells;
+		TArray<int32> BucketStart;
+		TArray<int32> Entries;
+		uint32 BucketMask = 0;
 
-		for (int32 j = 0; j < M; j++)
-		{
-			float Distance = FVector::Dist(UnitPos, Slots[j]);
+		uint32 BucketOf(const FIntPoint& Cell) const { return GetTypeHash(Cell) & BucketMask; }
 
-			// محاسبه چقدر این اسلات "جلو" هست
-			FVector ToSlot = Slots[j] - FinalGoal;
-			float ForwardAmount = FVector::DotProduct(ToSlot.GetSafeNormal(), FormationForward.GetSafeNormal());
+		// Counting Sort اسلات‌ها در Bucketها (خطی، بدون Map)
+		void Build(const TArray<FVector>& Slots, float CellSize)
+		{
+			const int32 NumSlots = Slots.Num();
+			const int32 NumBuckets = (int32)FMath::RoundUpToPowerOfTwo(FMath::Max(NumSlots * 2, 16));
+			BucketMask = NumBuckets - 1;
 
-			float ForwardBias = ForwardAmount * 300.f;  // عدد دلخواه – تست کن
+			Cells.SetNumUninitialized(NumSlots, EAllowShrinking::No);
+			BucketStart.SetNumZeroed(NumBuckets + 1);
+			for (int32 i = 0; i < NumSlots; i++)
+			{
+				Cells[i] = FIntPoint(FMath::FloorToInt(Slots[i].X / CellSize), FMath::FloorToInt(Slots[i].Y / CellSize));
+				BucketStart[BucketOf(Cells[i]) + 1]++;
+			}
+			for (int32 Bucket = 0; Bucket < NumBuckets; Bucket++)
+			{
+				BucketStart[Bucket + 1] += BucketStart[Bucket];
+			}
 
-			OutCost[i][j] = Distance - ForwardBias;
-			OutCost[i][j] = FMath::Max(0.f, OutCost[i][j]);
+			TArray<int32> Next(BucketStart.GetData(), NumBuckets);
+			Entries.SetNumUninitialized(NumSlots, EAllowShrinking::No);
+			for (int32 i = 0; i < NumSlots; i++)
+			{
+				Entries[Next[BucketOf(Cells[i])]++] = i;
+			}
 		}
-	}
-}
 
-// ---------- HungarianSolve (O(n^3) standard) ------------
-TArray<int32> UUnitFormationManager::HungarianSolve(const TArray<TArray<float>>& Cost)
-{
-	int32 N = Cost.Num();
-	// Safety: if empty
-	if (N == 0) return TArray<int32>();
-
-	int32 M = Cost[0].Num();
-	int32 Dim = FMath::Max(N, M);
-
-	// build square matrix A (Dim x Dim)
-	TArray<TArray<float>> A;
-	A.SetNum(Dim);
-	for (int i = 0; i < Dim; ++i)
-	{
-		A[i].SetNum(Dim);
-		for (int j = 0; j < Dim; ++j)
+		// همه اسلات‌های نه سلول اطراف Index (برخورد Hash با مقایسه سلول واقعی حذف می‌شود)
+		template<typename FVisit>
+		void ForEachNeighbour(int32 Index, FVisit&& Visit) const
 		{
-			if (i < N && j < M) A[i][j] = Cost[i][j];
-			else A[i][j] = 1e6f; // large cost for dummy cells
+			for (int32 DY = -1; DY <= 1; DY++)
+			{
+				for (int32 DX = -1; DX <= 1; DX++)
+				{
+					const FIntPoint Cell = Cells[Index] + FIntPoint(DX, DY);
+					const uint32 Bucket = BucketOf(Cell);
+					for (int32 Entry = BucketStart[Bucket]; Entry < BucketStart[Bucket + 1]; Entry++)
+					{
+						const int32 Other = Entries[Entry];
+						if (Other != Index && Cells[Other] == Cell)
+						{
+							Visit(Other);
+						}
+					}
+				}
+			}
 		}
-	}
+	};
 
-	TArray<float> u; u.Init(0.f, Dim + 1);
-	TArray<float> v; v.Init(0.f, Dim + 1);
-	TArray<int32> p; p.Init(0, Dim + 1);
-	TArray<int32> way; way.Init(0, Dim + 1);
-
-	for (int32 i = 1; i <= Dim; ++i)
+	// آرایش فشرده‌تر از MinSeparation فقط از لبه‌ها باز می‌شود (O(قطر) تکرار)؛ به جایش یک بار کل آرایش
+	// حول مرکزش طوری بزرگ می‌شود که میانه فاصله تا نزدیک‌ترین همسایه به هدف برسد (شکل آرایش حفظ می‌شود)
+	void ScaleToMedianSpacing(TArray<FVector>& Slots, const FSlotHash& Hash, float MinSeparation, float Target)
 	{
-		p[0] = i;
-		int32 j0 = 0;
-		TArray<float> minv; minv.Init(FLT_MAX, Dim + 1);
-		TArray<bool> used; used.Init(false, Dim + 1);
-
-		do
+		const int32 NumSlots = Slots.Num();
+		TArray<float> Nearest;
+		Nearest.Init(MinSeparation, NumSlots);
+		for (int32 i = 0; i < NumSlots; i++)
 		{
-			used[j0] = true;
-			int32 i0 = p[j0];
-			float delta = FLT_MAX;
-			int32 j1 = 0;
-
-			for (int32 j = 1; j <= Dim; ++j)
-			{
-				if (used[j]) continue;
-				float cur = A[i0 - 1][j - 1] - u[i0] - v[j];
-				if (cur < minv[j]) { minv[j] = cur; way[j] = j0; }
-				if (minv[j] < delta) { delta = minv[j]; j1 = j; }
-			}
-
-			for (int32 j = 0; j <= Dim; ++j)
+			Hash.ForEachNeighbour(i, [&](int32 Other)
 			{
-				if (used[j]) { u[p[j]] += delta; v[j] -= delta; }
-				else minv[j] -= delta;
-			}
-			j0 = j1;
-		} while (p[j0] != 0);
+				Nearest[i] = FMath::Min(Nearest[i], (float)FVector::Dist(Slots[i], Slots[Other]));
+			});
+		}
 
-		do
+		// میانه با هیستوگرام (فاصله‌ها بین صفر و MinSeparation بریده شده‌اند)
+		int32 Histogram[MedianBins + 1] = {};
+		for (const float Distance : Nearest)
 		{
-			int32 j1 = way[j0];
-			p[j0] = p[j1];
-			j0 = j1;
-		} while (j0);
-	}
+			Histogram[FMath::Min(FMath::FloorToInt(Distance / MinSeparation * MedianBins), MedianBins)]++;
+		}
 
-	TArray<int32> Assignment;
-	Assignment.SetNum(N);
-	for (int32 j = 1; j <= Dim; ++j)
-	{
-		if (p[j] > 0 && p[j] <= N && j <= M)
+		int32 Bin = 0;
+		int32 Count = Histogram[0];
+		while (Count * 2 < NumSlots)
 		{
-			Assignment[p[j] - 1] = j - 1;
+			Count += Histogram[++Bin];
 		}
-	}
+		const float Median = (Bin + 0.5f) * MinSeparation / MedianBins;
 
-	return Assignment;
-}
+		// اسلات‌های روی هم (میانه نزدیک صفر) مقیاس معنی‌داری ندارند؛ Relax آن‌ها را باز می‌کند
+		if (Median >= MinSeparation || Median < MinSeparation * 0.05f)
+			return;
 
-// ---------- Greedy fallback (برای خوشه‌های خیلی بزرگ) ------------
-void UUnitFormationManager::GreedyAssign(const TArray<TArray<float>>& Cost, TArray<int32>& OutAssignment)
-{
-	int32 N = Cost.Num();
-	int32 M = Cost[0].Num();
-	OutAssignment.Init(-1, N);
-	TArray<bool> SlotUsed; SlotUsed.Init(false, M);
+		FVector Centroid = FVector::ZeroVector;
+		for (const FVector& Slot : Slots)
+		{
+			Centroid += Slot;
+		}
+		Centroid /= NumSlots;
 
-	for (int i = 0; i < N; ++i)
-	{
-		float Best = FLT_MAX;
-		int32 BestJ = -1;
-		for (int j = 0; j < M; ++j)
+		const float Scale = Target / Median;
+		for (FVector& Slot : Slots)
 		{
-			if (SlotUsed[j]) continue;
-			if (Cost[i][j] < Best) { Best = Cost[i][j]; BestJ = j; }
+			Slot.X = Centroid.X + (Slot.X - Centroid.X) * Scale;
+			Slot.Y = Centroid.Y + (Slot.Y - Centroid.Y) * Scale;
 		}
-		if (BestJ >= 0) { OutAssignment[i] = BestJ; SlotUsed[BestJ] = true; }
 	}
 }
 
-// ---------- Collision avoidance tweak (simple separation) ------------
 void UUnitFormationManager::ApplySimpleSeparation(TArray<FVector>& Slots, float MinSeparation)
 {
-	int32 M = Slots.Num();
-	if (M < 2) return;
+	const int32 M = Slots.Num();
+	if (M < 2 || MinSeparation <= 0.f) return;
+
+	using namespace FormationSeparation;
+	const float Target = MinSeparation * (1.f + Overshoot);
+
+	FSlotHash Hash;
+	Hash.Build(Slots, MinSeparation);
+	ScaleToMedianSpacing(Slots, Hash, MinSeparation, Target);
 
-	for (int i = 0; i < M; ++i)
+	// Relax تکراری (Jacobi): هل‌های هر تکرار جمع و بعد یک‌جا اعمال می‌شوند تا ترتیب اسلات‌ها نتیجه را عوض نکند
+	TArray<FVector> Push;
+	for (int32 Iteration = 0; Iteration < MaxIterations; Iteration++)
 	{
-		for (int j = i + 1; j < M; ++j)
+		Hash.Build(Slots, MinSeparation);
+		Push.Init(FVector::ZeroVector, M);
+		bool bAnyOverlap = false;
+
+		for (int32 i = 0; i < M; ++i)
 		{
-			float Dist = FVector::Dist(Slots[i], Slots[j]);
-			if (Dist < MinSeparation && Dist > KINDA_SMALL_NUMBER)
-			{
-				FVector Dir = (Slots[j] - Slots[i]).GetSafeNormal();
-				if (Dir.IsNearlyZero()) Dir = FVector::RightVector;
-				float Need = (MinSeparation - Dist) * 0.5f;
-				Slots[i] += -Dir * Need;
-				Slots[j] += Dir * Need;
-			}
-			else if (Dist <= KINDA_SMALL_NUMBER)
+			Hash.ForEachNeighbour(i, [&](int32 j)
 			{
-				float Angle = (float)(i - j) * 0.6f;
-				FVector Jitter = FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * (MinSeparation * 0.5f);
-				Slots[i] += Jitter;
-				Slots[j] -= Jitter;
-			}
+				// هر جفت یک بار
+				if (j < i) return;
+
+				FVector Delta = Slots[j] - Slots[i];
+				float Dist = Delta.Size();
+				if (Dist >= MinSeparation) return;
+
+				bAnyOverlap = true;
+				FVector Dir;
+				if (Dist > KINDA_SMALL_NUMBER)
+				{
+					Dir = Delta / Dist;
+				}
+				else
+				{
+					// روی هم: جهت ثابت بر اساس اندیس‌ها
+					const float Angle = (float)(i - j) * 0.6f;
+					Dir = FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f);
+					Dist = 0.f;
+				}
+
+				const FVector Need = Dir * ((Target - Dist) * 0.5f);
+				Push[i] -= Need;
+				Push[j] += Need;
+			});
+		}
+
+		if (!bAnyOverlap) return;
+
+		for (int32 i = 0; i < M; ++i)
+		{
+			Slots[i] += Push[i];
 		}
 	}
 }
@@ -341,23 +288,8 @@ void UUnitFormationManager::AssignOptimalFormation(
         return ProjRightA < ProjRightB;
     });
 
-    // ۴. مرتب‌سازی اسلات‌ها دقیقاً به همین ترتیب
-    TArray<FVector> SortedSlots = Slots;
-    Algo::Sort(SortedSlots, [&](const FVector& A, const FVector& B) -> bool
-    {
-        float ProjForwardA = FVector::DotProduct(A, FormationForward);
-        float ProjForwardB = FVector::DotProduct(B, FormationForward);
-
-        float ProjRightA = FVector::DotProduct(A, Right);
-        float ProjRightB = FVector::DotProduct(B, Right);
-
-        if (!FMath::IsNearlyEqual(ProjForwardA, ProjForwardB, 30.f))
-        {
-            return ProjForwardA > ProjForwardB;
-        }
-
-        return ProjRightA < ProjRightB;
-    });
+    // ۴. اسلات‌های قالب از قبل به همین ترتیب‌اند (SortKeys: جلو به عقب، چپ به راست)
+    const TArray<FVector>& SortedSlots = Slots;
 
     // ۵. دیباگ خیلی مهم برای تست
     UE_LOG(LogTemp, Warning, TEXT("=== FINAL MILITARY FORMATION ==="));
@@ -387,12 +319,12 @@ void UUnitFormationManager::AssignOptimalFormation(
         Unit->FormationTarget = SortedSlots[i];
         Unit->bReachedFormationTarget = false;
 
-        if (bDrawFormationDebug)
+        if (bDrawFormationDebug && AIDebugDraw::IsEnabled(EAIDebugChannel::Formation))
         {
-            DrawDebugLine(GetWorld(), Unit->GetActorLocation(), SortedSlots[i], FColor::Cyan, false, 15.f, 0, 4.f);
-            DrawDebugSphere(GetWorld(), SortedSlots[i], 40.f, 12, FColor::Green, false, 15.f);
-            DrawDebugString(GetWorld(), SortedSlots[i] + FVector(0, 0, 80),
-                FString::Printf(TEXT("Slot %d"), i), nullptr, FColor::White, 15.f);
+            AIDebugDraw::Line(GetWorld(), EAIDebugChannel::Formation, Unit->GetActorLocation(), SortedSlots[i], FColor::Cyan, 15.f, 4.f);
+            AIDebugDraw::Sphere(GetWorld(), EAIDebugChannel::Formation, SortedSlots[i], 40.f, 12, FColor::Green, 15.f);
+            AIDebugDraw::String(GetWorld(), EAIDebugChannel::Formation, SortedSlots[i] + FVector(0, 0, 80),
+                FString::Printf(TEXT("Slot %d"), i), FColor::White, 15.f);
         }
     }
 }
@@ -416,15 +348,11 @@ TArray<AUnitCharacter*> UUnitFormationManager::GetAllUnitsInThisCluster() const
 
 void UUnitFormationManager::ProjectSlotsToNavMesh(TArray<FVector>& Slots)
 {
-	// این تابع می‌تواند با UNavigationSystemV1::ProjectPointToNavigation پیاده‌سازی شود
-	for (FVector& Slot : Slots)
+	// همه اسلات‌ها با یک Batch (Bitmap کش‌شده یا یک BatchProjectPoints روی NavMesh)؛ اسلات Project نشده دست نمی‌خورد
+	UWorld* World = GetWorld();
+	if (UWalkabilityCacheSubsystem* WalkabilityCache = World ? World->GetSubsystem<UWalkabilityCacheSubsystem>() : nullptr)
 	{
-		FNavLocation NavLoc;
-		if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld()))
-		{
-			if (NavSys->ProjectPointToNavigation(Slot, NavLoc))
-				Slot = NavLoc.Location;
-		}
+		WalkabilityCache->ProjectPointsToNavigation(Slots);
 	}
 }
 
@@ -443,10 +371,17 @@ void UUnitFormationManager::AssignFormationToAllUnits()
 	// 3) تثبیت روی NavMesh
 	ProjectSlotsToNavMesh(Slots);
 
-	// 4) ساخت ماتریس هزینه و حل Hungarian
-	TArray<TArray<float>> CostMatrix;
-	BuildCostMatrix(AllUnits, Slots, CostMatrix);
-	TArray<int32> Assignment = HungarianSolve(CostMatrix);
+	// 4) ساخت ماتریس هزینه و حل (Hungarian یا برای آرایش‌های بزرگ حراج موازی؛ بایاس جلو: اسلات‌های جلوی آرایش برای یونیت‌های نزدیک‌تر)
+	TArray<FVector> UnitLocations;
+	UnitLocations.Reserve(AllUnits.Num());
+	for (AUnitCharacter* Unit : AllUnits)
+	{
+		UnitLocations.Add(Unit ? Unit->GetActorLocation() : FVector::ZeroVector);
+	}
+
+	TArray<int32> Assignment;
+	AssignmentSolver.BuildCostMatrix(UnitLocations, Slots, FinalGoal, FormationForward, 300.f);
+	AssignmentSolver.SolveAuto(Assignment);
 
 	// 5) **فقط** اختصاص اسلات‌ها به یونیت‌ها (بدون فعال‌سازی مسیر مستقیم)
 	for (int32 i = 0; i < AllUnits.Num(); ++i)
@@ -470,39 +405,18 @@ void UUnitFormationManager::BuildFormationSlots(
 	TArray<FVector>& OutSlots,
 	const FVector& InFormationForward)
 {
-	OutSlots.Empty();
-	int32 Count = Cluster.Num();
-	if (Count == 0) return;
-
-	const float Spacing = 75.f;
-	TArray<TArray<float>> Matrix = GetFormationMatrix(Count);
-
-	int32 Rows = Matrix.Num();
-	int32 Columns = Matrix[0].Num();
-
-	FVector Forward = InFormationForward.IsNearlyZero() ? FVector::ForwardVector : InFormationForward;
-	FVector Right = FVector::CrossProduct(Forward, FVector::UpVector).GetSafeNormal();
+	OutSlots.Reset();
+	if (Cluster.Num() == 0) return;
 
-	float HalfW = (Columns - 1) * 0.5f * Spacing;
-	float HalfH = (Rows - 1) * 0.5f * Spacing;
-
-	for (int32 r = 0; r < Rows; r++)
-	{
-		for (int32 c = 0; c < Columns; c++)
-		{
-			if (Matrix[r][c] < 0) continue;
-			float X = (c * Spacing - HalfW) * Matrix[r][c];
-			float Y = r * Spacing - HalfH;
-			OutSlots.Add(Goal + Right * X + Forward * (-Y));
-		}
-	}
+	// قالب کش‌شده برای این تعداد + یک تبدیل به World
+	FFormationTemplateLibrary::Get(FormationShape, Cluster.Num()).TransformToWorld(Goal, InFormationForward, FormationSpacing, OutSlots);
 
-	if (bDrawFormationDebug)
+	if (bDrawFormationDebug && AIDebugDraw::IsEnabled(EAIDebugChannel::Formation))
 	{
 		for (int32 i = 0; i < OutSlots.Num(); ++i)
 		{
-			DrawDebugSphere(GetWorld(), OutSlots[i], 25.f, 8, FColor::Blue, false, DebugDrawTime, 0, 1.5f);
-			DrawDebugString(GetWorld(), OutSlots[i] + FVector(0, 0, 30), FString::Printf(TEXT("%d"), i), nullptr, FColor::White, DebugDrawTime);
+			AIDebugDraw::Sphere(GetWorld(), EAIDebugChannel::Formation, OutSlots[i], 25.f, 8, FColor::Blue, DebugDrawTime, 1.5f);
+			AIDebugDraw::String(GetWorld(), EAIDebugChannel::Formation, OutSlots[i] + FVector(0, 0, 30), FString::Printf(TEXT("%d"), i), FColor::White, DebugDrawTime);
 		}
 	}
 }
@@ -529,10 +443,10 @@ void UUnitFormationManager::MoveUnitsDirectlyToSlots(
 			// ⚡ فقط در اینجا مسیر مستقیم فعال شود
 			Unit->MoveDirectlyToTarget(Slots[SlotIndex]);
 
-			if (bDrawFormationDebug)
+			if (bDrawFormationDebug && AIDebugDraw::IsEnabled(EAIDebugChannel::Formation))
 			{
-				DrawDebugLine(GetWorld(), Unit->GetActorLocation(), Slots[SlotIndex], FColor::Green, false, DebugDrawTime, 0, 1.2f);
-				DrawDebugSphere(GetWorld(), Slots[SlotIndex], 22.f, 6, FColor::Yellow, false, DebugDrawTime, 0, 1.2f);
+				AIDebugDraw::Line(GetWorld(), EAIDebugChannel::Formation, Unit->GetActorLocation(), Slots[SlotIndex], FColor::Green, DebugDrawTime, 1.2f);
+				AIDebugDraw::Sphere(GetWorld(), EAIDebugChannel::Formation, Slots[SlotIndex], 22.f, 6, FColor::Yellow, DebugDrawTime, 1.2f);
 			}
 		}
 	}
@@ -542,6 +456,9 @@ void UUnitFormationManager::MoveUnitsWithClustering(const TArray<AUnitCharacter*
 {
     if (Units.Num() == 0) return;
 
+    // مسیرهای سفارش قبلی که هنوز نرسیده‌اند دیگر لازم نیستند
+    CancelPendingClusterPaths();
+
     bFormationAlreadyAssigned = false;
     this->CurrentClusterUnits = Units;
     this->FinalGoal = Goal;
@@ -550,7 +467,14 @@ void UUnitFormationManager::MoveUnitsWithClustering(const TArray<AUnitCharacter*
     // خوشه‌بندی یونیت‌ها
     TArray<TArray<AUnitCharacter*>> Clusters = UUnitClusterLibrary::ClusterUnits(Units, 500.f);
     ClusterFlowFields.Empty();
-    TArray<FVector> ClusterDirections;
+    ClusterDirections.Reset();
+
+    // مسیر هر خوشه در صف Async درخواست می‌شود؛ هر خوشه به محض رسیدن مسیرش حرکت می‌کند
+    // خوشه‌های بزرگ‌تر Priority بالاتری دارند
+    // همه خوشه‌ها یک مقصد دارند → یک گروه هم‌مقصد (در حالت گرید یک جستجوی معکوس از مقصد برای همه)
+    UWorld* World = GetWorld();
+    UGridPathRequestSubsystem* Requests = World ? World->GetSubsystem<UGridPathRequestSubsystem>() : nullptr;
+    const uint32 GoalGroup = (Requests && Clusters.Num() > 1) ? Requests->NewSharedGoalGroup() : 0;
 
     for (int32 ClusterIndex = 0; ClusterIndex < Clusters.Num(); ++ClusterIndex)
     {
@@ -563,90 +487,178 @@ void UUnitFormationManager::MoveUnitsWithClustering(const TArray<AUnitCharacter*
         UGridPathfinderComponent* Pathfinder = Seed->FindComponentByClass<UGridPathfinderComponent>();
         if (!Pathfinder) continue;
 
-        TArray<FVector> Path = Pathfinder->FindPathShared(Seed->GetActorLocation(), Goal);
-        if (Path.Num() < 1)
+        FPendingClusterPath& Pending = PendingClusterPaths.AddDefaulted_GetRef();
+        Pending.ClusterIndex = ClusterIndex;
+        Pending.Units.Reserve(Cluster.Num());
+        for (AUnitCharacter* Unit : Cluster)
         {
-            UE_LOG(LogTemp, Warning, TEXT("Cluster %d: No Path!"), ClusterIndex);
-            continue;
+            Pending.Units.Add(Unit);
         }
 
-        bool bIsSingleUnit = (Cluster.Num() == 1);
+        Pending.RequestId = Pathfinder->FindPathAsync(
+            Seed->GetActorLocation(),
+            Goal,
+            FOnGridPathComplete::CreateUObject(this, &UUnitFormationManager::OnClusterPathReady, ClusterIndex),
+            Cluster.Num(),
+            GoalGroup);
 
-        // ===== تک یونیت =====
-    	if (bIsSingleUnit)
-    	{
-    		AUnitCharacter* Unit = Cluster[0];
-    		if (!Unit) continue;
+        if (Pending.RequestId == 0)
+        {
+            PendingClusterPaths.Pop(EAllowShrinking::No);
+        }
+    }
 
-    		// مسیر و هدف
-    		Unit->FinalGoalLocation = Goal;
-    		Unit->FinalGoalRadius = 500.f;
+    // هیچ درخواستی ثبت نشد → آرایش همین حالا ساخته می‌شود
+    if (PendingClusterPaths.Num() == 0)
+    {
+        FinishClusterMoveOrder();
+    }
+}
 
-    		// مسیر مستقیم نقطه به نقطه
-    		Unit->FollowPathDirectly(Path);  // ← این را جایگزین SetPathAndMove(Path,true) کن
-    		Unit->bUseFlowField = false;     // مطمئن شو FlowField خاموش است
+void UUnitFormationManager::CancelPendingClusterPaths()
+{
+    UWorld* World = GetWorld();
+    if (UGridPathRequestSubsystem* Requests = World ? World->GetSubsystem<UGridPathRequestSubsystem>() : nullptr)
+    {
+        for (const FPendingClusterPath& Pending : PendingClusterPaths)
+        {
+            Requests->CancelRequest(Pending.RequestId);
+        }
+    }
+    PendingClusterPaths.Reset();
+}
 
-    		UE_LOG(LogTemp, Warning, TEXT("Single unit %s moving along path without FlowField"), *Unit->GetName());
-    		continue;
-    	}
+void UUnitFormationManager::OnClusterPathReady(const TArray<FVector>& ResultPath, int32 ClusterIndex)
+{
+    const int32 PendingIndex = PendingClusterPaths.IndexOfByPredicate([ClusterIndex](const FPendingClusterPath& Pending)
+    {
+        return Pending.ClusterIndex == ClusterIndex;
+    });
+    if (PendingIndex == INDEX_NONE) return;
 
+    // یونیت‌هایی که در این فاصله از بین رفته‌اند حذف می‌شوند
+    TArray<AUnitCharacter*> Cluster;
+    for (const TWeakObjectPtr<AUnitCharacter>& Unit : PendingClusterPaths[PendingIndex].Units)
+    {
+        if (AUnitCharacter* Alive = Unit.Get())
+        {
+            Cluster.Add(Alive);
+        }
+    }
+    PendingClusterPaths.RemoveAtSwap(PendingIndex, 1, EAllowShrinking::No);
 
-        // ===== خوشه‌های بزرگتر از 1 =====
-        FVector ClusterDir = (Path.Last() - Path[0]).GetSafeNormal();
-        ClusterDirections.Add(ClusterDir);
+    if (ResultPath.Num() < 1)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("Cluster %d: No Path!"), ClusterIndex);
+    }
+    else if (Cluster.Num() > 0)
+    {
+        StartClusterMove(Cluster, ClusterIndex, ResultPath);
+    }
 
-        // مرکز خوشه و عرض مسیر
-        FVector ClusterCenter(0.f);
-        for (AUnitCharacter* Unit : Cluster)
-            if (Unit) ClusterCenter += Unit->GetActorLocation();
-        ClusterCenter /= Cluster.Num();
+    // آخرین مسیر سفارش رسید → آرایش نهایی برای همه یونیت‌ها
+    if (PendingClusterPaths.Num() == 0)
+    {
+        FinishClusterMoveOrder();
+    }
+}
 
-        float CorridorWidthCm = CalculateCorridorWidthForCluster(Cluster, ClusterCenter, ClusterDir, Seed);
+void UUnitFormationManager::StartClusterMove(const TArray<AUnitCharacter*>& Cluster, int32 ClusterIndex, const TArray<FVector>& Path)
+{
+    const FVector Goal = FinalGoal;
+    AUnitCharacter* Seed = Cluster[0];
 
-        // Back offset
-        float MaxBackwardDist = 0.f;
-        FVector BackDir = -ClusterDir;
-        for (AUnitCharacter* Unit : Cluster)
-        {
-            if (!Unit) continue;
-            float BackAmount = FVector::DotProduct(Unit->GetActorLocation() - Seed->GetActorLocation(), BackDir);
-            if (BackAmount > MaxBackwardDist) MaxBackwardDist = BackAmount;
-        }
+    bool bIsSingleUnit = (Cluster.Num() == 1);
+
+    // ===== تک یونیت =====
+	if (bIsSingleUnit)
+	{
+		AUnitCharacter* Unit = Cluster[0];
+		if (!Unit) return;
 
-        float CapsuleRadius = 0.f;
-        if (UCapsuleComponent* Cap = Seed->FindComponentByClass<UCapsuleComponent>())
-            CapsuleRadius = Cap->GetScaledCapsuleRadius();
+		// مسیر و هدف
+		Unit->FinalGoalLocation = Goal;
+		Unit->FinalGoalRadius = 500.f;
 
-        float Safety = CapsuleRadius * 6.f;
-        float TotalOffset = MaxBackwardDist + Safety;
-        FVector ExtendedStart = Path[0] - ClusterDir * TotalOffset;
-        Path.Insert(ExtendedStart, 0);
+		// مسیر مستقیم نقطه به نقطه
+		Unit->FollowPathDirectly(Path);  // ← این را جایگزین SetPathAndMove(Path,true) کن
+		Unit->bUseFlowField = false;     // مطمئن شو FlowField خاموش است
 
-        // ===== ساخت FlowField =====
-        UFlowFieldComponent* FF = NewObject<UFlowFieldComponent>(this);
-        if (FF)
-        {
-            FF->RegisterComponent();
-            FF->Activate();
-            FF->GenerateFlowField(Path.Last(), Path, FMath::RoundToInt(CorridorWidthCm));
-            FF->TickComponent(0.f, ELevelTick::LEVELTICK_All, nullptr);
-            ClusterFlowFields.Add(FF);
-        }
+		UE_LOG(LogTemp, Warning, TEXT("Single unit %s moving along path without FlowField"), *Unit->GetName());
+		return;
+	}
 
-        // اختصاص مقصد و FlowField به یونیت‌ها
-        for (AUnitCharacter* Unit : Cluster)
-        {
-            if (!Unit) continue;
-            Unit->FinalGoalLocation = Goal;
-            Unit->FinalGoalRadius = 500.f;
-            Unit->SetClusterFlowField(FF);
-            Unit->SetPathAndMove(Path, false); // خوشه چند نفره → FlowField فعال
-        }
 
-        UE_LOG(LogTemp, Warning, TEXT("Cluster %d Started Move"), ClusterIndex + 1);
+    // ===== خوشه‌های بزرگتر از 1 =====
+    FVector ClusterDir = (Path.Last() - Path[0]).GetSafeNormal();
+    ClusterDirections.Add(ClusterDir);
+
+    // مرکز خوشه و عرض مسیر
+    FVector ClusterCenter(0.f);
+    for (AUnitCharacter* Unit : Cluster)
+        if (Unit) ClusterCenter += Unit->GetActorLocation();
+    ClusterCenter /= Cluster.Num();
+
+    float CorridorWidthCm = CalculateCorridorWidthForCluster(Cluster, ClusterCenter, ClusterDir, Seed);
+
+    // Back offset
+    float MaxBackwardDist = 0.f;
+    FVector BackDir = -ClusterDir;
+    for (AUnitCharacter* Unit : Cluster)
+    {
+        if (!Unit) continue;
+        float BackAmount = FVector::DotProduct(Unit->GetActorLocation() - Seed->GetActorLocation(), BackDir);
+        if (BackAmount > MaxBackwardDist) MaxBackwardDist = BackAmount;
     }
 
+    float CapsuleRadius = 0.f;
+    if (UCapsuleComponent* Cap = Seed->FindComponentByClass<UCapsuleComponent>())
+        CapsuleRadius = Cap->GetScaledCapsuleRadius();
+
+    float Safety = CapsuleRadius * 6.f;
+    float TotalOffset = MaxBackwardDist + Safety;
+    FVector ExtendedStart = Path[0] - ClusterDir * TotalOffset;
+
+    // مسیر خوشه (با شروع عقب‌کشیده) یک بار ساخته و بین همه یونیت‌ها و FlowField مشترک می‌شود
+    TArray<FVector> ClusterPoints;
+    ClusterPoints.Reserve(Path.Num() + 1);
+    ClusterPoints.Add(ExtendedStart);
+    ClusterPoints.Append(Path);
+    const FGridPathHandle ClusterPath(MoveTemp(ClusterPoints));
+
+    // ===== ساخت FlowField (در پس‌زمینه؛ یونیت‌ها تا آماده شدن فیلد قبلی یا مسیر مستقیم را دنبال می‌کنند) =====
+    UFlowFieldComponent* FF = NewObject<UFlowFieldComponent>(this);
+    if (FF)
+    {
+        FF->RegisterComponent();
+        FF->Activate();
+        FF->GenerateFlowFieldAsync(ClusterPath.Last(), ClusterPath.GetPoints(), FMath::RoundToInt(CorridorWidthCm));
+        FF->TickComponent(0.f, ELevelTick::LEVELTICK_All, nullptr);
+        ClusterFlowFields.Add(FF);
+    }
+
+    // اختصاص مقصد و FlowField به یونیت‌ها
+    for (AUnitCharacter* Unit : Cluster)
+    {
+        if (!Unit) continue;
+        Unit->FinalGoalLocation = Goal;
+        Unit->FinalGoalRadius = 500.f;
+        Unit->SetClusterFlowField(FF);
+        Unit->SetPathAndMove(ClusterPath, false); // خوشه چند نفره → FlowField فعال
+    }
+
+    UE_LOG(LogTemp, Warning, TEXT("Cluster %d Started Move"), ClusterIndex + 1);
+}
+
+void UUnitFormationManager::FinishClusterMoveOrder()
+{
     // ===== اصلاح: ساخت آرایش Formation برای تمام یونیت‌ها =====
+    TArray<AUnitCharacter*> Units;
+    for (AUnitCharacter* Unit : CurrentClusterUnits)
+    {
+        if (IsValid(Unit)) Units.Add(Unit);
+    }
+
     if (Units.Num() > 0)
     {
         FVector TotalDir(0.f);
@@ -655,7 +667,7 @@ void UUnitFormationManager::MoveUnitsWithClustering(const TArray<AUnitCharacter*
 
         this->FormationForward = TotalDir.IsNearlyZero() ? FVector::ForwardVector : TotalDir.GetSafeNormal();
 
-        AssignOptimalFormation(Units, Goal, this->FormationForward);
+        AssignOptimalFormation(Units, FinalGoal, this->FormationForward);
     }
 }
 
@@ -0,0 +1,127 @@
+#include "AI/UWalkabilityBakeAsset.h"
+
+void UWalkabilityBakeAsset::PostLoad()
+{
+    Super::PostLoad();
+    RebuildTileIndex();
+}
+
+void UWalkabilityBakeAsset::RebuildTileIndex()
+{
+    TileIndex.Reset();
+    TileIndex.Reserve(Tiles.Num());
+    for (int32 Index = 0; Index < Tiles.Num(); Index++)
+    {
+        TileIndex.Add(Tiles[Index].Coord, Index);
+    }
+}
+
+const FWalkabilityBakedTile* UWalkabilityBakeAsset::FindTile(const FIntPoint& Coord) const
+{
+    const int32* Index = TileIndex.Find(Coord);
+    return Index ? &Tiles[*Index] : nullptr;
+}
+
+void UWalkabilityBakeAsset::SetBakedTiles(float InCellSize, float InObstacleInflation, int32 InTileSizeCells, const FBox& InBounds, TArray<FWalkabilityBakedTile>&& InTiles)
+{
+    CellSize = InCellSize;
+    ObstacleInflation = InObstacleInflation;
+    TileSizeCells = InTileSizeCells;
+    BakedBounds = InBounds;
+    Tiles = MoveTemp(InTiles);
+    RebuildTileIndex();
+    MarkPackageDirty();
+}
+
+int32 UWalkabilityBakeAsset::GetEncodedSize() const
+{
+    int32 Bytes = 0;
+    for (const FWalkabilityBakedTile& Tile : Tiles)
+    {
+        Bytes += sizeof(Tile.Coord)
+            + Tile.WalkableRuns.Num() * sizeof(uint16)
+            + Tile.ClearanceValues.Num() * sizeof(uint8)
+            + Tile.ClearanceCounts.Num() * sizeof(uint16);
+    }
+    return Bytes;
+}
+
+void UWalkabilityBakeAsset::EncodeTile(const FIntPoint& Coord, const TBitArray<>& Walkable, TConstArrayView<uint8> Clearance, FWalkabilityBakedTile& OutTile)
+{
+    OutTile.Coord = Coord;
+    OutTile.WalkableRuns.Reset();
+    OutTile.ClearanceValues.Reset();
+    OutTile.ClearanceCounts.Reset();
+
+    // Walkable: رشته‌های متناوب؛ رشته طولانی‌تر از uint16 با یک رشته صفر از مقدار مخالف شکسته می‌شود
+    bool bCurrent = false;
+    uint16 Run = 0;
+    for (int32 Index = 0; Index < Walkable.Num(); Index++)
+    {
+        if (Walkable[Index] != bCurrent || Run == MAX_uint16)
+        {
+            OutTile.WalkableRuns.Add(Run);
+            if (Walkable[Index] == bCurrent)
+            {
+                OutTile.WalkableRuns.Add(0);
+            }
+            bCurrent = Walkable[Index];
+            Run = 0;
+        }
+        Run++;
+    }
+    OutTile.WalkableRuns.Add(Run);
+
+    // Clearance: جفت (مقدار، تعداد)
+    for (int32 Index = 0; Index < Clearance.Num(); Index++)
+    {
+        const int32 Last = OutTile.ClearanceValues.Num() - 1;
+        if (Last >= 0 && OutTile.ClearanceValues[Last] == Clearance[Index] && OutTile.ClearanceCounts[Last] < MAX_uint16)
+        {
+            OutTile.ClearanceCounts[Last]++;
+        }
+        else
+        {
+            OutTile.ClearanceValues.Add(Clearance[Index]);
+            OutTile.ClearanceCounts.Add(1);
+        }
+    }
+}
+
+bool UWalkabilityBakeAsset::DecodeTile(const FWalkabilityBakedTile& Tile, int32 NumCells, TBitArray<>& OutWalkable, TArray<uint8>& OutClearance)
+{
+    if (Tile.ClearanceValues.Num() != Tile.ClearanceCounts.Num())
+        return false;
+
+    OutWalkable.Init(false, NumCells);
+    int32 Cell = 0;
+    bool bCurrent = false;
+    for (const uint16 Run : Tile.WalkableRuns)
+    {
+        if (Cell + Run > NumCells)
+            return false;
+
+        if (bCurrent)
+        {
+            OutWalkable.SetRange(Cell, Run, true);
+        }
+        Cell += Run;
+        bCurrent = !bCurrent;
+    }
+    if (Cell != NumCells)
+        return false;
+
+    OutClearance.SetNumUninitialized(NumCells);
+    Cell = 0;
+    for (int32 RunIndex = 0; RunIndex < Tile.ClearanceValues.Num(); RunIndex++)
+    {
+        const int32 Count = Tile.ClearanceCounts[RunIndex];
+        if (Cell + Count > NumCells)
+            return false;
+
+        FMemory::Memset(OutClearance.GetData() + Cell, Tile.ClearanceValues[RunIndex], Count);
+        Cell += Count;
+    }
+
+    return Cell == NumCells;
+}
@@ -0,0 +1,961 @@
+#include "AI/UWalkabilityCacheSubsystem.h"
+#include "AI/GridPathfinderComponent.h"
+#include "AI/UWalkabilityBakeAsset.h"
+#include "NavigationSystem.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/ParallelFor.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Algo/Sort.h"
+
+static float GWalkabilityCellSize = 25.f;
+static FAutoConsoleVariableRef CVarWalkabilityCellSize(
+    TEXT("ai.Walkability.CellSize"),
+    GWalkabilityCellSize,
+    TEXT("Cell size (cm) of the cached static walkability bitmap. Changing it drops all cached tiles."));
+
+static float GWalkabilityInflation = 27.f;
+static FAutoConsoleVariableRef CVarWalkabilityInflation(
+    TEXT("ai.Walkability.ObstacleInflation"),
+    GWalkabilityInflation,
+    TEXT("Distance (cm) by which static obstacles are grown when building walkability tiles (about a unit capsule radius)."));
+
+static float GWalkabilityMaxClearance = 100.f;
+static FAutoConsoleVariableRef CVarWalkabilityMaxClearance(
+    TEXT("ai.Walkability.MaxClearanceCm"),
+    GWalkabilityMaxClearance,
+    TEXT("Largest clearance (cm) any query asks for (about the largest unit radius). Runtime tiles read this far into neighbouring tiles and clamp stored clearance to it."));
+
+static int32 GGridPathMaxWindowTiles = 12;
+static FAutoConsoleVariableRef CVarGridPathMaxWindowTiles(
+    TEXT("ai.GridPath.MaxWindowTiles"),
+    GGridPathMaxWindowTiles,
+    TEXT("Largest grid search window (walkability tiles per side) for JPS paths. Longer requests fall back to the navmesh."));
+
+static int32 GGridPathWindowMargin = 32;
+static FAutoConsoleVariableRef CVarGridPathWindowMargin(
+    TEXT("ai.GridPath.WindowMarginCells"),
+    GGridPathWindowMargin,
+    TEXT("Cells added around the start/goal bounding box before it is rounded up to whole tiles for a JPS search window."));
+
+namespace WalkabilityCache
+{
+    // بازه ارتفاع بالا/پایین نقطه Query برای جمع‌آوری NavMesh و موانع تایل
+    constexpr float TileHeightCm = 1000.f;
+
+    // وزن‌های Chamfer برای قدم مستقیم و قطری (نسبت تقریبی ۱ به √۲)
+    constexpr int32 StraightStep = 3;
+    constexpr int32 DiagonalStep = 4;
+
+    // سقف اندازه محدوده Bake (سلول)
+    constexpr int64 MaxBakeCells = 64 * 1024 * 1024;
+
+    // Batch خط دید کوچک‌تر از این روی همان Thread اجرا می‌شود
+    constexpr int32 MinParallelLineOfSight = 16;
+
+    // کمترین تعداد نقطه هر تکه موازی Projection روی NavMesh (هر تکه یک Query Object می‌سازد)
+    constexpr int32 MinProjectionsPerChunk = 128;
+
+    // مقدار Clearance سلول → فاصله مرکز سلول تا لبه سلول مسدود
+    float ClearanceToCm(uint8 Clearance, float CellSize)
+    {
+        return Clearance == 0 ? 0.f : (Clearance - 0.5f) * CellSize;
+    }
+}
+
+void UWalkabilityCacheSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+    Super::OnWorldBeginPlay(InWorld);
+
+    CellSize = FMath::Max(GWalkabilityCellSize, 1.f);
+
+    // هر تغییر NavMesh ناحیه‌اش را Dirty اعلام می‌کند؛ ساخت واقعی تایل‌های NavMesh بعداً تمام می‌شود
+    NavigationDirtyHandle = UNavigationSystemV1::NavigationDirtyEvent.AddUObject(this, &UWalkabilityCacheSubsystem::OnNavigationDirtied);
+
+    if (UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(&InWorld))
+    {
+        NavSys->OnNavigationGenerationFinishedDelegate.AddUniqueDynamic(this, &UWalkabilityCacheSubsystem::OnNavigationGenerationFinished);
+    }
+}
+
+void UWalkabilityCacheSubsystem::Deinitialize()
+{
+    UNavigationSystemV1::NavigationDirtyEvent.Remove(NavigationDirtyHandle);
+    NavigationDirtyHandle.Reset();
+
+    if (UNavigationSystemV1* NavSys = UNavigationSystemV1::GetCurrent(GetWorld()))
+    {
+        NavSys->OnNavigationGenerationFinishedDelegate.RemoveDynamic(this, &UWalkabilityCacheSubsystem::OnNavigationGenerationFinished);
+    }
+
+    InvalidateAll();
+    BakedData = nullptr;
+    StaleBakedTiles.Empty();
+    Super::Deinitialize();
+}
+
+FIntPoint UWalkabilityCacheSubsystem::WorldToCell(const FVector& Location) const
+{
+    return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+FIntPoint UWalkabilityCacheSubsystem::CellToTile(const FIntPoint& Cell)
+{
+    // تقسیم رو به پایین (برای مختصات منفی)
+    return FIntPoint(FMath::FloorToInt((float)Cell.X / TileSizeCells), FMath::FloorToInt((float)Cell.Y / TileSizeCells));
+}
+
+void UWalkabilityCacheSubsystem::SyncCellSize()
+{
+    const float WantedCellSize = FMath::Max(GWalkabilityCellSize, 1.f);
+    if (WantedCellSize != CellSize)
+    {
+        InvalidateAll();
+        CellSize = WantedCellSize;
+    }
+}
+
+float UWalkabilityCacheSubsystem::GetObstacleInflation() const
+{
+    return GWalkabilityInflation;
+}
+
+bool UWalkabilityCacheSubsystem::IsWalkable(const FVector& Location, float MinClearanceCm)
+{
+    SyncCellSize();
+    return IsCellWalkable(WorldToCell(Location), Location.Z, MinClearanceCm);
+}
+
+bool UWalkabilityCacheSubsystem::TryGetWalkable(const FVector& Location, bool& bOutWalkable) const
+{
+    const FIntPoint Cell = WorldToCell(Location);
+    const FIntPoint TileCoord = CellToTile(Cell);
+    const FTile* Tile = Tiles.Find(TileCoord);
+    if (!Tile)
+        return false;
+
+    const int32 LocalX = Cell.X - TileCoord.X * TileSizeCells;
+    const int32 LocalY = Cell.Y - TileCoord.Y * TileSizeCells;
+    bOutWalkable = Tile->Walkable[LocalY * TileSizeCells + LocalX];
+    return true;
+}
+
+bool UWalkabilityCacheSubsystem::IsCellWalkable(const FIntPoint& Cell, float HeightHint, float MinClearanceCm)
+{
+    const FIntPoint TileCoord = CellToTile(Cell);
+    const FTile& Tile = GetOrBuildTile(TileCoord, HeightHint);
+
+    const int32 LocalX = Cell.X - TileCoord.X * TileSizeCells;
+    const int32 LocalY = Cell.Y - TileCoord.Y * TileSizeCells;
+    const int32 Index = LocalY * TileSizeCells + LocalX;
+    if (!Tile.Walkable[Index])
+        return false;
+
+    return MinClearanceCm <= 0.f || WalkabilityCache::ClearanceToCm(Tile.Clearance[Index], CellSize) >= MinClearanceCm;
+}
+
+bool UWalkabilityCacheSubsystem::IsBuiltCellWalkable(const FIntPoint& Cell, float MinClearanceCm) const
+{
+    const FIntPoint TileCoord = CellToTile(Cell);
+    const FTile* Tile = Tiles.Find(TileCoord);
+    if (!Tile)
+        return false;
+
+    const int32 LocalX = Cell.X - TileCoord.X * TileSizeCells;
+    const int32 LocalY = Cell.Y - TileCoord.Y * TileSizeCells;
+    const int32 Index = LocalY * TileSizeCells + LocalX;
+    return Tile->Walkable[Index]
+        && (MinClearanceCm <= 0.f || WalkabilityCache::ClearanceToCm(Tile->Clearance[Index], CellSize) >= MinClearanceCm);
+}
+
+// پیمایش همه سلول‌هایی که پاره‌خط XY از آن‌ها می‌گذرد (Amanatides-Woo؛ عبور دقیق از گوشه هر دو سلول کناری را هم می‌بیند)
+// Visit برای هر سلول صدا زده می‌شود و با false پیمایش متوقف می‌شود
+template <typename FVisitCell>
+static bool TraverseSupercoverCells(const FVector& Start, const FVector& End, double CellSize, FVisitCell&& Visit)
+{
+    const FIntPoint StartCell(FMath::FloorToInt(Start.X / CellSize), FMath::FloorToInt(Start.Y / CellSize));
+    const FIntPoint EndCell(FMath::FloorToInt(End.X / CellSize), FMath::FloorToInt(End.Y / CellSize));
+
+    const double DeltaX = End.X - Start.X;
+    const double DeltaY = End.Y - Start.Y;
+    const int32 StepX = DeltaX > 0.0 ? 1 : (DeltaX < 0.0 ? -1 : 0);
+    const int32 StepY = DeltaY > 0.0 ? 1 : (DeltaY < 0.0 ? -1 : 0);
+
+    // پارامتر t (۰ تا ۱ روی پاره‌خط) تا مرز بعدی سلول در هر محور
+    const double Infinity = TNumericLimits<double>::Max();
+    const double TDeltaX = StepX != 0 ? CellSize / FMath::Abs(DeltaX) : Infinity;
+    const double TDeltaY = StepY != 0 ? CellSize / FMath::Abs(DeltaY) : Infinity;
+    double TMaxX = StepX != 0 ? ((StartCell.X + (StepX > 0 ? 1 : 0)) * CellSize - Start.X) / DeltaX : Infinity;
+    double TMaxY = StepY != 0 ? ((StartCell.Y + (StepY > 0 ? 1 : 0)) * CellSize - Start.Y) / DeltaY : Infinity;
+
+    FIntPoint Cell = StartCell;
+    if (!Visit(Cell))
+        return false;
+
+    // سقف قدم‌ها در برابر خطای عددی نزدیک سلول آخر
+    const int32 MaxSteps = FMath::Abs(EndCell.X - StartCell.X) + FMath::Abs(EndCell.Y - StartCell.Y);
+    for (int32 Step = 0; Step < MaxSteps && Cell != EndCell; Step++)
+    {
+        if (TMaxX < TMaxY)
+        {
+            Cell.X += StepX;
+            TMaxX += TDeltaX;
+        }
+        else if (TMaxY < TMaxX)
+        {
+            Cell.Y += StepY;
+            TMaxY += TDeltaY;
+        }
+        else
+        {
+            if (!Visit(FIntPoint(Cell.X + StepX, Cell.Y)) || !Visit(FIntPoint(Cell.X, Cell.Y + StepY)))
+                return false;
+
+            Cell.X += StepX;
+            Cell.Y += StepY;
+            TMaxX += TDeltaX;
+            TMaxY += TDeltaY;
+        }
+
+        if (!Visit(Cell))
+            return false;
+    }
+
+    return true;
+}
+
+// خط دید با یک تست سلول دلخواه؛ سلول‌های مسدود همسایه سلول شروع تا اولین سلول باز نادیده گرفته می‌شوند
+template <typename FIsCellClear>
+static bool TraceWalkabilityLine(const FVector& Start, const FVector& End, float CellSize, FIsCellClear&& IsCellClear)
+{
+    const FIntPoint StartCell(FMath::FloorToInt(Start.X / CellSize), FMath::FloorToInt(Start.Y / CellSize));
+    bool bLeftStart = false;
+
+    return TraverseSupercoverCells(Start, End, CellSize, [&](const FIntPoint& Cell)
+    {
+        if (IsCellClear(Cell))
+        {
+            bLeftStart = true;
+            return true;
+        }
+        return !bLeftStart && FMath::Abs(Cell.X - StartCell.X) <= 1 && FMath::Abs(Cell.Y - StartCell.Y) <= 1;
+    });
+}
+
+bool UWalkabilityCacheSubsystem::HasLineOfSight(const FVector& Start, const FVector& End, float MinClearanceCm)
+{
+    SyncCellSize();
+
+    return TraceWalkabilityLine(Start, End, CellSize, [&](const FIntPoint& Cell)
+    {
+        return IsCellWalkable(Cell, Start.Z, MinClearanceCm);
+    });
+}
+
+void UWalkabilityCacheSubsystem::HasLineOfSightBatch(TConstArrayView<FVector> Starts, TConstArrayView<FVector> Ends, float MinClearanceCm, TArrayView<bool> OutVisible)
+{
+    check(Starts.Num() == Ends.Num() && Starts.Num() == OutVisible.Num());
+
+    SyncCellSize();
+
+    // ۱) ساخت تایل‌ها فقط روی Game Thread: همان پیمایش در مقیاس تایل
+    const double TileCm = (double)CellSize * TileSizeCells;
+    for (int32 Index = 0; Index < Starts.Num(); Index++)
+    {
+        const float HeightHint = Starts[Index].Z;
+        TraverseSupercoverCells(Starts[Index], Ends[Index], TileCm, [&](const FIntPoint& TileCoord)
+        {
+            GetOrBuildTile(TileCoord, HeightHint);
+            return true;
+        });
+    }
+
+    // ۲) پیمایش سلول‌ها فقط خواندن است → موازی
+    const UWalkabilityCacheSubsystem* ConstThis = this;
+    ParallelFor(Starts.Num(), [&](int32 Index)
+    {
+        OutVisible[Index] = TraceWalkabilityLine(Starts[Index], Ends[Index], CellSize, [&](const FIntPoint& Cell)
+        {
+            return ConstThis->IsBuiltCellWalkable(Cell, MinClearanceCm);
+        });
+    }, Starts.Num() < WalkabilityCache::MinParallelLineOfSight ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+int32 UWalkabilityCacheSubsystem::ProjectPointsToNavigation(TArrayView<FVector> Points, const FVector& QueryExtent, bool bAllowParallel)
+{
+    SyncCellSize();
+
+    UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+    const ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate) : nullptr;
+    const FVector Extent = FNavigationSystem::IsValidExtent(QueryExtent)
+        ? QueryExtent
+        : (NavData ? NavData->GetConfig().DefaultQueryExtent : FVector(CellSize));
+
+    // ۱) نقاط داخل تایل‌های ساخته‌شده از روی Bitmap: قابل عبور دست نمی‌خورد، مسدود به نزدیک‌ترین سلول باز در شعاع Extent
+    int32 NumProjected = 0;
+    TArray<int32> Pending;
+    for (int32 Index = 0; Index < Points.Num(); Index++)
+    {
+        bool bWalkable = false;
+        FVector Closest;
+        if (!TryGetWalkable(Points[Index], bWalkable))
+        {
+            Pending.Add(Index);
+        }
+        else if (bWalkable)
+        {
+            NumProjected++;
+        }
+        else if (FindClosestWalkable(Points[Index], (float)Extent.X, Closest))
+        {
+            Points[Index] = Closest;
+            NumProjected++;
+        }
+        else
+        {
+            Pending.Add(Index);
+        }
+    }
+
+    if (Pending.Num() == 0 || !NavData)
+        return NumProjected;
+
+    // ۲) بقیه روی NavMesh: مرتب به ترتیب تایل NavMesh تا Queryهای پشت سر هم همان داده را بخوانند
+    if (const ARecastNavMesh* RecastNavMesh = Cast<ARecastNavMesh>(NavData))
+    {
+        TArray<TPair<uint64, int32>> Keyed;
+        Keyed.Reserve(Pending.Num());
+        for (const int32 Index : Pending)
+        {
+            int32 TileX = 0;
+            int32 TileY = 0;
+            RecastNavMesh->GetNavMeshTileXY(Points[Index], TileX, TileY);
+            Keyed.Add(TPair<uint64, int32>(((uint64)(uint32)TileY << 32) | (uint32)TileX, Index));
+        }
+        Algo::SortBy(Keyed, [](const TPair<uint64, int32>& Entry) { return Entry.Key; });
+        for (int32 Order = 0; Order < Keyed.Num(); Order++)
+        {
+            Pending[Order] = Keyed[Order].Value;
+        }
+    }
+
+    // هر تکه پشت سر هم در ترتیب تایل و یک BatchProjectPoints (یک Query Object)؛ تکه‌ها فقط NavMesh را می‌خوانند → موازی
+    const int32 MaxChunks = bAllowParallel ? FMath::Max(Pending.Num() / WalkabilityCache::MinProjectionsPerChunk, 1) : 1;
+    const int32 NumChunks = FMath::Min(MaxChunks, FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+    const int32 ChunkSize = FMath::DivideAndRoundUp(Pending.Num(), NumChunks);
+
+    TArray<TArray<FNavigationProjectionWork>> Workloads;
+    Workloads.SetNum(NumChunks);
+    for (int32 Order = 0; Order < Pending.Num(); Order++)
+    {
+        Workloads[Order / ChunkSize].Add(FNavigationProjectionWork(Points[Pending[Order]]));
+    }
+
+    ParallelFor(NumChunks, [&Workloads, NavData, &Extent](int32 Chunk)
+    {
+        NavData->BatchProjectPoints(Workloads[Chunk], Extent);
+    }, NumChunks > 1 ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+
+    for (int32 Order = 0; Order < Pending.Num(); Order++)
+    {
+        const FNavigationProjectionWork& Work = Workloads[Order / ChunkSize][Order % ChunkSize];
+        if (Work.bResult)
+        {
+            Points[Pending[Order]] = Work.OutLocation.Location;
+            NumProjected++;
+        }
+    }
+
+    return NumProjected;
+}
+
+bool UWalkabilityCacheSubsystem::SampleWalkability(const FVector2D& GridOrigin, float SampleCellSize, int32 Width, int32 Height, float HeightHint, TBitArray<>& OutWalkable)
+{
+    if (Width <= 0 || Height <= 0 || SampleCellSize <= 0.f)
+        return false;
+
+    SyncCellSize();
+    OutWalkable.Init(false, Width * Height);
+
+    // سلول‌های پشت سر هم معمولاً در همان تایل‌اند → جستجوی Map فقط با عوض شدن تایل
+    FIntPoint CurrentTileCoord(TNumericLimits<int32>::Max(), TNumericLimits<int32>::Max());
+    const FTile* CurrentTile = nullptr;
+
+    for (int32 y = 0; y < Height; y++)
+    {
+        for (int32 x = 0; x < Width; x++)
+        {
+            const FVector Center(GridOrigin.X + (x + 0.5f) * SampleCellSize, GridOrigin.Y + (y + 0.5f) * SampleCellSize, HeightHint);
+            const FIntPoint Cell = WorldToCell(Center);
+            const FIntPoint TileCoord = CellToTile(Cell);
+            if (TileCoord != CurrentTileCoord)
+            {
+                // ساخت تایل جدید ممکن است Map را جابه‌جا کند؛ فقط اشاره‌گر آخرین تایل نگه داشته می‌شود
+                CurrentTile = &GetOrBuildTile(TileCoord, HeightHint);
+                CurrentTileCoord = TileCoord;
+            }
+
+            const int32 LocalX = Cell.X - TileCoord.X * TileSizeCells;
+            const int32 LocalY = Cell.Y - TileCoord.Y * TileSizeCells;
+            OutWalkable[y * Width + x] = CurrentTile->Walkable[LocalY * TileSizeCells + LocalX];
+        }
+    }
+
+    return true;
+}
+
+bool UWalkabilityCacheSubsystem::FindClosestWalkable(const FVector& Origin, float SearchRadius, FVector& OutLocation, float MinClearanceCm)
+{
+    SyncCellSize();
+
+    const FIntPoint Center = WorldToCell(Origin);
+    const int32 MaxRing = FMath::CeilToInt(SearchRadius / CellSize);
+
+    // حلقه‌های مربعی رو به بیرون؛ در هر حلقه نزدیک‌ترین مرکز سلول واقعی (نه فاصله حلقه) انتخاب می‌شود
+    // و چون سلول‌های حلقه‌های بعدی حداقل Ring * CellSize دورترند، با پیدا شدن اولین جواب کافی است حلقه بعد هم دیده شود
+    double BestDistSq = TNumericLimits<double>::Max();
+    bool bFound = false;
+    for (int32 Ring = 0; Ring <= MaxRing; Ring++)
+    {
+        if (bFound && FMath::Square((Ring - 1) * (double)CellSize) > BestDistSq)
+            break;
+
+        for (int32 DY = -Ring; DY <= Ring; DY++)
+        {
+            const bool bEdgeRow = FMath::Abs(DY) == Ring;
+            for (int32 DX = -Ring; DX <= Ring; DX += (bEdgeRow || Ring == 0) ? 1 : 2 * Ring)
+            {
+                const FIntPoint Cell(Center.X + DX, Center.Y + DY);
+                if (!IsCellWalkable(Cell, Origin.Z, MinClearanceCm))
+                    continue;
+
+                const FVector CellCenter((Cell.X + 0.5) * CellSize, (Cell.Y + 0.5) * CellSize, Origin.Z);
+                const double DistSq = FVector::DistSquaredXY(Origin, CellCenter);
+                if (DistSq <= FMath::Square((double)SearchRadius) && DistSq < BestDistSq)
+                {
+                    BestDistSq = DistSq;
+                    OutLocation = CellCenter;
+                    bFound = true;
+                }
+            }
+        }
+    }
+
+    return bFound;
+}
+
+const UWalkabilityCacheSubsystem::FTile& UWalkabilityCacheSubsystem::GetOrBuildTile(const FIntPoint& TileCoord, float HeightHint)
+{
+    if (const FTile* Existing = Tiles.Find(TileCoord))
+        return *Existing;
+
+    FTile& Tile = Tiles.Add(TileCoord);
+    if (!DecodeBakedTile(TileCoord, Tile))
+    {
+        BuildRuntimeTile(TileCoord, HeightHint, Tile);
+    }
+    return Tile;
+}
+
+int32 UWalkabilityCacheSubsystem::GetClearanceHaloCells() const
+{
+    return FMath::Min<int32>(MAX_uint8, FMath::CeilToInt(FMath::Max(0.f, GWalkabilityMaxClearance) / CellSize) + 1);
+}
+
+void UWalkabilityCacheSubsystem::BuildRuntimeTile(const FIntPoint& TileCoord, float HeightHint, FTile& OutTile) const
+{
+    // Chamfer بیرون Bitmap را قابل عبور می‌گیرد؛ با حاشیه همسایه‌ها سلول‌های مرز تایل Clearance بیش از واقع نمی‌گیرند
+    // مانعی که تا فاصله حاشیه باشد داخل پنجره است، پس Clearance تا همان مقدار دقیق است و بیشتر از آن ذخیره نمی‌شود
+    const int32 ClearanceHaloCells = GetClearanceHaloCells();
+    const int32 WindowSize = TileSizeCells + 2 * ClearanceHaloCells;
+    const FIntPoint WindowMinCell(TileCoord.X * TileSizeCells - ClearanceHaloCells, TileCoord.Y * TileSizeCells - ClearanceHaloCells);
+
+    TBitArray<> WindowWalkable;
+    BuildWalkability(WindowMinCell, WindowSize, WindowSize, HeightHint, WindowWalkable);
+
+    TArray<uint8> WindowClearance;
+    ComputeClearance(WindowWalkable, WindowSize, WindowSize, WindowClearance);
+
+    OutTile.Walkable.Init(false, TileSizeCells * TileSizeCells);
+    OutTile.Clearance.SetNumUninitialized(TileSizeCells * TileSizeCells);
+    for (int32 y = 0; y < TileSizeCells; y++)
+    {
+        const int32 WindowY = y + ClearanceHaloCells;
+        for (int32 x = 0; x < TileSizeCells; x++)
+        {
+            const int32 WindowX = x + ClearanceHaloCells;
+            const int32 WindowIndex = WindowY * WindowSize + WindowX;
+
+            OutTile.Walkable[y * TileSizeCells + x] = WindowWalkable[WindowIndex];
+            OutTile.Clearance[y * TileSizeCells + x] = (uint8)FMath::Min<int32>(WindowClearance[WindowIndex], ClearanceHaloCells);
+        }
+    }
+}
+
+bool UWalkabilityCacheSubsystem::IsBakedDataCompatible() const
+{
+    return BakedData
+        && BakedData->TileSizeCells == TileSizeCells
+        && FMath::IsNearlyEqual(BakedData->CellSize, CellSize)
+        && FMath::IsNearlyEqual(BakedData->ObstacleInflation, GWalkabilityInflation);
+}
+
+bool UWalkabilityCacheSubsystem::DecodeBakedTile(const FIntPoint& TileCoord, FTile& OutTile) const
+{
+    if (!IsBakedDataCompatible() || StaleBakedTiles.Contains(TileCoord))
+        return false;
+
+    const FWalkabilityBakedTile* BakedTile = BakedData->FindTile(TileCoord);
+    return BakedTile && UWalkabilityBakeAsset::DecodeTile(*BakedTile, TileSizeCells * TileSizeCells, OutTile.Walkable, OutTile.Clearance);
+}
+
+void UWalkabilityCacheSubsystem::BuildTile(const FIntPoint& TileCoord, float HeightHint, FTile& OutTile) const
+{
+    BuildWalkability(FIntPoint(TileCoord.X * TileSizeCells, TileCoord.Y * TileSizeCells), TileSizeCells, TileSizeCells, HeightHint, OutTile.Walkable);
+}
+
+void UWalkabilityCacheSubsystem::BuildWalkability(const FIntPoint& MinCell, int32 Width, int32 Height, float HeightHint, TBitArray<>& OutWalkable) const
+{
+    const FVector2D Origin(MinCell.X * CellSize, MinCell.Y * CellSize);
+
+    const FBox Bounds(
+        FVector(Origin.X, Origin.Y, HeightHint - WalkabilityCache::TileHeightCm),
+        FVector(Origin.X + Width * CellSize, Origin.Y + Height * CellSize, HeightHint + WalkabilityCache::TileHeightCm));
+
+    // یک Query پلی و یک Overlap برای کل پنجره (فقط لایه‌های ثابت، بدون یونیت‌ها)، بعد Rasterize بدون World
+    FWalkabilityGeometry Geometry;
+    if (UGridPathfinderComponent::GatherWorldWalkabilityGeometry(GetWorld(), Bounds, GWalkabilityInflation, EWalkabilityLayers::Static, nullptr, Geometry))
+    {
+        UGridPathfinderComponent::RasterizeWalkability(Geometry, Origin, CellSize, Width, Height, OutWalkable);
+        return;
+    }
+
+    // fallback: NavMesh از نوع Recast نیست → تست سلول به سلول (فقط یک بار برای هر تایل)
+    OutWalkable.Init(false, Width * Height);
+    for (int32 y = 0; y < Height; y++)
+    {
+        for (int32 x = 0; x < Width; x++)
+        {
+            const FVector CellCenter(Origin.X + (x + 0.5f) * CellSize, Origin.Y + (y + 0.5f) * CellSize, HeightHint);
+            OutWalkable[y * Width + x] = UGridPathfinderComponent::IsLocationStaticallyWalkable(GetWorld(), CellCenter, GWalkabilityInflation);
+        }
+    }
+}
+
+void UWalkabilityCacheSubsystem::ComputeClearance(const TBitArray<>& Walkable, int32 Width, int32 Height, TArray<uint8>& OutClearance)
+{
+    using namespace WalkabilityCache;
+
+    const int32 NumCells = Width * Height;
+    const int32 FarDistance = MAX_uint8 * StraightStep;
+
+    TArray<int32> Distance;
+    Distance.SetNumUninitialized(NumCells);
+    for (int32 Index = 0; Index < NumCells; Index++)
+    {
+        Distance[Index] = Walkable[Index] ? FarDistance : 0;
+    }
+
+    // پاس رفت: همسایه‌های چپ و ردیف بالا
+    for (int32 y = 0; y < Height; y++)
+    {
+        for (int32 x = 0; x < Width; x++)
+        {
+            const int32 Index = y * Width + x;
+            int32 Best = Distance[Index];
+            if (Best == 0) continue;
+
+            if (x > 0) Best = FMath::Min(Best, Distance[Index - 1] + StraightStep);
+            if (y > 0)
+            {
+                Best = FMath::Min(Best, Distance[Index - Width] + StraightStep);
+                if (x > 0) Best = FMath::Min(Best, Distance[Index - Width - 1] + DiagonalStep);
+                if (x < Width - 1) Best = FMath::Min(Best, Distance[Index - Width + 1] + DiagonalStep);
+            }
+            Distance[Index] = Best;
+        }
+    }
+
+    // پاس برگشت: همسایه‌های راست و ردیف پایین
+    for (int32 y = Height - 1; y >= 0; y--)
+    {
+        for (int32 x = Width - 1; x >= 0; x--)
+        {
+            const int32 Index = y * Width + x;
+            int32 Best = Distance[Index];
+            if (Best == 0) continue;
+
+            if (x < Width - 1) Best = FMath::Min(Best, Distance[Index + 1] + StraightStep);
+            if (y < Height - 1)
+            {
+                Best = FMath::Min(Best, Distance[Index + Width] + StraightStep);
+                if (x < Width - 1) Best = FMath::Min(Best, Distance[Index + Width + 1] + DiagonalStep);
+                if (x > 0) Best = FMath::Min(Best, Distance[Index + Width - 1] + DiagonalStep);
+            }
+            Distance[Index] = Best;
+        }
+    }
+
+    OutClearance.SetNumUninitialized(NumCells);
+    for (int32 Index = 0; Index < NumCells; Index++)
+    {
+        OutClearance[Index] = (uint8)FMath::Min<int32>(MAX_uint8, FMath::DivideAndRoundNearest(Distance[Index], StraightStep));
+    }
+}
+
+void UWalkabilityCacheSubsystem::SetBakedData(UWalkabilityBakeAsset* InBakedData)
+{
+    BakedData = InBakedData;
+    StaleBakedTiles.Reset();
+
+    // تایل‌هایی که قبلاً از World ساخته شده‌اند با همان داده جایگزین می‌شوند
+    InvalidateAll();
+
+    if (BakedData)
+    {
+        SyncCellSize();
+        if (!IsBakedDataCompatible())
+        {
+            UE_LOG(LogTemp, Warning, TEXT("WalkabilityCache: Baked data %s was built with CellSize %.1f / Inflation %.1f (current %.1f / %.1f). Tiles will be built at runtime; re-bake the level."),
+                *BakedData->GetName(), BakedData->CellSize, BakedData->ObstacleInflation, CellSize, GWalkabilityInflation);
+        }
+    }
+}
+
+bool UWalkabilityCacheSubsystem::BakeRegion(const FBox& Bounds, UWalkabilityBakeAsset& OutAsset)
+{
+    if (!Bounds.IsValid || !GetWorld())
+        return false;
+
+    SyncCellSize();
+
+    const FIntPoint MinTile = CellToTile(WorldToCell(Bounds.Min));
+    const FIntPoint MaxTile = CellToTile(WorldToCell(Bounds.Max));
+    const int32 TilesX = MaxTile.X - MinTile.X + 1;
+    const int32 TilesY = MaxTile.Y - MinTile.Y + 1;
+    const int32 GridWidth = TilesX * TileSizeCells;
+    const int32 GridHeight = TilesY * TileSizeCells;
+
+    if ((int64)GridWidth * GridHeight > WalkabilityCache::MaxBakeCells)
+    {
+        UE_LOG(LogTemp, Error, TEXT("WalkabilityCache: Bake region %dx%d cells is too large; increase ai.Walkability.CellSize or split the volume."), GridWidth, GridHeight);
+        return false;
+    }
+
+    // ۱) Walkability همه تایل‌ها در یک Bitmap پیوسته (تا Clearance از مرز تایل‌ها عبور کند)
+    TBitArray<> GridWalkable(false, GridWidth * GridHeight);
+    const float HeightHint = Bounds.GetCenter().Z;
+
+    FTile BuiltTile;
+    for (int32 TileY = 0; TileY < TilesY; TileY++)
+    {
+        for (int32 TileX = 0; TileX < TilesX; TileX++)
+        {
+            BuildTile(FIntPoint(MinTile.X + TileX, MinTile.Y + TileY), HeightHint, BuiltTile);
+            for (int32 y = 0; y < TileSizeCells; y++)
+            {
+                const int32 RowStart = (TileY * TileSizeCells + y) * GridWidth + TileX * TileSizeCells;
+                for (int32 x = 0; x < TileSizeCells; x++)
+                {
+                    GridWalkable[RowStart + x] = BuiltTile.Walkable[y * TileSizeCells + x];
+                }
+            }
+        }
+    }
+
+    // ۲) Clearance روی کل محدوده
+    TArray<uint8> GridClearance;
+    ComputeClearance(GridWalkable, GridWidth, GridHeight, GridClearance);
+
+    // ۳) فشرده‌سازی تایل به تایل
+    TArray<FWalkabilityBakedTile> BakedTiles;
+    BakedTiles.Reserve(TilesX * TilesY);
+
+    TBitArray<> TileWalkable(false, TileSizeCells * TileSizeCells);
+    TArray<uint8> TileClearance;
+    TileClearance.SetNumUninitialized(TileSizeCells * TileSizeCells);
+
+    for (int32 TileY = 0; TileY < TilesY; TileY++)
+    {
+        for (int32 TileX = 0; TileX < TilesX; TileX++)
+        {
+            for (int32 y = 0; y < TileSizeCells; y++)
+            {
+                const int32 RowStart = (TileY * TileSizeCells + y) * GridWidth + TileX * TileSizeCells;
+                for (int32 x = 0; x < TileSizeCells; x++)
+                {
+                    TileWalkable[y * TileSizeCells + x] = GridWalkable[RowStart + x];
+                    TileClearance[y * TileSizeCells + x] = GridClearance[RowStart + x];
+                }
+            }
+
+            UWalkabilityBakeAsset::EncodeTile(FIntPoint(MinTile.X + TileX, MinTile.Y + TileY), TileWalkable, TileClearance, BakedTiles.AddDefaulted_GetRef());
+        }
+    }
+
+    OutAsset.SetBakedTiles(CellSize, GWalkabilityInflation, TileSizeCells, Bounds, MoveTemp(BakedTiles));
+
+    UE_LOG(LogTemp, Log, TEXT("WalkabilityCache: Baked %d tiles (%dx%d cells) into %s, %d bytes."),
+        TilesX * TilesY, GridWidth, GridHeight, *OutAsset.GetName(), OutAsset.GetEncodedSize());
+
+    return true;
+}
+
+void UWalkabilityCacheSubsystem::PrepareSearchWindow(const FIntPoint& MinTile, const FIntPoint& MaxTile, float MinClearanceCm, float HeightHint)
+{
+    if (SearchVersion == Version && SearchMinTile == MinTile && SearchMaxTile == MaxTile && SearchClearanceCm == MinClearanceCm)
+        return;
+
+    const int32 TilesX = MaxTile.X - MinTile.X + 1;
+    const int32 TilesY = MaxTile.Y - MinTile.Y + 1;
+    const int32 Width = TilesX * TileSizeCells;
+    const int32 Height = TilesY * TileSizeCells;
+
+    SearchWalkable.Init(false, Width * Height);
+    for (int32 TileY = 0; TileY < TilesY; TileY++)
+    {
+        for (int32 TileX = 0; TileX < TilesX; TileX++)
+        {
+            const FTile& Tile = GetOrBuildTile(FIntPoint(MinTile.X + TileX, MinTile.Y + TileY), HeightHint);
+            for (int32 y = 0; y < TileSizeCells; y++)
+            {
+                const int32 RowStart = (TileY * TileSizeCells + y) * Width + TileX * TileSizeCells;
+                for (int32 x = 0; x < TileSizeCells; x++)
+                {
+                    const int32 Index = y * TileSizeCells + x;
+                    SearchWalkable[RowStart + x] = Tile.Walkable[Index]
+                        && (MinClearanceCm <= 0.f || WalkabilityCache::ClearanceToCm(Tile.Clearance[Index], CellSize) >= MinClearanceCm);
+                }
+            }
+        }
+    }
+
+    // پنجره جدید → جدول JPS+ قبلی هم باطل است
+    GridSearch.SetGrid(&SearchWalkable, Width, Height);
+
+    SearchMinTile = MinTile;
+    SearchMaxTile = MaxTile;
+    SearchClearanceCm = MinClearanceCm;
+    SearchVersion = Version;
+}
+
+bool UWalkabilityCacheSubsystem::FindGridPath(const FVector& Start, const FVector& Goal, float MinClearanceCm, bool bUseJumpTable, TArray<FVector>& OutPath)
+{
+    OutPath.Reset();
+    SyncCellSize();
+
+    const FIntPoint StartCell = WorldToCell(Start);
+    const FIntPoint GoalCell = WorldToCell(Goal);
+
+    // پنجره هم‌تراز با تایل‌ها → درخواست‌های نزدیک به هم (مثلاً یک گروه) همان پنجره و جدول را دوباره استفاده می‌کنند
+    const int32 Margin = FMath::Max(GGridPathWindowMargin, 0);
+    const FIntPoint MinTile = CellToTile(FIntPoint(FMath::Min(StartCell.X, GoalCell.X) - Margin, FMath::Min(StartCell.Y, GoalCell.Y) - Margin));
+    const FIntPoint MaxTile = CellToTile(FIntPoint(FMath::Max(StartCell.X, GoalCell.X) + Margin, FMath::Max(StartCell.Y, GoalCell.Y) + Margin));
+    if (MaxTile.X - MinTile.X + 1 > GGridPathMaxWindowTiles || MaxTile.Y - MinTile.Y + 1 > GGridPathMaxWindowTiles)
+        return false;
+
+    PrepareSearchWindow(MinTile, MaxTile, FMath::Max(MinClearanceCm, 0.f), (Start.Z + Goal.Z) * 0.5f);
+    if (bUseJumpTable && !GridSearch.HasJumpTable())
+    {
+        GridSearch.BuildJumpTable();
+    }
+
+    const FIntPoint WindowOrigin(MinTile.X * TileSizeCells, MinTile.Y * TileSizeCells);
+    const FIntPoint GoalLocal = GoalCell - WindowOrigin;
+
+    const FIntPoint StartLocal = FindSearchStartCell(StartCell - WindowOrigin);
+
+    TArray<FIntPoint> JumpPoints;
+    if (!GridSearch.FindPath(StartLocal, GoalLocal, JumpPoints, bUseJumpTable))
+        return false;
+
+    JumpPointsToWorld(JumpPoints, WindowOrigin, Start, Goal, OutPath);
+    return true;
+}
+
+bool UWalkabilityCacheSubsystem::FindGridPathsToGoal(const FVector& Goal, TConstArrayView<FVector> Starts, float MinClearanceCm, TArray<TArray<FVector>>& OutPaths)
+{
+    OutPaths.Reset();
+    OutPaths.SetNum(Starts.Num());
+    if (Starts.Num() == 0)
+        return false;
+
+    SyncCellSize();
+
+    // پنجره باید مقصد و همه شروع‌ها را با هم بپوشاند
+    const FIntPoint GoalCell = WorldToCell(Goal);
+    FIntPoint MinCell = GoalCell;
+    FIntPoint MaxCell = GoalCell;
+    double HeightSum = Goal.Z;
+
+    TArray<FIntPoint, TInlineAllocator<16>> StartCells;
+    StartCells.Reserve(Starts.Num());
+    for (const FVector& Start : Starts)
+    {
+        const FIntPoint& Cell = StartCells.Add_GetRef(WorldToCell(Start));
+        MinCell = FIntPoint(FMath::Min(MinCell.X, Cell.X), FMath::Min(MinCell.Y, Cell.Y));
+        MaxCell = FIntPoint(FMath::Max(MaxCell.X, Cell.X), FMath::Max(MaxCell.Y, Cell.Y));
+        HeightSum += Start.Z;
+    }
+
+    const int32 Margin = FMath::Max(GGridPathWindowMargin, 0);
+    const FIntPoint MinTile = CellToTile(MinCell - FIntPoint(Margin, Margin));
+    const FIntPoint MaxTile = CellToTile(MaxCell + FIntPoint(Margin, Margin));
+    if (MaxTile.X - MinTile.X + 1 > GGridPathMaxWindowTiles || MaxTile.Y - MinTile.Y + 1 > GGridPathMaxWindowTiles)
+        return false;
+
+    PrepareSearchWindow(MinTile, MaxTile, FMath::Max(MinClearanceCm, 0.f), HeightSum / (Starts.Num() + 1));
+
+    const FIntPoint WindowOrigin(MinTile.X * TileSizeCells, MinTile.Y * TileSizeCells);
+    for (FIntPoint& Cell : StartCells)
+    {
+        Cell = FindSearchStartCell(Cell - WindowOrigin);
+    }
+
+    // یک Dijkstra معکوس از مقصد؛ مسیر هر شروع از Map والدها به ترتیب شروع → مقصد بیرون می‌آید
+    TArray<TArray<FIntPoint>> JumpPaths;
+    if (!GridSearch.FindPathsToSource(GoalCell - WindowOrigin, StartCells, JumpPaths))
+        return false;
+
+    for (int32 Index = 0; Index < Starts.Num(); Index++)
+    {
+        if (JumpPaths[Index].Num() > 0)
+        {
+            JumpPointsToWorld(JumpPaths[Index], WindowOrigin, Starts[Index], Goal, OutPaths[Index]);
+        }
+    }
+
+    return true;
+}
+
+FIntPoint UWalkabilityCacheSubsystem::FindSearchStartCell(const FIntPoint& LocalCell) const
+{
+    if (GridSearch.IsWalkable(LocalCell.X, LocalCell.Y))
+        return LocalCell;
+
+    // یونیت ممکن است کمی داخل حاشیه Inflation مانع ایستاده باشد → نزدیک‌ترین سلول باز چند سلول اطراف
+    constexpr int32 MaxStartRing = 3;
+    for (int32 Ring = 1; Ring <= MaxStartRing; Ring++)
+    {
+        for (int32 DY = -Ring; DY <= Ring; DY++)
+        {
+            for (int32 DX = -Ring; DX <= Ring; DX++)
+            {
+                if ((FMath::Abs(DX) == Ring || FMath::Abs(DY) == Ring) && GridSearch.IsWalkable(LocalCell.X + DX, LocalCell.Y + DY))
+                    return LocalCell + FIntPoint(DX, DY);
+            }
+        }
+    }
+    return LocalCell;
+}
+
+void UWalkabilityCacheSubsystem::JumpPointsToWorld(TConstArrayView<FIntPoint> JumpPoints, const FIntPoint& WindowOrigin, const FVector& Start, const FVector& Goal, TArray<FVector>& OutPath) const
+{
+    OutPath.Reset(FMath::Max(JumpPoints.Num(), 2));
+
+    // مرکز سلول‌ها؛ Z به نسبت طول طی‌شده بین شروع و مقصد
+    for (const FIntPoint& Point : JumpPoints)
+    {
+        const FIntPoint Cell = Point + WindowOrigin;
+        OutPath.Add(FVector((Cell.X + 0.5) * CellSize, (Cell.Y + 0.5) * CellSize, Start.Z));
+    }
+
+    // شروع و مقصد در یک سلول
+    if (OutPath.Num() == 1)
+    {
+        OutPath.Add(OutPath[0]);
+    }
+    OutPath[0] = Start;
+    OutPath.Last() = Goal;
+
+    double TotalLength = 0.0;
+    for (int32 i = 1; i < OutPath.Num(); i++)
+    {
+        TotalLength += FVector::DistXY(OutPath[i - 1], OutPath[i]);
+    }
+
+    double Travelled = 0.0;
+    for (int32 i = 1; i < OutPath.Num() - 1; i++)
+    {
+        Travelled += FVector::DistXY(OutPath[i - 1], OutPath[i]);
+        OutPath[i].Z = FMath::Lerp(Start.Z, Goal.Z, TotalLength > 0.0 ? Travelled / TotalLength : 0.0);
+    }
+}
+
+void UWalkabilityCacheSubsystem::InvalidateBounds(const FBox& Bounds)
+{
+    Version++;
+
+    // Clearance تایل‌های همسایه تا شعاع حاشیه هم از این ناحیه اثر می‌گیرد
+    const float ClearanceHaloCm = GetClearanceHaloCells() * CellSize;
+    const FBox ClearanceBounds = Bounds.ExpandBy(FVector(ClearanceHaloCm, ClearanceHaloCm, 0.f));
+    const FIntPoint MinTile = CellToTile(WorldToCell(ClearanceBounds.Min));
+    const FIntPoint MaxTile = CellToTile(WorldToCell(ClearanceBounds.Max));
+
+    // داده Bake شده این ناحیه دیگر با World یکی نیست (فقط اشتراک با محدوده Bake پیمایش می‌شود)
+    if (IsBakedDataCompatible())
+    {
+        const FIntPoint BakedMinTile = CellToTile(WorldToCell(BakedData->BakedBounds.Min));
+        const FIntPoint BakedMaxTile = CellToTile(WorldToCell(BakedData->BakedBounds.Max));
+        for (int32 Y = FMath::Max(MinTile.Y, BakedMinTile.Y); Y <= FMath::Min(MaxTile.Y, BakedMaxTile.Y); Y++)
+        {
+            for (int32 X = FMath::Max(MinTile.X, BakedMinTile.X); X <= FMath::Min(MaxTile.X, BakedMaxTile.X); X++)
+            {
+                if (BakedData->FindTile(FIntPoint(X, Y)))
+                {
+                    StaleBakedTiles.Add(FIntPoint(X, Y));
+                }
+            }
+        }
+    }
+
+    for (auto It = Tiles.CreateIterator(); It; ++It)
+    {
+        const FIntPoint& TileCoord = It.Key();
+        if (TileCoord.X >= MinTile.X && TileCoord.X <= MaxTile.X && TileCoord.Y >= MinTile.Y && TileCoord.Y <= MaxTile.Y)
+        {
+            It.RemoveCurrent();
+        }
+    }
+}
+
+void UWalkabilityCacheSubsystem::InvalidateAll()
+{
+    Version++;
+    Tiles.Empty();
+    TilesPendingNavRebuild.Empty();
+}
+
+void UWalkabilityCacheSubsystem::OnNavigationDirtied(const FBox& DirtyBounds)
+{
+    InvalidateBounds(DirtyBounds);
+
+    // تایل‌های NavMesh همین ناحیه هنوز در حال ساخت‌اند → بعد از پایان ساخت دوباره دور ریخته می‌شوند
+    const FIntPoint MinTile = CellToTile(WorldToCell(DirtyBounds.Min));
+    const FIntPoint MaxTile = CellToTile(WorldToCell(DirtyBounds.Max));
+    for (int32 Y = MinTile.Y; Y <= MaxTile.Y; Y++)
+    {
+        for (int32 X = MinTile.X; X <= MaxTile.X; X++)
+        {
+            TilesPendingNavRebuild.Add(FIntPoint(X, Y));
+        }
+    }
+}
+
+void UWalkabilityCacheSubsystem::OnNavigationGenerationFinished(ANavigationData* NavData)
+{
+    for (const FIntPoint& TileCoord : TilesPendingNavRebuild)
+    {
+        Tiles.Remove(TileCoord);
+    }
+    TilesPendingNavRebuild.Reset();
+    Version++;
+}
+
+void UWalkabilityCacheSubsystem::InvalidateObstacleBounds(const TArray<FBox>& DirtyBounds)
+{
+    for (const FBox& Bounds : DirtyBounds)
+    {
+        // موانع به اندازه Inflation بزرگ‌تر Rasterize می‌شوند
+        InvalidateBounds(Bounds.ExpandBy(GWalkabilityInflation));
+    }
+}
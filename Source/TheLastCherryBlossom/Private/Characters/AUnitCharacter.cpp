@@ -2,6 +2,7 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Animation/AnimInstance.h"
 #include "AI/UFlowFieldComponent.h"
+#include "AI/UFlowFieldCacheSubsystem.h"
 #include "Core/ARTSPlayerController.h"
 #include "NavigationSystem.h"
 #include "NavAreas/NavArea_Null.h"
@@ -170,12 +171,12 @@ void AUnitCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCompo
     Super::SetupPlayerInputComponent(PlayerInputComponent);
 }
 
-void AUnitCharacter::SetPathAndMove(const TArray<FVector>& Path, bool bIsSingleUnit)
+void AUnitCharacter::SetPathAndMove(const FGridPathHandle& Path, bool bIsSingleUnit)
 {
     if (CurrentState == EUnitState::Dead || CurrentState == EUnitState::Stunned)
         return;
 
-    if (Path.Num() == 0)
+    if (!Path.IsValid())
         return;
 
     CurrentPath = Path;
@@ -189,8 +190,9 @@ void AUnitCharacter::SetPathAndMove(const TArray<FVector>& Path, bool bIsSingleU
     }
     else
     {
+        // فیلد فقط یک بار برای کل خوشه ساخته می‌شود (UUnitFormationManager → ClusterFlowField)؛
+        // ساخت فیلد جدا برای هر یونیت هرگز خوانده نمی‌شد
         bUseFlowField = true;
-        SetFlowFieldDestination(CurrentPath[0], CurrentPath);
         SetUnitState(EUnitState::Moving_Cluster);
     }
 }
@@ -199,6 +201,13 @@ void AUnitCharacter::SetUnitState(EUnitState NewState)
 {
     if (CurrentState == NewState) return;
 
+    // خروج از حرکت خوشه‌ای → جدا شدن از فیلد، وگرنه فیلد برای یونیت بیکار هم Tick و نمونه‌برداری می‌کند
+    if (CurrentState == EUnitState::Moving_Cluster)
+    {
+        AttachToClusterFlowField(nullptr);
+        PendingClusterFlowField = nullptr;
+    }
+
     CurrentState = NewState;
 
     switch (CurrentState)
@@ -240,16 +249,44 @@ void AUnitCharacter::SetFlowFieldDestination(const FVector& Destination, const T
 {
     if (FlowFieldComponent)
     {
-        FlowFieldComponent->GenerateFlowField(Destination, Path, CorridorWidth);
+        FlowFieldComponent->GenerateFlowFieldAsync(Destination, Path, CorridorWidth);
     }
 }
 
 void AUnitCharacter::SetClusterFlowField(UFlowFieldComponent* NewFlow)
 {
-    if (NewFlow && ClusterFlowField != NewFlow)
+    if (!NewFlow || ClusterFlowField == NewFlow)
+        return;
+
+    // اگر فیلد جدید هنوز ساخته نشده و یونیت در حال دنبال کردن فیلد قبلی است، تا آماده شدن همان را ادامه می‌دهد
+    if (!NewFlow->HasField() && CurrentState == EUnitState::Moving_Cluster && ClusterFlowField && ClusterFlowField->HasField())
     {
-        ClusterFlowField = NewFlow;
-        UE_LOG(LogTemp, Warning, TEXT("[%s] FlowField assigned!"), *GetName());
+        PendingClusterFlowField = NewFlow;
+        UE_LOG(LogTemp, Warning, TEXT("[%s] FlowField pending, keeping previous field."), *GetName());
+        return;
+    }
+
+    AttachToClusterFlowField(NewFlow);
+    PendingClusterFlowField = nullptr;
+    UE_LOG(LogTemp, Warning, TEXT("[%s] FlowField assigned!"), *GetName());
+}
+
+void AUnitCharacter::AttachToClusterFlowField(UFlowFieldComponent* NewFlow)
+{
+    if (ClusterFlowField)
+    {
+        ClusterFlowField->RemoveFollower(ClusterFlowFieldSlot);
+        PrimaryActorTick.RemovePrerequisite(ClusterFlowField, ClusterFlowField->PrimaryComponentTick);
+    }
+
+    ClusterFlowField = NewFlow;
+    ClusterFlowFieldSlot = INDEX_NONE;
+
+    // فیلد باید قبل از یونیت Tick کند تا جهت همین فریم آماده باشد
+    if (ClusterFlowField)
+    {
+        ClusterFlowFieldSlot = ClusterFlowField->AddFollower(this);
+        PrimaryActorTick.AddPrerequisite(ClusterFlowField, ClusterFlowField->PrimaryComponentTick);
     }
 }
 
@@ -345,26 +382,44 @@ void AUnitCharacter::Tick(float DeltaTime)
     // ============================================================
     case EUnitState::Moving_Cluster:
             {
+                // فیلد سفارش جدید به محض کامل شدن جایگزین فیلد قبلی می‌شود
+                if (PendingClusterFlowField && PendingClusterFlowField->HasField())
+                {
+                    AttachToClusterFlowField(PendingClusterFlowField);
+                    PendingClusterFlowField = nullptr;
+                }
+
                 if (!ClusterFlowField)
                     break;
 
                 FVector MyLoc = GetActorLocation();
-                FIntPoint Cell = ClusterFlowField->WorldToGrid(MyLoc);
 
-                // <<< تغییر اصلی: دیگر اشاره‌گر نیست، کپی از سلول رو می‌گیریم >>>
-                FFlowFieldCell FlowCell = ClusterFlowField->GetCell(Cell);
+                // جهت این فریم را فیلد در Tick خودش برای همه یونیت‌های خوشه یکجا نمونه گرفته (درون‌یابی دوخطی)
+                // یونیت تازه اضافه شده که هنوز نمونه ندارد، خودش یک بار نمونه می‌گیرد
+                FVector Dir;
+                bool bInCorridor = false;
+                if (!ClusterFlowField->GetFollowerDirection(ClusterFlowFieldSlot, Dir, bInCorridor))
+                {
+                    bInCorridor = ClusterFlowField->SampleDirection(MyLoc, Dir);
+                }
 
-                // حالا چک می‌کنیم که آیا سلول معتبر و داخل کریدور هست یا نه
-                if (!FlowCell.bInCorridor)
-                    break;
+                const bool bFieldReady = ClusterFlowField->HasField() && !PendingClusterFlowField;
+                if (!bInCorridor)
+                {
+                    if (bFieldReady)
+                        break; // سلول خارج از کریدور
 
-                // اولویت با Direction نهایی (که ترکیب Path + Repulsion + Smoothing هست)
-                FVector Dir = FlowCell.Direction;
+                    // FlowField هنوز در حال ساخت است → مسیر را مستقیم (نقطه به نقطه) دنبال کن
+                    const float WaypointAcceptanceRadius = 100.f;
+                    while (CurrentPathIndex < CurrentPath.Num() - 1 &&
+                        FVector::Dist2D(MyLoc, CurrentPath[CurrentPathIndex]) <= WaypointAcceptanceRadius)
+                    {
+                        CurrentPathIndex++;
+                    }
 
-                // اگر Direction صفر بود (مثلاً در نزدیکی مقصد)، از PathVector استفاده کن
-                if (Dir.IsNearlyZero())
-                {
-                    Dir = FlowCell.PathVector;
+                    Dir = CurrentPath.IsValidIndex(CurrentPathIndex)
+                        ? (CurrentPath[CurrentPathIndex] - MyLoc).GetSafeNormal2D()
+                        : FVector::ZeroVector;
                 }
 
                 // اگر هنوز هم صفر بود، حرکت نکن (جلوگیری از لرزش)
@@ -414,6 +469,12 @@ void AUnitCharacter::Tick(float DeltaTime)
 
                     SetUnitState(EUnitState::Idle);
 
+                    // یونیت پارک‌شده برای FlowFieldهای دیگر مانع است → فقط سکتورهای اطرافش تعمیر می‌شوند
+                    if (UFlowFieldCacheSubsystem* FlowFieldCache = GetWorld()->GetSubsystem<UFlowFieldCacheSubsystem>())
+                    {
+                        FlowFieldCache->NotifyUnitObstaclesChanged(GetCapsuleComponent()->Bounds.GetBox());
+                    }
+
                     UE_LOG(LogTemp, Log, TEXT("[%s] Final stop at formation slot. Dist: %.1f | Speed: %.1f"), *GetName(), Dist, CurrentSpeed);
                 }
                 else
@@ -440,9 +501,9 @@ void AUnitCharacter::Tick(float DeltaTime)
     }
 }
 
-void AUnitCharacter::FollowPathDirectly(const TArray<FVector>& PathPoints)
+void AUnitCharacter::FollowPathDirectly(const FGridPathHandle& PathPoints)
 {
-    if (PathPoints.Num() == 0) return;
+    if (!PathPoints.IsValid()) return;
 
     CurrentPath = PathPoints;  // ← همان CurrentPath موجود در کلاس
     CurrentPathIndex = 0;
@@ -453,7 +514,8 @@ void AUnitCharacter::FollowPathDirectly(const TArray<FVector>& PathPoints)
 
 void AUnitCharacter::MoveDirectlyToTarget(const FVector& Target)
 {
-    CurrentPath = { Target };
+    // MovingToFormation از مسیر استفاده نمی‌کند
+    CurrentPath.Reset();
     CurrentPathIndex = 0;
 
     bUseFlowField = false;
@@ -3,6 +3,7 @@
 
 #include "Core/ARTSPlayerController.h"
 #include "AI/UUnitFormationManager.h"
+#include "AI/UGridPathRequestSubsystem.h"
 #include "Characters/AUnitCharacter.h"
 #include "Interfaces/Selectable.h"
 #include "DrawDebugHelpers.h"
@@ -241,14 +242,36 @@ void ARTSPlayerController::OnRightClick()
 void ARTSPlayerController::MoveSelectedUnitsToLocation(const FVector& TargetLocation)
 {
     UE_LOG(LogTemp, Warning, TEXT("MoveSelectedUnitsToLocation called to %s"), *TargetLocation.ToString());
+
+    // درخواست‌های سفارش قبلی که هنوز نرسیده‌اند لغو می‌شوند
+    if (UGridPathRequestSubsystem* Requests = GetWorld()->GetSubsystem<UGridPathRequestSubsystem>())
+    {
+        for (uint32 RequestId : PendingMoveRequests)
+        {
+            Requests->CancelRequest(RequestId);
+        }
+    }
+    PendingMoveRequests.Reset();
+
+    // مسیر هر یونیت در صف Async ساخته می‌شود و یونیت به محض رسیدن مسیرش حرکت می‌کند
     for (AUnitCharacter* Unit : SelectedUnits)
     {
-        if (Unit)
+        if (Unit && Unit->GridPathfinder)
         {
-            TArray<FVector> Path = Unit->GridPathfinder->FindPathShared(Unit->GetActorLocation(), TargetLocation);
-            if (Path.Num() > 0)
+            const uint32 RequestId = Unit->GridPathfinder->FindPathAsync(
+                Unit->GetActorLocation(),
+                TargetLocation,
+                FOnGridPathComplete::CreateWeakLambda(Unit, [Unit](const TArray<FVector>& Path)
+                {
+                    if (Path.Num() > 0)
+                    {
+                        Unit->SetPathAndMove(Path);
+                    }
+                }));
+
+            if (RequestId != 0)
             {
-                Unit->SetPathAndMove(Path);
+                PendingMoveRequests.Add(RequestId);
             }
         }
     }
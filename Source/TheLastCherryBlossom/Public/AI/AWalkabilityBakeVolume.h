@@ -0,0 +1,37 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "AWalkabilityBakeVolume.generated.h"
+
+class UBoxComponent;
+class UWalkabilityBakeAsset;
+
+/**
+ * محدوده Bake مربوط به Walkability و Clearance ثابت لول.
+ * در ادیتور با دکمه BakeWalkability داده داخل BakedData نوشته می‌شود؛ در BeginPlay همان داده به UWalkabilityCacheSubsystem داده می‌شود
+ * تا اولین دستور حرکت در نواحی دست‌نخورده هزینه ساخت تایل نداشته باشد.
+ */
+UCLASS()
+class THELASTCHERRYBLOSSOM_API AWalkabilityBakeVolume : public AActor
+{
+    GENERATED_BODY()
+
+public:
+    AWalkabilityBakeVolume();
+
+    // بعد از هر تغییر NavMesh یا موانع ثابت لول دوباره اجرا شود
+    UFUNCTION(CallInEditor, Category = "Walkability")
+    void BakeWalkability();
+
+protected:
+    virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+    UPROPERTY(VisibleAnywhere)
+    UBoxComponent* BakeBounds;
+
+    UPROPERTY(EditAnywhere, Category = "Walkability")
+    TObjectPtr<UWalkabilityBakeAsset> BakedData;
+};
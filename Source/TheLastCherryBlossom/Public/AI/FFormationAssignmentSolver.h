@@ -0,0 +1,106 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class EFormationAssignmentBackend : uint8
+{
+    // دقیق، O(n³) تک Thread
+    Hungarian,
+
+    // حراج ε-scaling با پیشنهادهای موازی؛ حداکثر NumSlots * ε بدتر از بهینه
+    Auction,
+};
+
+/**
+ * تخصیص بهینه یونیت به اسلات (Hungarian به شکل کوتاه‌ترین مسیر افزایشی Jonker–Volgenant) روی یک ماتریس هزینه پیوسته ردیفی.
+ * ماتریس N×M مستطیلی مستقیم حل می‌شود (بدون ردیف/ستون ساختگی) و همه آرایه‌های کمکی بین فراخوانی‌ها
+ * نگه داشته می‌شوند، پس بعد از اولین حل با همان اندازه دیگر Allocate نمی‌کند.
+ * ردیف‌ها تا مضرب چهار Pad می‌شوند تا ساخت ماتریس و Relax هر ردیف چهار ستون چهار ستون با SIMD انجام شود.
+ * برای آرایش‌های خیلی بزرگ حراج ε-scaling (Bertsekas) هم هست که دور پیشنهادهایش با ParallelFor پخش می‌شود.
+ * به World دسترسی ندارد و روی هر Thread قابل اجراست (هر Thread نمونه خودش).
+ */
+class THELASTCHERRYBLOSSOM_API FFormationAssignmentSolver
+{
+public:
+    // هزینه یونیت i به اسلات j = فاصله - ForwardBias * (جلو بودن جهت اسلات نسبت به Center)، کف صفر
+    // بایاس هر اسلات فقط یک بار حساب می‌شود
+    void BuildCostMatrix(TConstArrayView<FVector> UnitLocations, TConstArrayView<FVector> Slots, const FVector& Center, const FVector& Forward, float ForwardBias);
+
+    // ماتریس آماده ردیفی بدون Pad (مثلاً برای Benchmark)؛ InCost.Num() باید InRows * InCols باشد
+    void SetCostMatrix(TConstArrayView<float> InCost, int32 InRows, int32 InCols);
+
+    // OutAssignment[i] = اسلات یونیت i؛ اگر یونیت‌ها از اسلات‌ها بیشترند یونیت‌های اضافه INDEX_NONE می‌گیرند
+    // مجموع هزینه تخصیص را برمی‌گرداند
+    float Solve(TArray<int32>& OutAssignment);
+
+    // حراج با اپسیلون نهایی Epsilon (واحد هزینه)؛ هزینه کل حداکثر بهینه + GetLastOptimalityBound()
+    float SolveAuction(TArray<int32>& OutAssignment, float Epsilon);
+
+    // Hungarian یا حراج بر اساس اندازه (ai.Formation.AuctionMinUnits و ai.Formation.AuctionEpsilon)
+    float SolveAuto(TArray<int32>& OutAssignment);
+
+    EFormationAssignmentBackend GetLastBackend() const { return LastBackend; }
+
+    // فاصله تضمینی هزینه آخرین حل از بهینه (صفر برای Hungarian)
+    float GetLastOptimalityBound() const { return LastOptimalityBound; }
+
+    // حریصانه ردیف به ردیف (برای مقایسه یا خوشه‌های خیلی بزرگ)
+    void SolveGreedy(TArray<int32>& OutAssignment) const;
+
+    int32 GetNumRows() const { return Rows; }
+    int32 GetNumCols() const { return Cols; }
+    float GetCost(int32 Row, int32 Col) const { return Cost[Row * Stride + Col]; }
+
+private:
+    // ستون‌های Pad هزینه بی‌نهایت دارند و هیچ‌وقت انتخاب نمی‌شوند
+    static void PadRow(float* Row, int32 NumCols, int32 RowStride);
+
+    float SolveWithBackend(TArray<int32>& OutAssignment, EFormationAssignmentBackend Backend, float Epsilon);
+    void SolveRowsToColsWith(EFormationAssignmentBackend Backend, const float* Matrix, int32 NumRows, int32 NumCols, int32 RowStride, float Epsilon, TArray<int32>& OutRowToCol);
+
+    // Hungarian روی ماتریس ردیفی با NumRows <= NumCols (گام ردیف RowStride، مضرب چهار)
+    void SolveRowsToCols(const float* Matrix, int32 NumRows, int32 NumCols, int32 RowStride, TArray<int32>& OutRowToCol);
+
+    // Relax همه ستون‌ها از ردیف RowIndex با هزینه کاهش‌یافته Row[j] - V[j] - Offset؛ ستون با کمترین D را برمی‌گرداند
+    int32 RelaxRow(const float* Row, float Offset, int32 RowIndex, int32 RowStride, float& OutMinDist);
+
+    // حراج روی همان شکل ماتریس؛ هر خریدار کم‌هزینه‌ترین اسلات با قیمت فعلی را می‌خرد
+    void AuctionRowsToCols(const float* Matrix, int32 NumRows, int32 NumCols, int32 RowStride, float Epsilon, TArray<int32>& OutRowToCol);
+
+    // کمترین و دومین کمترین Row[j] + Prices[j]؛ اندیس کمترین را برمی‌گرداند (فقط خواندن، امن برای ParallelFor)
+    int32 FindBestSlot(const float* Row, int32 RowStride, float& OutBest, float& OutSecond) const;
+
+    TArray<float> Cost;
+    int32 Rows = 0;
+    int32 Cols = 0;
+    int32 Stride = 0;
+
+    // پتانسیل ستون‌ها (پتانسیل ردیف‌ها ضمنی است) و جستجوی کوتاه‌ترین مسیر هر ردیف
+    TArray<float> V;
+    TArray<float> Dist;
+    TArray<float> Closed;       // صفر برای ستون باز، بی‌نهایت برای ستون بسته (بدون شرط در حلقه SIMD)
+    TArray<float> PredRow;      // ردیف قبلی هر ستون؛ به صورت float تا با همان Select برداری نوشته شود
+    TArray<int32> ColToRow;
+    TArray<int32> ScannedCols;
+    TArray<float> ScannedDist;
+
+    // حالت حراج
+    TArray<float> Prices;
+    TArray<int32> SlotOwner;
+    TArray<int32> BidderSlot;
+    TArray<float> DummyRow;
+    TArray<int32> Bidders;
+    TArray<int32> BidSlot;
+    TArray<float> BidPrice;
+
+    EFormationAssignmentBackend LastBackend = EFormationAssignmentBackend::Hungarian;
+    float LastOptimalityBound = 0.f;
+
+    // ترانهاده برای حالت یونیت بیشتر از اسلات و مختصات SoA اسلات‌ها برای ساخت ماتریس
+    TArray<float> Transposed;
+    TArray<int32> SlotToUnit;
+    TArray<float> SlotX;
+    TArray<float> SlotY;
+    TArray<float> SlotZ;
+    TArray<float> SlotBias;
+};
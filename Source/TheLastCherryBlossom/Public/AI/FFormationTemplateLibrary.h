@@ -0,0 +1,59 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FFormationTemplateLibrary.generated.h"
+
+UENUM(BlueprintType)
+enum class EFormationShape : uint8
+{
+    // تقریباً مربع؛ ردیف آخر ناقص در عرض کامل پخش می‌شود
+    Box,
+
+    // پهن و کم‌عمق (حدود چهار به یک)
+    Line,
+
+    // باریک و عمیق (حدود یک به چهار)
+    Column,
+
+    // مثلث با نوک رو به جلو؛ ردیف r ام 2r+1 اسلات دارد
+    Wedge,
+};
+
+/**
+ * آفست محلی اسلات‌های یک قالب آرایش برای یک تعداد مشخص، در واحد فاصله اسلات (X = راست، Y = جلو، مرکز آرایش روی صفر).
+ * اسلات‌ها به ترتیب SortKeys (جلو به عقب، در هر ردیف چپ به راست) مرتب‌اند.
+ */
+struct THELASTCHERRYBLOSSOM_API FFormationTemplate
+{
+    // SoA و Pad شده تا مضرب چهار (آفست‌های Pad صفر)
+    TArray<float> OffsetX;
+    TArray<float> OffsetY;
+
+    // (ردیف << 16) | ترتیب داخل ردیف
+    TArray<uint32> SortKeys;
+
+    int32 Num() const { return SortKeys.Num(); }
+
+    // Goal + Right * X * Spacing + Forward * Y * Spacing برای همه اسلات‌ها (چهار اسلات در هر قدم SIMD)
+    void TransformToWorld(const FVector& Goal, const FVector& Forward, float Spacing, TArray<FVector>& OutSlots) const;
+};
+
+/**
+ * کش قالب‌های آرایش: هر (شکل، تعداد) فقط در اولین درخواست ساخته می‌شود و تا پایان برنامه می‌ماند.
+ * ساخت اسلات‌ها بعد از آن یک جستجوی Map و یک تبدیل SIMD است. از هر Thread قابل صدا زدن است.
+ */
+class THELASTCHERRYBLOSSOM_API FFormationTemplateLibrary
+{
+public:
+    static const FFormationTemplate& Get(EFormationShape Shape, int32 NumSlots);
+
+private:
+    static void BuildTemplate(EFormationShape Shape, int32 NumSlots, FFormationTemplate& OutTemplate);
+
+    // ردیف‌های کامل Columns تایی؛ ردیف آخر ناقص در عرض همان ردیف کامل پخش می‌شود
+    static void BuildRanks(int32 NumSlots, int32 Columns, TArray<FVector2f>& OutOffsets, TArray<uint32>& OutKeys);
+    static void BuildWedge(int32 NumSlots, TArray<FVector2f>& OutOffsets, TArray<uint32>& OutKeys);
+
+    // Count اسلات یک ردیف با فاصله مساوی بین -HalfWidth و HalfWidth (یک اسلات در وسط)
+    static void AddRow(int32 Row, int32 Count, float HalfWidth, TArray<FVector2f>& OutOffsets, TArray<uint32>& OutKeys);
+};
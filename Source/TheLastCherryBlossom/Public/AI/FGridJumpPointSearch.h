@@ -0,0 +1,99 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Jump Point Search روی یک Bitmap یکنواخت (هشت جهته، بدون بریدن گوشه مانع).
+ * حالت‌های گره با شماره نسل علامت می‌خورند، پس بین جستجوها هیچ آرایه‌ای پاک نمی‌شود
+ * و لیست باز/حالت گره‌ها بعد از اولین جستجو روی همان اندازه گرید دیگر Allocate نمی‌کنند.
+ * با BuildJumpTable فاصله پرش‌های مستقیم (JPS+) یک بار برای Bitmap پیش‌محاسبه می‌شود.
+ * به World دسترسی ندارد و روی هر Thread قابل اجراست (هر Thread نمونه خودش).
+ */
+class THELASTCHERRYBLOSSOM_API FGridJumpPointSearch
+{
+public:
+    // Bitmap باید تا پایان استفاده زنده بماند؛ جدول JPS+ قبلی دور ریخته می‌شود
+    void SetGrid(const TBitArray<>* InWalkable, int32 InWidth, int32 InHeight);
+
+    // JPS+: فاصله تا اولین Jump Point یا دیوار در چهار جهت مستقیم برای همه سلول‌ها
+    void BuildJumpTable();
+    bool HasJumpTable() const { return JumpDistance.Num() > 0; }
+
+    // مسیر به صورت Jump Pointها (شامل شروع و مقصد)؛ false اگر مسیری نباشد
+    // bUseJumpTable = false یعنی JPS معمولی حتی اگر جدول ساخته شده باشد
+    bool FindPath(const FIntPoint& Start, const FIntPoint& Goal, TArray<FIntPoint>& OutPoints, bool bUseJumpTable = true);
+
+    // چند مسیر با یک جستجو: Dijkstra معکوس از Source تا بسته شدن همه Targetها (جدول JPS+ استفاده نمی‌شود)
+    // مسیر هر Target از Map والدها از خود Target تا Source است؛ Target بی‌مسیر آرایه خالی می‌گیرد
+    // false اگر هیچ Targetی به Source نرسد
+    bool FindPathsToSource(const FIntPoint& Source, TConstArrayView<FIntPoint> Targets, TArray<TArray<FIntPoint>>& OutPaths);
+
+    // آمار آخرین جستجو (برای Benchmark)
+    int32 GetLastExpandedNodes() const { return LastExpandedNodes; }
+
+    bool IsWalkable(int32 X, int32 Y) const
+    {
+        return X >= 0 && Y >= 0 && X < Width && Y < Height && (*Walkable)[Y * Width + X];
+    }
+
+private:
+    struct FNodeState
+    {
+        float G = 0.f;
+        int32 Parent = INDEX_NONE;
+        uint32 Generation = 0;
+        bool bClosed = false;
+    };
+
+    struct FOpenEntry
+    {
+        float F = 0.f;
+        float G = 0.f;
+        int32 Node = INDEX_NONE;
+    };
+
+    static bool IsOpenEntryBetter(const FOpenEntry& A, const FOpenEntry& B);
+
+    bool IsTargetCell(int32 X, int32 Y) const
+    {
+        return bMultiTarget ? TargetMask[Y * Width + X] : (X == GoalCell.X && Y == GoalCell.Y);
+    }
+
+    // Octile تا مقصد؛ در جستجوی چند مقصدی صفر (Dijkstra)
+    float Heuristic(int32 X, int32 Y) const;
+
+    // نسل جدید و گره شروع در لیست باز
+    void BeginSearch(const FIntPoint& Start);
+
+    // جانشین‌های هرس‌شده یک گره بسته‌شده
+    void ExpandNode(int32 Node);
+
+    // ترتیب چهار جهت مستقیم در جدول JPS+
+    enum EStraightDir : int32 { East, West, North, South, NumStraightDirs };
+
+    // سلول (X,Y) که با حرکت مستقیم (DX,DY) رسیده‌ایم همسایه اجباری دارد؟
+    bool HasForcedNeighbour(int32 X, int32 Y, int32 DX, int32 DY) const;
+
+    // پرش مستقیم از سلول (X,Y) (خود سلول هم بررسی می‌شود)؛ اندیس Jump Point یا INDEX_NONE
+    int32 JumpStraight(int32 X, int32 Y, int32 DX, int32 DY) const;
+    int32 JumpDiagonal(int32 X, int32 Y, int32 DX, int32 DY) const;
+
+    void AddSuccessor(int32 Node, int32 Successor);
+
+    const TBitArray<>* Walkable = nullptr;
+    int32 Width = 0;
+    int32 Height = 0;
+    FIntPoint GoalCell = FIntPoint::ZeroValue;
+    bool bSearchUsesJumpTable = false;
+    bool bMultiTarget = false;
+    TBitArray<> TargetMask;
+
+    TArray<FNodeState> Nodes;
+    TArray<FOpenEntry> OpenList;
+    uint32 Generation = 0;
+    int32 LastExpandedNodes = 0;
+
+    // JPS+: برای هر جهت و سلول، قدم تا اولین Jump Point (-1 اگر قبلش دیوار است) و طول رشته قابل عبور
+    TArray<int16> JumpDistance;
+    TArray<int16> WalkableRun;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * مسیر نهایی تغییرناپذیر و مشترک.
+ * برای هر خوشه یا درخواست یک بار ساخته می‌شود و همه یونیت‌ها فقط همین Handle را نگه می‌دارند
+ * (کپی Handle فقط یک شمارنده ارجاع است؛ آرایه نقاط هیچ‌وقت برای یونیت‌ها کپی نمی‌شود).
+ */
+class FGridPathHandle
+{
+public:
+    FGridPathHandle() = default;
+
+    explicit FGridPathHandle(TArray<FVector>&& InPoints)
+        : Points(MakeShared<TArray<FVector>>(MoveTemp(InPoints)))
+    {
+    }
+
+    explicit FGridPathHandle(const TArray<FVector>& InPoints)
+        : Points(MakeShared<TArray<FVector>>(InPoints))
+    {
+    }
+
+    bool IsValid() const { return Points.IsValid() && Points->Num() > 0; }
+    int32 Num() const { return Points.IsValid() ? Points->Num() : 0; }
+    bool IsValidIndex(int32 Index) const { return Points.IsValid() && Points->IsValidIndex(Index); }
+
+    const FVector& operator[](int32 Index) const { return (*Points)[Index]; }
+    const FVector& Last() const { return Points->Last(); }
+
+    // برای APIهایی که آرایه می‌خواهند (بدون کپی)
+    const TArray<FVector>& GetPoints() const { return Points.IsValid() ? *Points : EmptyPoints(); }
+
+    void Reset() { Points.Reset(); }
+
+private:
+    static const TArray<FVector>& EmptyPoints()
+    {
+        static const TArray<FVector> Empty;
+        return Empty;
+    }
+
+    TSharedPtr<const TArray<FVector>> Points;
+};
@@ -6,6 +6,57 @@
 #include "GameFramework/Pawn.h"
 #include "GridPathfinderComponent.generated.h"
 
+// هندسه موانع و NavMesh یک محدوده که یک بار از World جمع‌آوری می‌شود
+// و بعداً بدون هیچ Query فیزیکی روی یک گرید Rasterize می‌شود
+struct FWalkabilityGeometry
+{
+	// یک مانع به صورت جعبه چرخیده (در فضای محلی کامپوننت)
+	struct FObstacleBox
+	{
+		FTransform LocalToWorld;
+		FBox LocalBox;
+		FBox WorldBounds;
+	};
+
+	// رئوس چندضلعی‌های NavMesh (XY) پشت سر هم؛ PolyStart[i]..PolyStart[i+1] رئوس پلی i هستند
+	TArray<FVector2D> PolyVerts;
+	TArray<int32> PolyStart;
+
+	TArray<FObstacleBox> Obstacles;
+
+	// فاصله‌ای که هر مانع به اندازه آن بزرگ‌تر در نظر گرفته می‌شود (شعاع کاراکتر)
+	float ObstacleInflation = 0.f;
+
+	int32 NumPolys() const { return FMath::Max(0, PolyStart.Num() - 1); }
+};
+
+// لایه‌هایی که GatherWorldWalkabilityGeometry جمع می‌کند
+enum class EWalkabilityLayers : uint8
+{
+	None            = 0,
+	NavMesh         = 1 << 0,
+	StaticObstacles = 1 << 1,   // ECC_GameTraceChannel1
+	Units           = 1 << 2,   // ECC_GameTraceChannel2
+
+	Static = NavMesh | StaticObstacles,
+	All    = NavMesh | StaticObstacles | Units,
+};
+ENUM_CLASS_FLAGS(EWalkabilityLayers)
+
+// موتور مسیر‌یابی بعد از شکست مسیر مستقیم
+UENUM(BlueprintType)
+enum class EGridPathfindingMode : uint8
+{
+	NavMesh         UMETA(DisplayName="NavMesh"),       // مسیر پلی‌های Recast
+	JumpPoint       UMETA(DisplayName="Jump Point"),    // JPS روی Bitmap کش Walkability
+	JumpPointPlus   UMETA(DisplayName="Jump Point+"),   // JPS با فاصله پرش‌های پیش‌محاسبه‌شده
+};
+
+class UWalkabilityCacheSubsystem;
+
+// نتیجه درخواست مسیر Async؛ مسیر خالی یعنی شکست
+DECLARE_DELEGATE_OneParam(FOnGridPathComplete, const TArray<FVector>& /*Path*/);
+
 UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
 class THELASTCHERRYBLOSSOM_API UGridPathfinderComponent : public UActorComponent
 {
@@ -21,9 +72,65 @@ public:
 	// پیدا کردن نزدیک‌ترین نقطه Walkable
 	bool FindClosestWalkable(const FVector& Origin, FVector& OutLocation) const;
 
-	// مسیر‌یابی اصلی
+	// جمع‌آوری یک‌باره پلی‌های NavMesh و موانع داخل Bounds (فقط Game Thread)
+	bool GatherWalkabilityGeometry(const FBox& Bounds, FWalkabilityGeometry& OutGeometry) const;
+
+	// همان جمع‌آوری بدون کامپوننت و فقط برای لایه‌های خواسته‌شده (مثلاً Static برای کش Walkability)
+	static bool GatherWorldWalkabilityGeometry(
+		const UWorld* World,
+		const FBox& Bounds,
+		float ObstacleInflation,
+		EWalkabilityLayers Layers,
+		const AActor* IgnoredActor,
+		FWalkabilityGeometry& OutGeometry);
+
+	// تست مستقیم NavMesh + موانع ثابت (بدون کش و بدون یونیت‌ها)
+	static bool IsLocationStaticallyWalkable(const UWorld* World, const FVector& Location, float ObstacleInflation);
+
+	// ساخت Bitmap قابل عبور بودن برای کل گرید در یک پاس (بدون Query فیزیکی)
+	// مرکز سلول (x,y) برابر GridOrigin + (x+0.5, y+0.5) * CellSize است
+	static void RasterizeWalkability(
+		const FWalkabilityGeometry& Geometry,
+		const FVector2D& GridOrigin,
+		float CellSize,
+		int32 Width,
+		int32 Height,
+		TBitArray<>& OutWalkable);
+
+	// فقط پاس موانع روی یک Bitmap موجود (مثلاً Bitmap ثابت Bake شده + یونیت‌ها)
+	static void RasterizeObstacles(
+		const FWalkabilityGeometry& Geometry,
+		const FVector2D& GridOrigin,
+		float CellSize,
+		int32 Width,
+		int32 Height,
+		TBitArray<>& InOutWalkable);
+
+	// مسیر‌یابی اصلی (همزمان، روی Game Thread)
 	TArray<FVector> FindPathShared(const FVector& StartWorld, const FVector& GoalWorld);
 
+	// همان مسیر‌یابی از طریق صف UGridPathRequestSubsystem (NavMesh روی Thread ناوبری، Smooth داخل بودجه فریم)
+	// شناسه درخواست را برمی‌گرداند (صفر اگر World نباشد)
+	// SharedGoalGroup: شناسه گروه هم‌مقصد از UGridPathRequestSubsystem::NewSharedGoalGroup (صفر = بدون گروه)
+	uint32 FindPathAsync(const FVector& StartWorld, const FVector& GoalWorld, FOnGridPathComplete OnComplete, int32 Priority = 0, uint32 SharedGoalGroup = 0);
+
+	void CancelPathRequest(uint32 RequestId);
+
+	// مراحل FindPathShared که صف Async هم جداگانه از آن‌ها استفاده می‌کند
+	bool FindDirectPath(const FVector& StartWorld, const FVector& GoalWorld, TArray<FVector>& OutPath) const;
+	bool ResolveGoal(const FVector& GoalWorld, FVector& OutGoal) const;
+
+	// مسیر خام گرید (Jump Pointها) طبق PathfindingMode؛ false اگر حالت NavMesh باشد یا گرید جواب ندهد
+	bool FindGridPath(const FVector& StartWorld, const FVector& GoalWorld, TArray<FVector>& OutPoints) const;
+
+	// چند شروع به یک مقصد (حل‌شده) با یک جستجوی معکوس گرید؛ OutPoints هم‌اندیس با StartsWorld و خالی برای شروع بی‌مسیر
+	bool FindGridPathsToGoal(TConstArrayView<FVector> StartsWorld, const FVector& GoalWorld, TArray<TArray<FVector>>& OutPoints) const;
+	TArray<FVector> FinalizeNavPath(const TArray<FVector>& NavPoints);
+
+	// مسیر مشترک درخواستی دیگر (با همان پلی شروع و مقصد) برای این یونیت:
+	// قطعه کوتاه از StartWorld به مسیر (داخل پلی محدب شروع) + در صورت نیاز قطعه آخر تا GoalWorld
+	TArray<FVector> StitchSharedPath(const FVector& StartWorld, const FVector& GoalWorld, const TArray<FVector>& SharedPath) const;
+
 	TArray<FVector> ProcessFinalPath(const TArray<FVector>& InputPath);
 
 	TArray<FVector>ResamplePath(const TArray<FVector>& InputPath, float SegmentLength) const;
@@ -36,7 +143,20 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pathfinding")
 	float SearchRadius = 500.f;
 
+	// حالت‌های گرید برای نقشه‌های تخت و شلوغ؛ مسیرهای بلندتر از پنجره گرید خودکار به NavMesh برمی‌گردند
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pathfinding")
+	EGridPathfindingMode PathfindingMode = EGridPathfindingMode::NavMesh;
+
 	protected:
 	
 	void BeginPlay();
+
+private:
+
+	// خط دید مسیر مستقیم و Smooth: Bitmap کش Walkability (بدون فیزیک)، یا Sweep اگر کش نباشد
+	bool IsLineClear(const FVector& Start, const FVector& End) const;
+	bool IsSweepClear(const FVector& Start, const FVector& End) const;
+
+	// کش با یک Inflation عمومی ساخته شده؛ کاراکتر بزرگ‌تر مابقی را از Clearance می‌گیرد
+	float GetWalkabilityClearance(const UWalkabilityCacheSubsystem& WalkabilityCache) const;
 };
\ No newline at end of file
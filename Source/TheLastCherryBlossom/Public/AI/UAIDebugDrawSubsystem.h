@@ -0,0 +1,69 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Components/LineBatchComponent.h"
+#include "UAIDebugDrawSubsystem.generated.h"
+
+// در Shipping کل لایه دیباگ حذف می‌شود (IsEnabled همیشه false و توابع رسم خالی‌اند)
+#define ENABLE_AI_DEBUG_DRAW ENABLE_DRAW_DEBUG
+
+// کانال‌های دیباگ؛ هر کانال با CVar خودش روشن می‌شود (ai.Debug.Path و...)
+enum class EAIDebugChannel : uint8
+{
+    Path,           // مسیر خام، Resample و Smooth شده
+    Corridor,       // دیواره‌های کریدور FlowField
+    Field,          // جهت سلول‌های FlowField
+    Formation,      // اسلات‌های آرایش و تخصیص یونیت‌ها
+    Repulsion,      // موانع و نیروهای دافعه
+
+    Num
+};
+
+/**
+ * لایه مرکزی رسم دیباگ AI.
+ * فراخوان‌ها قبل از ساختن هر داده دیباگی IsEnabled را چک می‌کنند؛ پس وقتی کانال خاموش است هیچ هزینه‌ای (حتی Format رشته) ندارند.
+ * خطوط یک فریم جمع می‌شوند و در پایان فریم با یک DrawLines به LineBatcher پایدار World داده می‌شوند.
+ */
+namespace AIDebugDraw
+{
+#if ENABLE_AI_DEBUG_DRAW
+    bool IsEnabled(EAIDebugChannel Channel);
+
+    void Line(const UWorld* World, EAIDebugChannel Channel, const FVector& Start, const FVector& End, const FColor& Color, float LifeTime, float Thickness = 0.f);
+    void Arrow(const UWorld* World, EAIDebugChannel Channel, const FVector& Start, const FVector& End, float ArrowSize, const FColor& Color, float LifeTime, float Thickness = 0.f);
+    void Sphere(const UWorld* World, EAIDebugChannel Channel, const FVector& Center, float Radius, int32 Segments, const FColor& Color, float LifeTime, float Thickness = 0.f);
+    void Point(const UWorld* World, EAIDebugChannel Channel, const FVector& Position, float Size, const FColor& Color, float LifeTime);
+
+    // رشته‌ها Batch نمی‌شوند (HUD)؛ فقط برای برچسب‌های کم‌تعداد
+    void String(const UWorld* World, EAIDebugChannel Channel, const FVector& Location, const FString& Text, const FColor& Color, float LifeTime);
+#else
+    FORCEINLINE constexpr bool IsEnabled(EAIDebugChannel) { return false; }
+
+    FORCEINLINE void Line(const UWorld*, EAIDebugChannel, const FVector&, const FVector&, const FColor&, float, float = 0.f) {}
+    FORCEINLINE void Arrow(const UWorld*, EAIDebugChannel, const FVector&, const FVector&, float, const FColor&, float, float = 0.f) {}
+    FORCEINLINE void Sphere(const UWorld*, EAIDebugChannel, const FVector&, float, int32, const FColor&, float, float = 0.f) {}
+    FORCEINLINE void Point(const UWorld*, EAIDebugChannel, const FVector&, float, const FColor&, float) {}
+    FORCEINLINE void String(const UWorld*, EAIDebugChannel, const FVector&, const FString&, const FColor&, float) {}
+#endif
+}
+
+// خطوط ثبت‌شده در طول فریم را نگه می‌دارد و یک بار در فریم به LineBatcher می‌دهد (در Shipping ساخته نمی‌شود)
+UCLASS()
+class THELASTCHERRYBLOSSOM_API UAIDebugDrawSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+    virtual void Deinitialize() override;
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+
+    void AddLine(const FVector& Start, const FVector& End, const FColor& Color, float LifeTime, float Thickness);
+
+private:
+    // LifeTime > 0 → LineBatcher پایدار؛ بقیه فقط یک فریم
+    TArray<FBatchedLine> PendingLines;
+    TArray<FBatchedLine> PendingFrameLines;
+};
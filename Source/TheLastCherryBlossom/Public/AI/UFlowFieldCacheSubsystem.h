@@ -0,0 +1,117 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UFlowFieldCacheSubsystem.generated.h"
+
+struct FFlowFieldGrid;
+struct FFlowFieldBuildInput;
+class ANavigationData;
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnFlowFieldObstaclesChanged, const TArray<FBox>& /*DirtyBounds*/);
+
+// کلید کش یک سکتور: مختصات سکتور، سلول مقصد (کوانتیزه)، عرض کریدور، اندازه سلول، مسیر کوانتیزه و پورتال‌ها
+// PathHash فقط برای GetTypeHash است؛ برابری روی خود داده‌ها بررسی می‌شود تا برخورد Hash فیلد اشتباه برنگرداند
+struct FFlowFieldCacheKey
+{
+    FIntPoint SectorCoord = FIntPoint::ZeroValue;
+    FIntPoint DestinationCell = FIntPoint::ZeroValue;
+    int32 CorridorWidthCm = 0;
+    int32 CellSizeCm = 0;
+    int32 WindowCells = 0;
+    int32 SmoothingIterations = 0;
+    TArray<FIntPoint> PathCells;
+    TArray<FIntRect> PortalRects;
+    uint32 PathHash = 0;
+
+    bool operator==(const FFlowFieldCacheKey& Other) const
+    {
+        return PathHash == Other.PathHash
+            && SectorCoord == Other.SectorCoord
+            && DestinationCell == Other.DestinationCell
+            && CorridorWidthCm == Other.CorridorWidthCm
+            && CellSizeCm == Other.CellSizeCm
+            && WindowCells == Other.WindowCells
+            && SmoothingIterations == Other.SmoothingIterations
+            && PathCells == Other.PathCells
+            && PortalRects == Other.PortalRects;
+    }
+
+    friend uint32 GetTypeHash(const FFlowFieldCacheKey& Key)
+    {
+        uint32 Hash = HashCombine(GetTypeHash(Key.SectorCoord), GetTypeHash(Key.DestinationCell));
+        Hash = HashCombine(Hash, GetTypeHash(Key.CorridorWidthCm));
+        Hash = HashCombine(Hash, GetTypeHash(Key.CellSizeCm));
+        return HashCombine(Hash, Key.PathHash);
+    }
+};
+
+/**
+ * کش LRU سطح World برای گرید سکتورهای FlowField.
+ * سفارش‌هایی که با همان کریدور از یک سکتور می‌گذرند، گرید آماده (و تغییرناپذیر) آن سکتور را دوباره استفاده می‌کنند.
+ * حجم کل با ai.FlowFieldCache.BudgetMB محدود است و با هر بار ساخت مجدد NavMesh خالی می‌شود.
+ */
+UCLASS()
+class THELASTCHERRYBLOSSOM_API UFlowFieldCacheSubsystem : public UWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+    virtual void Deinitialize() override;
+
+    static FFlowFieldCacheKey MakeSectorKey(const FIntPoint& SectorCoord, const FFlowFieldBuildInput& Input);
+
+    // در صورت وجود، گرید را برمی‌گرداند و آن را جدیدترین مورد استفاده علامت می‌زند
+    TSharedPtr<const FFlowFieldGrid> Find(const FFlowFieldCacheKey& Key);
+
+    void Add(const FFlowFieldCacheKey& Key, const TSharedRef<const FFlowFieldGrid>& Grid);
+
+    // خالی کردن کامل کش (مثلاً بعد از تغییر NavMesh)
+    void Invalidate();
+
+    // گزارش تغییر موانع ایستا (ساختمان جدید، تخریب و...) — همه گزارش‌های یک فریم در فریم بعد یک‌جا پخش می‌شوند
+    UFUNCTION(BlueprintCallable, Category = "FlowField")
+    void NotifyObstaclesChanged(const FBox& DirtyBounds);
+
+    // گزارش یونیت پارک‌شده: فقط سکتورهای FlowField تعمیر می‌شوند؛ کش Walkability و مسیرهای گرید (که یونیت‌ها را نمی‌بینند) دست نمی‌خورند
+    void NotifyUnitObstaclesChanged(const FBox& DirtyBounds);
+
+    // FlowFieldها برای تعمیر محلی به این رویداد گوش می‌دهند (همه تغییرات، از جمله یونیت‌ها)
+    FOnFlowFieldObstaclesChanged OnObstaclesChanged;
+
+    // فقط تغییرات موانع ایستا — برای کش‌هایی که روی لایه‌های Static ساخته می‌شوند
+    FOnFlowFieldObstaclesChanged OnStaticObstaclesChanged;
+
+    SIZE_T GetUsedBytes() const { return UsedBytes; }
+
+    // با هر باطل‌سازی (تغییر موانع یا NavMesh) جلو می‌رود؛ ساختی که هندسه‌اش قبل از آن جمع شده نباید به کش برگردد
+    uint32 GetObstacleEpoch() const { return ObstacleEpoch; }
+
+private:
+    UFUNCTION()
+    void OnNavigationGenerationFinished(ANavigationData* NavData);
+
+    void EvictToBudget(SIZE_T BudgetBytes);
+
+    // حذف سکتورهایی که پنجره ساختشان با ناحیه کثیف تداخل دارد
+    void InvalidateBounds(const TArray<FBox>& DirtyBounds);
+
+    void QueueObstacleChange(const FBox& DirtyBounds, bool bStatic);
+    void FlushObstacleChanges();
+
+    struct FEntry
+    {
+        TSharedPtr<const FFlowFieldGrid> Grid;
+        SIZE_T Bytes = 0;
+        uint64 LastUsed = 0;
+    };
+
+    TMap<FFlowFieldCacheKey, FEntry> Entries;
+    SIZE_T UsedBytes = 0;
+    uint64 UseCounter = 0;
+    uint32 ObstacleEpoch = 0;
+
+    TArray<FBox> PendingDirtyBounds;
+    TArray<FBox> PendingStaticDirtyBounds;
+};
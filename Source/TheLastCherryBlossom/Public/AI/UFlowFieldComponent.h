@@ -3,8 +3,10 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 #include "AI/GridPathfinderComponent.h"
+#include "AI/UFlowFieldCacheSubsystem.h"
 #include "UFlowFieldComponent.generated.h"
 
+// نمای Blueprint از یک سلول — فقط توسط GetCell ساخته می‌شود و در حافظه گرید نگه‌داری نمی‌شود
 USTRUCT(BlueprintType)
 struct FFlowFieldCell
 {
@@ -29,6 +31,204 @@ struct FFlowFieldCell
     FVector Direction = FVector::ZeroVector;
 };
 
+/**
+ * ذخیره‌سازی فشرده (Struct-of-Arrays) گرید FlowField.
+ * هر سلول ۷ بایت است: هزینه uint16، فلگ‌ها در یک بایت و دو جهت به صورت زاویه ۱۶ بیتی.
+ * هر مرحله از ساخت فقط صفحه‌ای را می‌خواند که لازم دارد.
+ * جهت نهایی از گرادیان میدان انتگرال (Cost) به دست می‌آید؛ PathDirection فقط جهت پشتیبان است.
+ */
+struct THELASTCHERRYBLOSSOM_API FFlowFieldGrid
+{
+    enum ECellFlags : uint8
+    {
+        Flag_InCorridor     = 1 << 0,
+        Flag_Obstacle       = 1 << 1,
+        Flag_HasDirection   = 1 << 2,
+        Flag_HasPathVector  = 1 << 3,
+    };
+
+    static constexpr uint16 UnreachableCost = MAX_uint16;
+
+    FVector Origin = FVector::ZeroVector;
+    float CellSize = 50.f;
+    int32 Width = 0;
+    int32 Height = 0;
+
+    TArray<uint16> Cost;            // هزینه تا هدف محلی سکتور (مقصد یا پورتال)، یک‌دهم سلول (UnreachableCost = نامشخص)
+    TArray<uint8> Flags;
+    TArray<uint16> Direction;       // جهت نهایی (زاویه کوانتیزه)
+    TArray<uint16> PathDirection;   // جهت مسیر (زاویه کوانتیزه)
+
+    void Init(const FVector& InOrigin, float InCellSize, int32 InWidth, int32 InHeight);
+    void Reset();
+
+    int32 Num() const { return Flags.Num(); }
+    bool IsValidCoord(int32 X, int32 Y) const { return X >= 0 && Y >= 0 && X < Width && Y < Height; }
+    int32 ToIndex(int32 X, int32 Y) const { return Y * Width + X; }
+
+    FIntPoint WorldToGrid(const FVector& WorldLocation) const
+    {
+        return FIntPoint(
+            FMath::FloorToInt((WorldLocation.X - Origin.X) / CellSize),
+            FMath::FloorToInt((WorldLocation.Y - Origin.Y) / CellSize));
+    }
+
+    FVector GridToWorld(int32 X, int32 Y) const
+    {
+        return FVector((X + 0.5f) * CellSize + Origin.X, (Y + 0.5f) * CellSize + Origin.Y, Origin.Z);
+    }
+
+    bool HasFlag(int32 Index, uint8 Flag) const { return (Flags[Index] & Flag) != 0; }
+    void SetFlag(int32 Index, uint8 Flag) { Flags[Index] |= Flag; }
+    void ClearFlag(int32 Index, uint8 Flag) { Flags[Index] &= ~Flag; }
+
+    FVector GetDirection(int32 Index) const
+    {
+        return HasFlag(Index, Flag_HasDirection) ? DecodeAngle(Direction[Index]) : FVector::ZeroVector;
+    }
+
+    FVector GetPathVector(int32 Index) const
+    {
+        return HasFlag(Index, Flag_HasPathVector) ? DecodeAngle(PathDirection[Index]) : FVector::ZeroVector;
+    }
+
+    void SetDirection(int32 Index, const FVector& Dir)
+    {
+        SetPackedDirection(Direction, Index, Flag_HasDirection, Dir);
+    }
+
+    void SetPathVector(int32 Index, const FVector& Dir)
+    {
+        SetPackedDirection(PathDirection, Index, Flag_HasPathVector, Dir);
+    }
+
+    SIZE_T GetAllocatedSize() const
+    {
+        return Cost.GetAllocatedSize() + Flags.GetAllocatedSize() + Direction.GetAllocatedSize() + PathDirection.GetAllocatedSize();
+    }
+
+    // جهت فقط در صفحه XY ذخیره می‌شود (زاویه Yaw)
+    static uint16 EncodeAngle(const FVector& Dir)
+    {
+        const float Angle = FMath::Atan2((float)Dir.Y, (float)Dir.X);
+        return (uint16)(FMath::RoundToInt((Angle + PI) * (65536.f / (2.f * PI))) & 0xFFFF);
+    }
+
+    static FVector DecodeAngle(uint16 Encoded)
+    {
+        float S, C;
+        FMath::SinCos(&S, &C, Encoded * (2.f * PI / 65536.f) - PI);
+        return FVector(C, S, 0.f);
+    }
+
+private:
+    void SetPackedDirection(TArray<uint16>& Plane, int32 Index, uint8 Flag, const FVector& Dir)
+    {
+        if (Dir.IsNearlyZero())
+        {
+            ClearFlag(Index, Flag);
+            Plane[Index] = 0;
+        }
+        else
+        {
+            SetFlag(Index, Flag);
+            Plane[Index] = EncodeAngle(Dir);
+        }
+    }
+};
+
+/**
+ * FlowField سکتوری: نقشه به سکتورهای ثابت (SectorSizeCells × SectorSizeCells سلول، هم‌تراز با World) تقسیم می‌شود
+ * و فقط سکتورهایی که کریدور از آن‌ها می‌گذرد گرید دارند. حافظه با طول مسیر رشد می‌کند، نه با مساحت Bounds.
+ * گرید هر سکتور تغییرناپذیر است و بین سفارش‌هایی که از همان سکتور می‌گذرند (از طریق کش) مشترک است.
+ */
+struct THELASTCHERRYBLOSSOM_API FFlowFieldSectorMap
+{
+    float CellSize = 50.f;
+    int32 SectorSizeCells = 32;
+    TMap<FIntPoint, TSharedPtr<const FFlowFieldGrid>> Sectors;
+
+    // هزینه باقی‌مانده از مرز هر سکتور تا مقصد (Cost هر سکتور فقط تا هدف محلی خودش است)
+    TMap<FIntPoint, uint32> CostOffsets;
+
+    float GetSectorSizeCm() const { return CellSize * SectorSizeCells; }
+
+    FIntPoint WorldToSector(const FVector& WorldLocation) const
+    {
+        return FIntPoint(
+            FMath::FloorToInt(WorldLocation.X / GetSectorSizeCm()),
+            FMath::FloorToInt(WorldLocation.Y / GetSectorSizeCm()));
+    }
+
+    // گرید سکتور شامل نقطه و ایندکس سلول داخل آن؛ nullptr اگر سکتور ساخته نشده باشد
+    const FFlowFieldGrid* FindCell(const FVector& WorldLocation, int32& OutIndex) const;
+
+    int32 Num() const;
+    SIZE_T GetAllocatedSize() const;
+};
+
+// ورودی‌های ساخت FlowField — روی Game Thread جمع‌آوری می‌شوند و بعد فقط خوانده می‌شوند
+// (پس ساخت می‌تواند روی Thread پس‌زمینه انجام شود)
+// هر ورودی یک «پنجره» است: سکتور به‌علاوه حاشیه‌ای که دافعه و Smoothing لبه‌ها به آن نیاز دارند
+struct FFlowFieldBuildInput
+{
+    FVector Destination = FVector::ZeroVector;
+    TArray<FVector> Path;           // فقط بخشی از مسیر که از پنجره می‌گذرد
+    int32 CorridorWidthCm = 0;
+
+    FVector Origin = FVector::ZeroVector;
+    float CellSize = 50.f;
+    int32 Width = 0;
+    int32 Height = 0;
+    int32 SmoothingIterations = 5;
+
+    // ناحیه خود سکتور داخل پنجره (بقیه حاشیه است و بعد از ساخت دور ریخته می‌شود)
+    FIntRect CoreRect;
+
+    // پورتال: بخشی از پنجره که به سکتور بعدی مسیر تعلق دارد → هدف محلی Flood Fill
+    TArray<FIntRect> PortalRects;
+
+    // هندسه برای Rasterize؛ اگر در دسترس نباشد Walkable از قبل روی Game Thread پر شده است
+    // bHasStaticWalkable: Walkable لایه ثابت (کش / داده Bake) است و Geometry فقط یونیت‌ها را دارد
+    bool bHasGeometry = false;
+    bool bHasStaticWalkable = false;
+
+    // یونیتی داخل پنجره Rasterize شده → سکتور به وضعیت لحظه‌ای یونیت‌ها وابسته است و در کش نمی‌رود
+    bool bHasUnitObstacles = false;
+    FWalkabilityGeometry Geometry;
+    TBitArray<> Walkable;
+};
+
+// سکتوری که در کش نبود و باید ساخته شود
+struct FFlowFieldSectorBuild
+{
+    FIntPoint SectorCoord = FIntPoint::ZeroValue;
+    FFlowFieldCacheKey CacheKey;
+    FFlowFieldBuildInput Input;
+};
+
+// برنامه ساخت یک سفارش: زنجیره سکتورها به ترتیب مسیر، سکتورهای آماده از کش و سکتورهای باقی‌مانده
+struct FFlowFieldBuildPlan
+{
+    FVector Destination = FVector::ZeroVector;
+    TArray<FVector> Path;
+    int32 CorridorWidthCm = 0;
+    float CellSize = 50.f;
+    int32 SectorSizeCells = 32;
+    int32 HaloCells = 0;
+
+    TArray<FIntPoint> SectorChain;
+
+    // Epoch کش FlowField هنگام جمع‌آوری هندسه (UFlowFieldCacheSubsystem::GetObstacleEpoch)
+    uint32 ObstacleEpoch = 0;
+
+    // سکتور بعدی هر سکتور (همسایه‌ای که پورتالش هدف محلی است)؛ سکتور مقصد ورودی ندارد
+    TMap<FIntPoint, FIntPoint> NextSectors;
+
+    TMap<FIntPoint, TSharedPtr<const FFlowFieldGrid>> CachedSectors;
+    TArray<FFlowFieldSectorBuild> Builds;
+};
+
 UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
 class THELASTCHERRYBLOSSOM_API UFlowFieldComponent : public UActorComponent
 {
@@ -40,6 +240,14 @@ public:
     UFUNCTION(BlueprintCallable, Category = "FlowField")
     void GenerateFlowField(const FVector& Destination, const TArray<FVector>& Path, int32 CorridorWidthCm);
 
+    // ساخت در پس‌زمینه؛ تا آماده شدن، فیلد قبلی (در صورت وجود) همچنان معتبر می‌ماند
+    UFUNCTION(BlueprintCallable, Category = "FlowField")
+    void GenerateFlowFieldAsync(const FVector& Destination, const TArray<FVector>& Path, int32 CorridorWidthCm);
+
+    // آیا حداقل یک فیلد کامل منتشر شده است؟
+    UFUNCTION(BlueprintCallable, Category = "FlowField")
+    bool HasField() const { return Field.IsValid() && Field->Sectors.Num() > 0; }
+
     UFUNCTION(BlueprintCallable, Category = "FlowField")
     FVector GetDirectionAtLocation(const FVector& Location) const;
 
@@ -52,10 +260,37 @@ public:
     UFUNCTION(BlueprintCallable, Category = "FlowField")
     FIntPoint WorldToGrid(const FVector& WorldLocation) const;
 
-    // ایمن برای Blueprint - کپی از سلول برمی‌گردونه
+    // ایمن برای Blueprint - سلول را از صفحه‌های فشرده بازسازی می‌کند
     UFUNCTION(BlueprintCallable, Category = "FlowField")
     FFlowFieldCell GetCell(const FIntPoint& Coord) const;
 
+    // فاصله مسیر (وزن‌دار با نزدیکی به مانع) تا مقصد از روی میدان انتگرال — برای تخصیص اسلات و ETA
+    UFUNCTION(BlueprintCallable, Category = "FlowField")
+    bool GetDistanceToGoal(const FVector& Location, float& OutDistanceCm) const;
+
+    // مسیر سریع C++ برای Tick یونیت‌ها: اگر نقطه داخل کریدور باشد جهت حرکت (یا PathVector) را برمی‌گرداند
+    bool SampleDirection(const FVector& Location, FVector& OutDirection) const;
+
+    // نمونه‌برداری دسته‌ای با درون‌یابی دوخطی بین مراکز ۴ سلول (بدون پرش روی مرز سلول‌ها)
+    // OutInCorridor[i] = false یعنی نقطه خارج از کریدور است (مثل SampleDirection)
+    void SampleDirections(TConstArrayView<FVector> Positions, TArrayView<FVector> OutDirections, TArrayView<bool> OutInCorridor) const;
+
+    // دنبال‌کننده‌ها: فیلد در Tick خودش (قبل از Tick یونیت‌ها) جهت همه را با یک فراخوانی نمونه می‌گیرد
+    int32 AddFollower(AActor* Follower);
+    void RemoveFollower(int32 FollowerSlot);
+
+    // false یعنی این Slot هنوز نمونه‌برداری نشده (یونیت تازه اضافه شده)
+    bool GetFollowerDirection(int32 FollowerSlot, FVector& OutDirection, bool& bOutInCorridor) const;
+
+    virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+    const FFlowFieldSectorMap& GetSectorMap() const;
+
+    // حاشیه پنجره ساخت هر سکتور (سلول): دافعه و Smoothing تا این فاصله از همسایه‌ها اثر می‌گیرند
+    static int32 GetSectorHaloCells(float InCellSize, int32 InSmoothingIterations);
+
+    static constexpr int32 MaxSmoothingIterations = 16;
+
     UFUNCTION(BlueprintCallable, Category = "FlowField")
     float GetCellSize() const { return CellSize; }
 
@@ -71,11 +306,21 @@ public:
 
 protected:
     virtual void BeginPlay() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
     // تنظیمات گرید
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "FlowField|Grid")
     float CellSize = 50.f;
 
+    // کیفیت نرمی جهت‌ها؛ هزینه هر تکرار فقط یک پیمایش گرید سکتور است
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "FlowField|Grid", meta = (ClampMin = "0", ClampMax = "16"))
+    int32 SmoothingIterations = 5;
+
+    // اندازه ضلع هر سکتور بر حسب سلول
+    UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "FlowField|Grid", meta = (ClampMin = "16"))
+    int32 SectorSizeCells = 32;
+
+    // محدوده سکتورهای فیلد فعلی (فقط برای دیباگ و مختصات GetCell)
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "FlowField|Grid")
     int32 GridWidth = 50;
 
@@ -88,8 +333,8 @@ protected:
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "FlowField")
     FVector FlowFieldDestination = FVector::ZeroVector;
 
-    UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "FlowField")
-    TArray<FFlowFieldCell> FlowFieldGrid;
+    // سکتورهای فشرده و تغییرناپذیر آخرین فیلد منتشرشده (بازتابی نیست؛ از Blueprint فقط از طریق GetCell)
+    TSharedPtr<const FFlowFieldSectorMap> Field;
 
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "FlowField|Debug")
     int32 DebugCorridorWidthCells = 0;
@@ -117,9 +362,48 @@ protected:
     bool bEnableDebugText = false;
 
 private:
-    void BuildCorridorFromPath(const TArray<FVector>& Path, int32 CorridorWidthCm);
-    void MarkReachableCellsFromDestination();
-    void SmoothDirections(int32 Iterations = 4);
+    // زنجیره سکتورها، جستجو در کش و جمع‌آوری اسنپ‌شات ورودی سکتورهای باقی‌مانده (فقط Game Thread)
+    // OnlySectors: فقط همین سکتورها آماده می‌شوند (برای تعمیر)
+    bool PrepareBuildPlan(const FVector& Destination, const TArray<FVector>& Path, int32 CorridorWidthCm, FFlowFieldBuildPlan& OutPlan, const TSet<FIntPoint>* OnlySectors = nullptr) const;
+
+    // تغییر موانع در World: فقط سکتورهایی که پنجره‌شان با ناحیه کثیف تداخل دارد دوباره ساخته می‌شوند
+    void OnObstaclesChanged(const TArray<FBox>& DirtyBounds);
+    void RepairField(const TArray<FBox>& DirtyBounds);
+
+    // سکتورهای تازه ساخته‌شده برای سفارش‌های بعدی در کش World قرار می‌گیرند
+    void CacheBuiltSectors(const FFlowFieldBuildPlan& Plan, const TArray<TSharedPtr<const FFlowFieldGrid>>& BuiltSectors) const;
+
+    // جایگزینی فیلد فعلی با فیلد کامل جدید (فقط Game Thread)
+    void ApplyField(const TSharedRef<const FFlowFieldSectorMap>& NewField, const TArray<FVector>& Path, int32 CorridorWidthCm);
 
     UGridPathfinderComponent* PathfinderComp = nullptr;
+
+    // هر ساخت جدید شماره می‌گیرد تا نتیجه‌های قدیمی‌تر دور ریخته شوند
+    uint32 BuildGeneration = 0;
+
+    // مسیر و عرض کریدور فیلد منتشرشده (ورودی تعمیر)
+    TArray<FVector> FieldPath;
+    int32 FieldCorridorWidthCm = 0;
+
+    // تغییرهای موانع حین ساخت پس‌زمینه؛ بعد از انتشار همان ساخت تعمیر می‌شوند
+    bool bBuildInFlight = false;
+    TArray<FBox> PendingRepairBounds;
+
+    FDelegateHandle ObstaclesChangedHandle;
+
+    enum class EFollowerSlot : uint8
+    {
+        Free,
+        Registered,     // هنوز نمونه‌برداری نشده
+        Sampled,
+    };
+
+    // صفحه‌های دنبال‌کننده‌ها (ایندکس = Slot)؛ Slotهای آزاد دوباره استفاده می‌شوند
+    TArray<TWeakObjectPtr<AActor>> Followers;
+    TArray<EFollowerSlot> FollowerStates;
+    TArray<FVector> FollowerPositions;
+    TArray<FVector> FollowerDirections;
+    TArray<bool> FollowerInCorridor;
+    TArray<int32> FreeFollowerSlots;
+    int32 NumFollowers = 0;
 };
\ No newline at end of file
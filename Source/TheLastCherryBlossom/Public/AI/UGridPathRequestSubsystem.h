@@ -0,0 +1,162 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "AI/Navigation/NavigationTypes.h"
+#include "AI/GridPathfinderComponent.h"
+#include "UGridPathRequestSubsystem.generated.h"
+
+class ANavigationData;
+
+// درخواست‌هایی که شروع و مقصدشان روی همان پلی‌های NavMesh است یک مسیر مشترک دارند
+struct FGridPathKey
+{
+    NavNodeRef StartPoly = INVALID_NAVNODEREF;
+    NavNodeRef GoalPoly = INVALID_NAVNODEREF;
+
+    bool operator==(const FGridPathKey& Other) const
+    {
+        return StartPoly == Other.StartPoly && GoalPoly == Other.GoalPoly;
+    }
+
+    friend uint32 GetTypeHash(const FGridPathKey& Key)
+    {
+        return HashCombine(GetTypeHash(Key.StartPoly), GetTypeHash(Key.GoalPoly));
+    }
+};
+
+/**
+ * صف درخواست مسیر سطح World.
+ * مسیر NavMesh با FindPathAsync روی Thread ناوبری ساخته می‌شود و کارهای Game Thread (تست مسیر مستقیم و Smooth با Sweep)
+ * در هر فریم فقط تا سقف ai.PathRequests.BudgetMs انجام می‌شوند؛ پس انتخاب‌های بزرگ دیگر باعث Hitch نمی‌شوند.
+ * درخواست با Priority بالاتر زودتر شروع می‌شود و در Priority برابر ترتیب ثبت حفظ می‌شود.
+ * درخواست‌های هم‌زمان با FGridPathKey یکسان یک Query مشترک می‌شوند و نتیجه‌ها تا تغییر NavMesh یا موانع کش می‌شوند؛
+ * هر یونیت فقط یک قطعه کوتاه از نقطه شروع خودش تا مسیر مشترک اضافه می‌کند.
+ * درخواست‌های یک گروه هم‌مقصد در حالت گرید با یک Dijkstra معکوس از مقصد جواب می‌گیرند.
+ */
+UCLASS()
+class THELASTCHERRYBLOSSOM_API UGridPathRequestSubsystem : public UTickableWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+    virtual void Deinitialize() override;
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+
+    // Callback همیشه روی Game Thread و در یکی از فریم‌های بعد صدا زده می‌شود (هرگز داخل خود RequestPath)
+    // درخواست‌های یک SharedGoalGroup باید Goal یکسان داشته باشند
+    uint32 RequestPath(UGridPathfinderComponent* Pathfinder, const FVector& Start, const FVector& Goal, int32 Priority, FOnGridPathComplete OnComplete, uint32 SharedGoalGroup = 0);
+
+    // گروه هم‌مقصد (مثلاً خوشه‌های یک سفارش حرکت): در حالت گرید اولین عضوی که شروع شود
+    // یک جستجوی معکوس از مقصد برای همه اعضای منتظر اجرا می‌کند؛ اعضای بی‌جواب مسیر معمول را می‌روند
+    uint32 NewSharedGoalGroup();
+
+    // Callback درخواست لغوشده صدا زده نمی‌شود
+    void CancelRequest(uint32 RequestId);
+
+    int32 NumPendingRequests() const { return Requests.Num(); }
+
+    // خالی کردن کش مسیرها (مثلاً بعد از ساخت مجدد NavMesh)
+    void InvalidatePathCache();
+
+private:
+    enum class ERequestStage : uint8
+    {
+        Queued,
+        WaitingForNav,      // FindPathAsync در حال اجراست
+        ReadyToFinalize,    // مسیر NavMesh رسیده، Resample و Smooth مانده
+        WaitingForShared,   // منتظر درخواست دیگری با همان کلید
+    };
+
+    struct FRequest
+    {
+        TWeakObjectPtr<UGridPathfinderComponent> Pathfinder;
+        FVector Start = FVector::ZeroVector;
+        FVector Goal = FVector::ZeroVector;
+        FVector ActualGoal = FVector::ZeroVector;   // مقصد پروجکت‌شده روی NavMesh
+        int32 Priority = 0;
+        FOnGridPathComplete OnComplete;
+        ERequestStage Stage = ERequestStage::Queued;
+        uint32 NavQueryId = 0;
+        TArray<FVector> NavPoints;
+        uint32 SharedGoalGroup = 0;
+
+        FGridPathKey Key;
+        bool bHasKey = false;
+
+        // درخواست‌هایی که منتظر نتیجه همین درخواست‌اند
+        TArray<uint32> MergedRequests;
+    };
+
+    struct FCachedPath
+    {
+        TArray<FVector> Path;
+        FBox Bounds;
+        double CreatedTime = 0.0;
+        uint64 LastUsed = 0;
+    };
+
+    struct FQueueEntry
+    {
+        uint32 RequestId = 0;
+        int32 Priority = 0;
+        uint64 Sequence = 0;
+
+        // Heap بیشینه روی Priority؛ در Priority برابر درخواست قدیمی‌تر جلوتر است
+        bool operator<(const FQueueEntry& Other) const
+        {
+            return Priority != Other.Priority ? Priority > Other.Priority : Sequence < Other.Sequence;
+        }
+    };
+
+    void EnqueueRequest(uint32 RequestId, const FRequest& Request);
+    void StartRequest(uint32 RequestId, FRequest& Request);
+
+    // جستجوی معکوس مشترک گروه Leader؛ اعضای جواب‌گرفته (از جمله خود Leader) به ReadyToFinalize می‌روند
+    void RunSharedGoalSearch(FRequest& Leader, const FVector& ActualGoal);
+
+    // کلید پلی شروع و مقصد؛ false اگر یکی از نقاط روی NavMesh نباشد
+    bool MakePathKey(const ANavigationData& NavData, const FVector& Start, const FVector& Goal, FGridPathKey& OutKey) const;
+
+    // آزاد کردن کلید این درخواست (لغو یا شکست بدون نتیجه) و برگرداندن منتظرها به صف
+    void ReleaseSharedQuery(uint32 RequestId, FRequest& Request);
+
+    // تکمیل درخواست‌های ادغام‌شده با مسیر مشترک (یا شکست همه‌شان)
+    void CompleteMergedRequests(const TArray<uint32>& MergedRequests, const TArray<FVector>& SharedPath);
+
+    void AddToCache(const FGridPathKey& Key, const TArray<FVector>& Path);
+    const FCachedPath* FindInCache(const FGridPathKey& Key);
+
+    UFUNCTION()
+    void OnNavigationGenerationFinished(ANavigationData* NavData);
+
+    // حذف مسیرهای کش‌شده‌ای که از نواحی کثیف (فقط موانع ایستا) می‌گذرند
+    void OnObstaclesChanged(const TArray<FBox>& DirtyBounds);
+    void FinalizeRequest(uint32 RequestId, FRequest& Request);
+    void OnNavPathFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr NavPath, uint32 RequestId);
+
+    // درخواست را از صف خارج و Callback را اجرا می‌کند؛ مسیر خالی یعنی شکست
+    void CompleteRequest(uint32 RequestId, const TArray<FVector>& Path);
+
+    TMap<uint32, FRequest> Requests;
+    TArray<FQueueEntry> Queue;
+    TArray<uint32> ReadyToFinalize;
+
+    // درخواستی که Query مشترک هر کلید را اجرا می‌کند
+    TMap<FGridPathKey, uint32> ActiveByKey;
+
+    // اعضای هر گروه هم‌مقصد تا اجرای جستجوی مشترک
+    TMap<uint32, TArray<uint32>> SharedGoalGroups;
+    uint32 NextSharedGoalGroup = 1;
+
+    TMap<FGridPathKey, FCachedPath> PathCache;
+    uint64 CacheUseCounter = 0;
+
+    FDelegateHandle ObstaclesChangedHandle;
+
+    int32 NumInFlight = 0;
+    uint32 NextRequestId = 1;
+    uint64 NextSequence = 0;
+};
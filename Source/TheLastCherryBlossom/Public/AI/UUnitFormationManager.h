@@ -2,6 +2,8 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "AI/FFormationAssignmentSolver.h"
+#include "AI/FFormationTemplateLibrary.h"
 #include "UUnitFormationManager.generated.h"
 
 class AUnitCharacter;
@@ -29,8 +31,13 @@ public:
 		const TArray<FVector>& PathPoints,
 		float CheckDistance);
 
-	// فقط C++، حذف UFUNCTION
-	TArray<TArray<float>> GetFormationMatrix(int32 UnitCount) const;
+	// شکل آرایش نهایی (اسلات‌ها از FFormationTemplateLibrary)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Formation")
+	EFormationShape FormationShape = EFormationShape::Box;
+
+	// فاصله اسلات‌های مجاور (cm)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Formation", meta = (ClampMin = "50.0"))
+	float FormationSpacing = 150.f;
 
 	
 
@@ -39,6 +46,27 @@ private:
 	UPROPERTY()
 	TArray<UFlowFieldComponent*> ClusterFlowFields;
 
+	// ---------- مسیر Async خوشه‌ها ----------
+	struct FPendingClusterPath
+	{
+		int32 ClusterIndex = INDEX_NONE;
+		uint32 RequestId = 0;
+		TArray<TWeakObjectPtr<AUnitCharacter>> Units;
+	};
+
+	// خوشه‌های سفارش فعلی که مسیرشان هنوز نرسیده
+	TArray<FPendingClusterPath> PendingClusterPaths;
+
+	// جهت مسیر خوشه‌های چندنفره سفارش فعلی (برای جهت آرایش نهایی)
+	TArray<FVector> ClusterDirections;
+
+	void CancelPendingClusterPaths();
+	void OnClusterPathReady(const TArray<FVector>& ResultPath, int32 ClusterIndex);
+	void StartClusterMove(const TArray<AUnitCharacter*>& Cluster, int32 ClusterIndex, const TArray<FVector>& Path);
+
+	// بعد از رسیدن مسیر همه خوشه‌ها: ساخت آرایش برای تمام یونیت‌های سفارش
+	void FinishClusterMoveOrder();
+
 	// ---------- توابع جدید (Formation + Assignment) ----------
 	void GenerateFinalFormation(const TArray<AUnitCharacter*>& Cluster, const FVector& Goal);
 
@@ -49,16 +77,10 @@ private:
 	const FVector& Goal,
 	TArray<FVector>& OutSlots,
 	const FVector& InFormationForward);
-	// ساخت ماتریس هزینه (فاصله یونیت -> اسلات)
-	void BuildCostMatrix(const TArray<AUnitCharacter*>& Cluster, const TArray<FVector>& Slots, TArray<TArray<float>>& OutCost);
-
-	// Hungarian solver (TArray friendly)
-	TArray<int32> HungarianSolve(const TArray<TArray<float>>& Cost);
-
-	// fallback greedy fast assign برای خوشه‌های خیلی بزرگ
-	static void GreedyAssign(const TArray<TArray<float>>& Cost, TArray<int32>& OutAssignment);
+	// ماتریس هزینه (فاصله یونیت -> اسلات) و Hungarian؛ بافرهایش بین سفارش‌ها نگه داشته می‌شوند
+	FFormationAssignmentSolver AssignmentSolver;
 
-	// ساده سازی و جدا سازی اسلات‌ها برای جلوگیری از برخورد اسلات‌ها
+	// جدا سازی اسلات‌ها تا هیچ دو اسلاتی نزدیک‌تر از MinSeparation نباشند (Relax تکراری روی Spatial Hash، خطی در تعداد اسلات‌ها)
 	static void ApplySimpleSeparation(TArray<FVector>& Slots, float MinSeparation);
 
 	// حرکت دادن یونیت‌ها به اسلات‌های اختصاص داده شده
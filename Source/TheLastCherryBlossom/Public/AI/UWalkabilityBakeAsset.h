@@ -0,0 +1,71 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "UWalkabilityBakeAsset.generated.h"
+
+// یک تایل Bake شده به صورت RLE (تایل‌ها هم‌تراز با تایل‌های UWalkabilityCacheSubsystem هستند)
+USTRUCT()
+struct FWalkabilityBakedTile
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    FIntPoint Coord = FIntPoint::ZeroValue;
+
+    // طول رشته‌های متناوب سلول‌ها به ترتیب ردیفی؛ رشته اول مسدود است (ممکن است صفر باشد)
+    UPROPERTY()
+    TArray<uint16> WalkableRuns;
+
+    // Clearance به صورت جفت (مقدار، تعداد تکرار)
+    UPROPERTY()
+    TArray<uint8> ClearanceValues;
+
+    UPROPERTY()
+    TArray<uint16> ClearanceCounts;
+};
+
+/**
+ * Walkability و Clearance ثابت یک لول که در ادیتور Bake می‌شود (AWalkabilityBakeVolume).
+ * با خود لول Load می‌شود و هر تایل فقط در اولین استفاده Decode می‌شود.
+ */
+UCLASS(BlueprintType)
+class THELASTCHERRYBLOSSOM_API UWalkabilityBakeAsset : public UDataAsset
+{
+    GENERATED_BODY()
+
+public:
+    virtual void PostLoad() override;
+
+    const FWalkabilityBakedTile* FindTile(const FIntPoint& Coord) const;
+
+    void SetBakedTiles(float InCellSize, float InObstacleInflation, int32 InTileSizeCells, const FBox& InBounds, TArray<FWalkabilityBakedTile>&& InTiles);
+
+    // حجم داده فشرده (بایت) برای لاگ
+    int32 GetEncodedSize() const;
+
+    static void EncodeTile(const FIntPoint& Coord, const TBitArray<>& Walkable, TConstArrayView<uint8> Clearance, FWalkabilityBakedTile& OutTile);
+
+    // false اگر داده با تعداد سلول‌های تایل نخواند
+    static bool DecodeTile(const FWalkabilityBakedTile& Tile, int32 NumCells, TBitArray<>& OutWalkable, TArray<uint8>& OutClearance);
+
+    UPROPERTY(VisibleAnywhere, Category = "Walkability")
+    float CellSize = 0.f;
+
+    UPROPERTY(VisibleAnywhere, Category = "Walkability")
+    float ObstacleInflation = 0.f;
+
+    UPROPERTY(VisibleAnywhere, Category = "Walkability")
+    int32 TileSizeCells = 0;
+
+    UPROPERTY(VisibleAnywhere, Category = "Walkability")
+    FBox BakedBounds = FBox(ForceInit);
+
+private:
+    void RebuildTileIndex();
+
+    UPROPERTY()
+    TArray<FWalkabilityBakedTile> Tiles;
+
+    TMap<FIntPoint, int32> TileIndex;
+};
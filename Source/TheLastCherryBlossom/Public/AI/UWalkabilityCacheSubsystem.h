@@ -0,0 +1,155 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "AI/Navigation/NavigationTypes.h"
+#include "AI/FGridJumpPointSearch.h"
+#include "UWalkabilityCacheSubsystem.generated.h"
+
+class ANavigationData;
+class UWalkabilityBakeAsset;
+
+/**
+ * کش Walkability ثابت (NavMesh + موانع ثابت، بدون یونیت‌ها) به صورت Bitmap تایل‌بندی‌شده و هم‌تراز با World.
+ * هر تایل با اولین Query داخلش یک‌جا Rasterize می‌شود و بعد از آن هر تست یک خواندن بیت است.
+ * تایل‌ها با Dirty شدن NavMesh (و دوباره بعد از پایان ساخت NavMesh) یا گزارش تغییر موانع فقط در همان ناحیه دور ریخته می‌شوند.
+ * دقت با ai.Walkability.CellSize تنظیم می‌شود.
+ * اگر لول داده Bake شده داشته باشد (AWalkabilityBakeVolume) تایل‌ها به جای Query از World از روی آن Decode می‌شوند؛
+ * تایلی که در زمان اجرا Invalidate شود از آن به بعد دوباره از World ساخته می‌شود.
+ * برای هر سلول فاصله تا نزدیک‌ترین سلول مسدود (Clearance) هم نگه داشته می‌شود.
+ */
+UCLASS()
+class THELASTCHERRYBLOSSOM_API UWalkabilityCacheSubsystem : public UWorldSubsystem
+{
+    GENERATED_BODY()
+
+public:
+    static constexpr int32 TileSizeCells = 64;
+
+    virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+    virtual void Deinitialize() override;
+
+    // در صورت نیاز تایل را می‌سازد؛ MinClearanceCm فاصله اضافه لازم از لبه ناحیه قابل عبور است
+    bool IsWalkable(const FVector& Location, float MinClearanceCm = 0.f);
+
+    // فقط اگر تایل قبلاً ساخته شده باشد (بدون هیچ Query)
+    bool TryGetWalkable(const FVector& Location, bool& bOutWalkable) const;
+
+    // نزدیک‌ترین مرکز سلول Walkable در شعاع (جستجوی حلقه‌ای روی بیت‌ها)؛ Z همان Origin است
+    bool FindClosestWalkable(const FVector& Origin, float SearchRadius, FVector& OutLocation, float MinClearanceCm = 0.f);
+
+    // خط دید روی Bitmap ثابت (بدون یونیت‌ها) با پیمایش Supercover سلول‌ها — جایگزین Sweep فیزیکی برای مسیر مستقیم و Smooth
+    // سلول‌های مسدود چسبیده به شروع نادیده گرفته می‌شوند (یونیتی که داخل حاشیه Inflation مانع ایستاده)
+    bool HasLineOfSight(const FVector& Start, const FVector& End, float MinClearanceCm = 0.f);
+
+    // چند پاره‌خط با هم: تایل‌های سر راه یک بار روی Game Thread آماده و پیمایش‌ها موازی اجرا می‌شوند
+    void HasLineOfSightBatch(TConstArrayView<FVector> Starts, TConstArrayView<FVector> Ends, float MinClearanceCm, TArrayView<bool> OutVisible);
+
+    // چند نقطه با هم روی سطح قابل عبور (جایگزین ProjectPointToNavigation تک‌تک)؛ تعداد نقاط Project شده را برمی‌گرداند
+    // نقاط داخل تایل‌های ساخته‌شده از Bitmap بدون Query، بقیه با BatchProjectPoints روی NavMesh به ترتیب تایل (در صورت زیاد بودن موازی)
+    // QueryExtent نامعتبر = Extent پیش‌فرض NavMesh؛ نقطه‌ای که Project نشود دست نمی‌خورد
+    int32 ProjectPointsToNavigation(TArrayView<FVector> Points, const FVector& QueryExtent = INVALID_NAVEXTENT, bool bAllowParallel = true);
+
+    // نمونه‌برداری لایه ثابت در مراکز یک گرید دلخواه (مرکز سلول (x,y) = GridOrigin + (x+0.5, y+0.5) * SampleCellSize)
+    bool SampleWalkability(const FVector2D& GridOrigin, float SampleCellSize, int32 Width, int32 Height, float HeightHint, TBitArray<>& OutWalkable);
+
+    void InvalidateBounds(const FBox& Bounds);
+    void InvalidateAll();
+
+    // موانع گزارش‌شده به UFlowFieldCacheSubsystem (قبل از Broadcast آن صدا زده می‌شود تا تعمیر FlowFieldها تایل کهنه نبیند)
+    void InvalidateObstacleBounds(const TArray<FBox>& DirtyBounds);
+
+    // داده Bake شده لول؛ nullptr یعنی همه تایل‌ها در زمان اجرا ساخته شوند
+    void SetBakedData(UWalkabilityBakeAsset* InBakedData);
+
+    // Bake کل تایل‌های محدوده از World فعلی (در ادیتور) داخل Asset
+    bool BakeRegion(const FBox& Bounds, UWalkabilityBakeAsset& OutAsset);
+
+    // مسیر JPS روی Bitmap کش، داخل پنجره‌ای از تایل‌ها دور شروع و مقصد (false اگر پنجره از سقف بزرگ‌تر باشد یا مسیری نباشد)
+    // نقاط Jump Pointها در مرکز سلول‌اند و Z بین شروع و مقصد خطی است (نقشه‌های تخت)
+    // پنجره و جدول JPS+ آن تا تغییر بعدی کش برای درخواست‌های بعدی در همان پنجره نگه داشته می‌شوند
+    bool FindGridPath(const FVector& Start, const FVector& Goal, float MinClearanceCm, bool bUseJumpTable, TArray<FVector>& OutPath);
+
+    // همه شروع‌ها به یک مقصد با یک جستجوی معکوس از مقصد (پنجره باید همه را بپوشاند)
+    // OutPaths هم‌اندیس با Starts است؛ شروع بی‌مسیر آرایه خالی می‌گیرد. false اگر پنجره بزرگ باشد یا هیچ مسیری نباشد
+    bool FindGridPathsToGoal(const FVector& Goal, TConstArrayView<FVector> Starts, float MinClearanceCm, TArray<TArray<FVector>>& OutPaths);
+
+    // تعداد گره‌های باز شده در آخرین FindGridPath (برای Benchmark)
+    int32 GetLastGridPathExpandedNodes() const { return GridSearch.GetLastExpandedNodes(); }
+
+    float GetCellSize() const { return CellSize; }
+    float GetObstacleInflation() const;
+
+private:
+    struct FTile
+    {
+        TBitArray<> Walkable;
+
+        // فاصله تا نزدیک‌ترین سلول مسدود به سلول (صفر = مسدود، اشباع در 255)
+        TArray<uint8> Clearance;
+    };
+
+    FIntPoint WorldToCell(const FVector& Location) const;
+    static FIntPoint CellToTile(const FIntPoint& Cell);
+
+    const FTile& GetOrBuildTile(const FIntPoint& TileCoord, float HeightHint);
+    void BuildTile(const FIntPoint& TileCoord, float HeightHint, FTile& OutTile) const;
+    void BuildWalkability(const FIntPoint& MinCell, int32 Width, int32 Height, float HeightHint, TBitArray<>& OutWalkable) const;
+
+    // Walkability تایل + Clearance روی پنجره‌ای با حاشیه از تایل‌های همسایه (تا در مرز تایل‌ها مثل داده Bake‌شده باشد)
+    void BuildRuntimeTile(const FIntPoint& TileCoord, float HeightHint, FTile& OutTile) const;
+
+    // حاشیه (سلول) لازم برای بزرگ‌ترین Clearance مورد نیاز (ai.Walkability.MaxClearanceCm)
+    int32 GetClearanceHaloCells() const;
+    bool DecodeBakedTile(const FIntPoint& TileCoord, FTile& OutTile) const;
+    bool IsBakedDataCompatible() const;
+    bool IsCellWalkable(const FIntPoint& Cell, float HeightHint, float MinClearanceCm);
+
+    // فقط روی تایل‌های ساخته‌شده (امن برای خواندن هم‌زمان)؛ تایل ناموجود مسدود حساب می‌شود
+    bool IsBuiltCellWalkable(const FIntPoint& Cell, float MinClearanceCm) const;
+
+    // Chamfer دو پاسه روی کل Bitmap؛ بیرون Bitmap قابل عبور فرض می‌شود
+    static void ComputeClearance(const TBitArray<>& Walkable, int32 Width, int32 Height, TArray<uint8>& OutClearance);
+
+    // اگر CVar اندازه سلول عوض شده باشد کل کش با اندازه جدید از نو شروع می‌شود
+    void SyncCellSize();
+
+    // پنجره جستجوی گرید را از تایل‌ها پر می‌کند (اگر همان پنجره با همان نسخه کش آماده نباشد)
+    void PrepareSearchWindow(const FIntPoint& MinTile, const FIntPoint& MaxTile, float MinClearanceCm, float HeightHint);
+
+    // سلول شروع داخل پنجره؛ اگر مسدود باشد نزدیک‌ترین سلول باز در چند حلقه اطراف
+    FIntPoint FindSearchStartCell(const FIntPoint& LocalCell) const;
+
+    // Jump Pointهای پنجره → نقاط World (نقطه اول و آخر دقیقاً Start و Goal)
+    void JumpPointsToWorld(TConstArrayView<FIntPoint> JumpPoints, const FIntPoint& WindowOrigin, const FVector& Start, const FVector& Goal, TArray<FVector>& OutPath) const;
+
+    void OnNavigationDirtied(const FBox& DirtyBounds);
+
+    UFUNCTION()
+    void OnNavigationGenerationFinished(ANavigationData* NavData);
+
+    TMap<FIntPoint, FTile> Tiles;
+
+    UPROPERTY()
+    TObjectPtr<UWalkabilityBakeAsset> BakedData;
+
+    // تایل‌های Bake شده‌ای که بعد از Load در World تغییر کرده‌اند
+    TSet<FIntPoint> StaleBakedTiles;
+
+    // با هر Invalidate زیاد می‌شود تا پنجره جستجوی گرید کهنه دوباره پر شود
+    uint32 Version = 1;
+
+    FGridJumpPointSearch GridSearch;
+    TBitArray<> SearchWalkable;
+    FIntPoint SearchMinTile = FIntPoint::ZeroValue;
+    FIntPoint SearchMaxTile = FIntPoint::ZeroValue;
+    float SearchClearanceCm = 0.f;
+    uint32 SearchVersion = 0;
+
+    // تایل‌هایی که بعد از Dirty شدن NavMesh و قبل از پایان ساختش دوباره ساخته شده‌اند (ممکن است از NavMesh کهنه باشند)
+    TSet<FIntPoint> TilesPendingNavRebuild;
+
+    float CellSize = 50.f;
+
+    FDelegateHandle NavigationDirtyHandle;
+};
@@ -7,6 +7,7 @@
 #include "GameFramework/Character.h"
 #include "Interfaces/Selectable.h"
 #include "Ai/GridPathfinderComponent.h"
+#include "AI/FGridPathHandle.h"
 #include "AUnitCharacter.generated.h"
 
 class UFlowFieldComponent;
@@ -62,7 +63,9 @@ public:
     UGridPathfinderComponent* GridPathfinder;
 
     // ✅ تابع جدید برای دریافت مسیر کامل
-    void SetPathAndMove(const TArray<FVector>& Path, bool bIsSingleUnit = false);
+    // مسیر مشترک (مثلاً مسیر یک خوشه) فقط به صورت Handle نگه داشته می‌شود
+    void SetPathAndMove(const FGridPathHandle& Path, bool bIsSingleUnit = false);
+    void SetPathAndMove(const TArray<FVector>& Path, bool bIsSingleUnit = false) { SetPathAndMove(FGridPathHandle(Path), bIsSingleUnit); }
 
     // تابع برای تغییر سرعت کاراکتر
     UFUNCTION(BlueprintCallable, Category="Movement")
@@ -86,7 +89,8 @@ public:
     UFUNCTION(BlueprintCallable, Category="State")
     EUnitState GetUnitState() const { return CurrentState; }
 
-    void FollowPathDirectly(const TArray<FVector>& PathPoints);
+    void FollowPathDirectly(const FGridPathHandle& PathPoints);
+    void FollowPathDirectly(const TArray<FVector>& PathPoints) { FollowPathDirectly(FGridPathHandle(PathPoints)); }
 
     UPROPERTY()
     UGridPathfinderComponent* PathfinderComp;
@@ -98,6 +102,13 @@ public:
     UPROPERTY()
     UFlowFieldComponent* ClusterFlowField = nullptr; // Flow Field خوشه
 
+    // Flow Field سفارش جدید که هنوز در پس‌زمینه ساخته می‌شود؛ بعد از آماده شدن جای ClusterFlowField را می‌گیرد
+    UPROPERTY()
+    UFlowFieldComponent* PendingClusterFlowField = nullptr;
+
+    // Slot این یونیت در لیست دنبال‌کننده‌های ClusterFlowField
+    int32 ClusterFlowFieldSlot = INDEX_NONE;
+
     UPROPERTY()
     bool bHasLoggedFlowField = false; // برای لاگ یک بار هنگام ست شدن Flow Field
 
@@ -150,7 +161,8 @@ private:
     bool bIsRotating = false;    // آیا در حال چرخش است
   
 
-    TArray<FVector> CurrentPath;
+    // مسیر تغییرناپذیر مشترک با بقیه یونیت‌های خوشه؛ پیشرفت خود یونیت فقط در CurrentPathIndex است
+    FGridPathHandle CurrentPath;
     int32 CurrentPathIndex = 0;
     //float MoveSpeed = 50.f;
 
@@ -167,5 +179,8 @@ private:
     // برای هموار کردن جهت حرکت در حالت تک‌یونیت
     FVector SmoothedDirection = FVector::ZeroVector;
 
+    // جابه‌جایی بین فیلدها: ثبت به‌عنوان دنبال‌کننده + وابستگی Tick
+    void AttachToClusterFlowField(UFlowFieldComponent* NewFlow);
+
     
 };
@@ -68,4 +68,7 @@ private:
 
     FVector2D DragStartPos;
     FVector2D DragEndPos;
+
+    // درخواست‌های مسیر MoveSelectedUnitsToLocation که هنوز ممکن است در صف باشند
+    TArray<uint32> PendingMoveRequests;
 };